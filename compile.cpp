@@ -0,0 +1,354 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "compile.h"
+#include "mcstream.h"
+#include "parallel.h"
+#include "trajectory.h"
+
+#define MC_CHUNK	4096		// ticks per work item
+#define D2R(d)		((d) * M_PI / 180.0)
+#define R2D(r)		((r) * 180.0 / M_PI)
+
+typedef struct {
+  double t;
+  double pos[WS_AXES];
+  int    line;
+} mc_row_s;
+
+typedef struct {
+  bool                  sampled;
+  std::vector<mc_row_s> rows;
+  traj_s                traj;	// keyframes only
+} mc_motion_s;
+
+static bool
+is_csv (const char *filename)
+{
+  size_t len = strlen (filename);
+  return len >= 4 && !strcasecmp (filename + len - 4, ".csv");
+}
+
+static bool
+mc_load (const char *filename, mc_motion_s *motion)
+{
+  char line[1024];
+  int lineno = 0;
+  bool ok = true;
+
+  motion->sampled = is_csv (filename);
+  FILE *fp = fopen (filename, "r");
+  if (!fp) {
+    perror (filename);
+    return false;
+  }
+
+  while (ok && fgets (line, sizeof(line), fp)) {
+    lineno++;
+    char *hash = strchr (line, '#');
+    if (hash) *hash = 0;
+    char *p = line + strspn (line, " \t\r\n,");
+    if (!*p) continue;
+
+    double v[1 + WS_AXES];
+    int n = 0;
+    while (n < 1 + WS_AXES) {
+      char *end;
+      v[n] = strtod (p, &end);
+      if (end == p) break;
+      n++;
+      p = end + strspn (end, " \t\r\n,");
+    }
+    if (n == 0 && motion->sampled && motion->rows.empty ()) continue;
+    if (n < 1 + WS_AXES || *p) {
+      fprintf (stderr, "%s:%d: want t x y z roll pitch yaw\n",
+	       filename, lineno);
+      ok = false;
+      break;
+    }
+    if (!motion->rows.empty () && !(v[0] > motion->rows.back ().t)) {
+      fprintf (stderr, "%s:%d: time does not increase\n", filename, lineno);
+      ok = false;
+      break;
+    }
+
+    mc_row_s row;
+    row.t = v[0];
+    row.line = lineno;
+    for (int a = 0; a < WS_AXES; a++)
+      row.pos[a] = (a >= WS_AXIS_ROLL) ? D2R (v[1 + a]) : v[1 + a];
+    motion->rows.push_back (row);
+  }
+  fclose (fp);
+
+  if (ok && motion->rows.empty ()) {
+    fprintf (stderr, "%s: no motion\n", filename);
+    ok = false;
+  }
+  if (!ok || motion->sampled) return ok;
+
+  // keyframes, Catmull-Rom slopes through the inner ones
+  std::vector<mc_row_s> &k = motion->rows;
+  traj_point_s from, to;
+  traj_clear (&motion->traj);
+  memset (&from, 0, sizeof(from));
+  memcpy (from.pos, k[0].pos, sizeof(from.pos));
+  for (size_t i = 1; i < k.size (); i++) {
+    memset (&to, 0, sizeof(to));
+    memcpy (to.pos, k[i].pos, sizeof(to.pos));
+    if (i + 1 < k.size ())
+      for (int a = 0; a < WS_AXES; a++)
+	to.vel[a] = (k[i + 1].pos[a] - k[i - 1].pos[a]) /
+	  (k[i + 1].t - k[i - 1].t);
+    traj_add (&motion->traj, &from, &to, k[i].t - k[i - 1].t);
+    from = to;
+  }
+  return ok;
+}
+
+/***
+    Pose at t seconds after the first row, and the input line it came
+    from.  cursor carries the row from one call to the next, so a run of
+    increasing t steps along the rows; starting it at MC_NO_CURSOR, or
+    going back in time, finds the row by binary search instead.
+ ***/
+
+#define MC_NO_CURSOR	SIZE_MAX
+
+static bool
+row_before (double at, const mc_row_s &row)
+{
+  return at < row.t;
+}
+
+static int
+mc_pose (const mc_motion_s *motion, size_t *cursor, double t, double *pos)
+{
+  const std::vector<mc_row_s> &r = motion->rows;
+  double at = r[0].t + t;
+
+  if (r.size () == 1 || at <= r[0].t) {
+    memcpy (pos, r[0].pos, sizeof(double) * WS_AXES);
+    return r[0].line;
+  }
+  if (*cursor >= r.size () - 1 || r[*cursor].t > at) {
+    // the last row at or before at, which the first row always is
+    size_t after = std::upper_bound (r.begin (), r.end (), at, row_before) -
+      r.begin ();
+    *cursor = std::min (after - 1, r.size () - 2);
+  }
+  while (*cursor + 2 < r.size () && r[*cursor + 1].t <= at) (*cursor)++;
+  const mc_row_s *a = &r[*cursor], *b = a + 1;
+
+  if (motion->sampled) {
+    double u = std::min (1.0, (at - a->t) / (b->t - a->t));
+    for (int i = 0; i < WS_AXES; i++)
+      pos[i] = a->pos[i] + u * (b->pos[i] - a->pos[i]);
+  }
+  else {
+    traj_point_s p;
+    size_t seg = *cursor;
+    traj_eval_at (&motion->traj, &seg, t, &p);
+    memcpy (pos, p.pos, sizeof(p.pos));
+  }
+  return (at >= b->t) ? b->line : a->line;	// the row it starts from
+}
+
+typedef struct {
+  uint64_t first;			// tick, UINT64_MAX if none
+  uint64_t unreachable;
+  uint64_t clipped;			// past the int16 range
+  double   error;			// radians, largest rounding error
+  std::vector<ik_pose_s>     poses;
+  std::vector<double>        alphas;
+  std::vector<unsigned char> valid;
+} mc_accum_s;
+
+int
+mc_compile (const ik_geometry_s *geo, const char *infile,
+	    const char *outfile, unsigned rate)
+{
+  mc_motion_s motion;
+  struct timespec start, end;
+
+  if (!mc_load (infile, &motion)) return -1;
+
+  double duration = motion.rows.back ().t - motion.rows[0].t;
+  uint64_t ticks = (uint64_t)floor (duration * rate + 1.0e-9) + 1;
+  if (ticks > UINT32_MAX) {
+    fprintf (stderr, "%s: %.0f sec is too long at %u Hz\n",
+	     infile, duration, rate);
+    return -1;
+  }
+
+  double scale = (double)MC_DEFAULT_SCALE * 1.0e-9;
+  std::vector<int16_t> counts (ticks * MCS_SERVOS);
+  int nthreads = parallel_threads ();
+  std::vector<mc_accum_s> accum (nthreads);
+  for (int t = 0; t < nthreads; t++) {
+    accum[t].first = UINT64_MAX;
+    accum[t].unreachable = 0;
+    accum[t].clipped = 0;
+    accum[t].error = 0.0;
+    accum[t].poses.resize (MC_CHUNK);
+    accum[t].alphas.resize (MC_CHUNK * IK_SERVOS);
+    accum[t].valid.resize (MC_CHUNK);
+  }
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+
+  parallel_for (ticks, MC_CHUNK, [&](size_t begin, size_t end, int t) {
+      mc_accum_s *acc = &accum[t];
+      size_t n = end - begin;
+      size_t cursor = MC_NO_CURSOR;
+      for (size_t i = 0; i < n; i++) {
+	double pos[WS_AXES];
+	mc_pose (&motion, &cursor, (double)(begin + i) / rate, pos);
+	ik_pose_s *pose = &acc->poses[i];
+	pose->delta_x = pos[WS_AXIS_X];
+	pose->delta_y = pos[WS_AXIS_Y];
+	pose->delta_z = pos[WS_AXIS_Z];
+	pose->rho     = pos[WS_AXIS_ROLL];
+	pose->theta   = pos[WS_AXIS_PITCH];
+	pose->phi     = pos[WS_AXIS_YAW];
+      }
+      ik_batch (geo, acc->poses.data (), acc->alphas.data (),
+		acc->valid.data (), n);
+
+      for (size_t i = 0; i < n; i++) {
+	int16_t *c = &counts[(begin + i) * MCS_SERVOS];
+	bool ok = acc->valid[i];
+	for (int s = 0; ok && s < IK_SERVOS; s++) {
+	  double a = acc->alphas[i * IK_SERVOS + s];
+	  double q = nearbyint (a / scale);
+	  if (q < INT16_MIN || q > INT16_MAX) {
+	    acc->clipped++;
+	    ok = false;
+	    break;
+	  }
+	  c[s] = (int16_t)q;
+	  acc->error = std::max (acc->error, fabs (a - q * scale));
+	}
+	if (!ok) {
+	  acc->unreachable++;
+	  acc->first = std::min (acc->first, (uint64_t)(begin + i));
+	}
+      }
+    });
+
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  double secs = (double)(end.tv_sec - start.tv_sec) +
+    1.0e-9 * (double)(end.tv_nsec - start.tv_nsec);
+
+  uint64_t first = UINT64_MAX, unreachable = 0, clipped = 0;
+  double error = 0.0;
+  for (int t = 0; t < nthreads; t++) {
+    first = std::min (first, accum[t].first);
+    unreachable += accum[t].unreachable;
+    clipped += accum[t].clipped;
+    error = std::max (error, accum[t].error);
+  }
+
+  fprintf (stdout, "motion:    %s, %zu %s, %.3f sec\n", infile,
+	   motion.rows.size (), motion.sampled ? "samples" : "keyframes",
+	   duration);
+  fprintf (stdout, "time:      %.3f sec for %llu ticks at %u Hz, %d "
+	   "threads, %s kernel\n", secs, (unsigned long long)ticks, rate,
+	   nthreads, ik_batch_isa ());
+
+  if (unreachable) {
+    double pos[WS_AXES];
+    size_t cursor = MC_NO_CURSOR;
+    int line = mc_pose (&motion, &cursor, (double)first / rate, pos);
+    fprintf (stdout, "reachable: %llu ticks out of reach, %llu of them "
+	     "past the servo range\n", (unsigned long long)unreachable,
+	     (unsigned long long)clipped);
+    fprintf (stdout, "first:     tick %llu, %.4f sec, from line %d, x %.3g "
+	     "y %.3g z %.3g roll %.3g pitch %.3g yaw %.3g\n",
+	     (unsigned long long)first, motion.rows[0].t +
+	     (double)first / rate, line, pos[WS_AXIS_X], pos[WS_AXIS_Y],
+	     pos[WS_AXIS_Z], R2D (pos[WS_AXIS_ROLL]),
+	     R2D (pos[WS_AXIS_PITCH]), R2D (pos[WS_AXIS_YAW]));
+    fprintf (stdout, "nothing written\n");
+    return 1;
+  }
+
+  mcs_header_s hdr;
+  hdr.rate = rate;
+  hdr.ticks = (uint32_t)ticks;
+  hdr.scale = MC_DEFAULT_SCALE;
+  hdr.sync = (uint16_t)std::min (rate, (unsigned)UINT16_MAX);
+
+  FILE *fp = fopen (outfile, "w");
+  if (!fp) {
+    perror (outfile);
+    return -1;
+  }
+
+  uint8_t buf[MCS_HEADER_BYTES];
+  uint64_t bytes = MCS_HEADER_BYTES;
+  mcs_put_header (buf, &hdr);
+  if (fwrite (buf, MCS_HEADER_BYTES, 1, fp) != 1) {
+    perror (outfile);
+    fclose (fp);
+    return -1;
+  }
+
+  std::vector<uint8_t> out;
+  out.reserve (MC_CHUNK * MCS_FRAME_MAX);
+  for (uint64_t i = 0; i < ticks; i++) {
+    uint8_t frame[MCS_FRAME_MAX];
+    const int16_t *c = &counts[i * MCS_SERVOS];
+    size_t n = mcs_put_frame (frame, &hdr, (uint32_t)i, c,
+			      i ? c - MCS_SERVOS : c);
+    out.insert (out.end (), frame, frame + n);
+    if (out.size () >= MC_CHUNK * MCS_FRAME_MAX - MCS_FRAME_MAX ||
+	i + 1 == ticks) {
+      if (fwrite (out.data (), 1, out.size (), fp) != out.size ()) {
+	perror (outfile);
+	fclose (fp);
+	return -1;
+      }
+      bytes += out.size ();
+      out.clear ();
+    }
+  }
+  if (fclose (fp) != 0) {
+    perror (outfile);
+    return -1;
+  }
+
+  fprintf (stdout, "reachable: every tick, servo rounding at most %.4f "
+	   "deg\n", R2D (error));
+  fprintf (stdout, "output:    %s, %llu bytes, %.2f bytes a tick (%d "
+	   "plain), %.0f bytes/sec, sync every %u ticks\n", outfile,
+	   (unsigned long long)bytes,
+	   (double)(bytes - MCS_HEADER_BYTES) / (double)ticks,
+	   2 * MCS_SERVOS, (double)bytes / std::max (duration, 1.0 / rate),
+	   hdr.sync);
+  return 0;
+}
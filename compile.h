@@ -0,0 +1,50 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef COMPILE_H
+#define COMPILE_H
+
+#include "ikbatch.h"
+
+/***
+
+    Offline motion compiler.  Reads a motion, solves the IK for every tick
+    of it on all cores, and if every tick is reachable writes the servo
+    angles as a compiled stream (mcstream.h) for a board to play back.
+    Otherwise it writes nothing and reports the first tick out of reach.
+
+    The input is lines of seven numbers, separated by commas or blanks,
+
+	t x y z roll pitch yaw			seconds, cm, degrees
+
+    with # comments.  A file whose name ends in .csv is a sampled motion,
+    played by straight lines between the rows (rows one tick apart come
+    out as they are), and may start with a header line.  Anything else is
+    keyframes, joined by quintic segments that pass through each inner
+    keyframe at the average of its neighbouring slopes and start and end
+    at rest.  Times must increase.
+
+ ***/
+
+#define MC_DEFAULT_RATE		50		// Hz, a servo pulse frame
+#define MC_DEFAULT_SCALE	100000		// nanoradians, 0.0057 degrees
+
+int mc_compile (const ik_geometry_s *geo, const char *infile,
+		const char *outfile, unsigned rate);
+
+#endif // COMPILE_H
@@ -0,0 +1,182 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "feeder.h"
+#include "yuv.h"
+
+static void
+feeder_loop (feeder_s *f)
+{
+  std::unique_lock<std::mutex> hold (f->lock);
+  for (;;) {
+    f->queued.wait (hold, [f] { return f->stop || !f->queue.empty (); });
+    if (f->queue.empty ()) break;		// stopped and drained
+    feeder_entry_s e = f->queue.front ();
+    f->queue.pop_front ();
+    f->count.depth = (int)f->queue.size ();
+    hold.unlock ();
+
+    // duplicates may still be added to a queued entry, not to this one
+    const unsigned char *data = f->buffers[e.slot].data ();
+    int i;
+    for (i = 0; i <= e.repeat && !f->failed; i++) {
+      if (fwrite (data, f->bytes, 1, f->out) != 1) {
+	perror ("writing video frames");
+	f->failed = true;
+	break;
+      }
+      f->count.frames++;
+      f->count.bytes += f->bytes;
+    }
+    f->count.lost += e.repeat + 1 - i;
+
+    hold.lock ();
+    f->free.push_back (e.slot);
+    f->freed.notify_one ();
+  }
+  fflush (f->out);
+}
+
+void
+feeder_start (feeder_s *f, FILE *out, int width, int height, int depth,
+	      feeder_policy_e policy)
+{
+  if (depth < 2) depth = 2;	// one being written, one to fill
+  f->out = out;
+  f->width = width;
+  f->height = height;
+  f->bytes = yuv_i420_size (width, height);
+  f->policy = policy;
+  f->buffers.assign (depth, std::vector<unsigned char> (f->bytes));
+  f->free.clear ();
+  for (int i = depth - 1; i >= 0; i--) f->free.push_back (i);
+  f->queue.clear ();
+  f->stop = false;
+  f->failed = false;
+  f->count.depth = 0;
+  f->count.max_depth = 0;
+  f->count.frames = 0;
+  f->count.bytes = 0;
+  f->count.dropped = 0;
+  f->count.duplicated = 0;
+  f->count.blocked = 0;
+  f->count.lost = 0;
+  f->thread = std::thread (feeder_loop, f);
+  f->running = true;
+}
+
+void
+feeder_put (feeder_s *f, const void *rgba)
+{
+  if (f->failed) {
+    f->count.lost++;
+    return;
+  }
+
+  std::unique_lock<std::mutex> hold (f->lock);
+  int slot = -1;
+
+  if (f->free.empty () && !f->queue.empty ()) {
+    switch (f->policy) {
+    case FEEDER_BLOCK:
+      break;
+    case FEEDER_DROP_OLDEST:
+      slot = f->queue.front ().slot;
+      f->queue.pop_front ();
+      f->count.dropped++;
+      break;
+    case FEEDER_DUPLICATE:
+      f->queue.back ().repeat++;
+      f->count.duplicated++;
+      return;
+    }
+  }
+  if (slot < 0) {
+    if (f->free.empty ()) {
+      f->count.blocked++;
+      f->freed.wait (hold, [f] { return !f->free.empty (); });
+    }
+    slot = f->free.back ();
+    f->free.pop_back ();
+  }
+
+  // the slot is ours alone, so the conversion can go on without the lock
+  hold.unlock ();
+  yuv_from_rgba ((const unsigned char *)rgba, f->width, f->height,
+		 f->buffers[slot].data ());
+  hold.lock ();
+
+  feeder_entry_s e = { slot, 0 };
+  f->queue.push_back (e);
+  int depth = (int)f->queue.size ();
+  f->count.depth = depth;
+  if (depth > f->count.max_depth) f->count.max_depth = depth;
+  f->queued.notify_one ();
+}
+
+void
+feeder_stop (feeder_s *f)
+{
+  if (!f->running) return;
+  {
+    std::lock_guard<std::mutex> hold (f->lock);
+    f->stop = true;
+    f->queued.notify_one ();
+  }
+  f->thread.join ();
+  f->running = false;
+}
+
+static const char *policy_names[] = { "block", "drop", "duplicate" };
+
+bool
+feeder_policy_parse (const char *arg, feeder_policy_e *policy)
+{
+  for (int p = FEEDER_BLOCK; p <= FEEDER_DUPLICATE; p++)
+    if (strcmp (arg, policy_names[p]) == 0) {
+      *policy = (feeder_policy_e)p;
+      return true;
+    }
+  return false;
+}
+
+const char *
+feeder_policy_name (feeder_policy_e policy)
+{
+  return policy_names[policy];
+}
+
+void
+feeder_report (feeder_s *f, FILE *fp)
+{
+  fprintf (fp, "feeder:    %ld frames, %.1f MB written as %s I420, %s "
+	   "policy, queue %d max of %zu\n", f->count.frames.load (),
+	   (double)f->count.bytes.load () / 1.0e6, yuv_isa (),
+	   feeder_policy_name (f->policy), f->count.max_depth.load (),
+	   f->buffers.size ());
+  fprintf (fp, "  dropped  %ld, duplicated %ld, waited %ld\n",
+	   f->count.dropped.load (), f->count.duplicated.load (),
+	   f->count.blocked.load ());
+  if (f->failed)
+    fprintf (fp, "  recording stopped early, the pipe went away: %ld "
+	     "frames lost\n", f->count.lost.load ());
+}
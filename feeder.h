@@ -0,0 +1,119 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+
+#ifndef FEEDER_H
+#define FEEDER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***
+
+    The encoder feeder: a thread that writes recorded frames to the
+    ffmpeg pipe so the render thread never waits on ffmpeg.  feeder_put ()
+    converts an RGBA frame, bottom row first as glReadPixels leaves it,
+    into I420 (yuv.h) in one of depth recycled buffers and queues it; the
+    thread writes queued frames out in order and hands their buffers back.
+
+    When ffmpeg falls behind and every buffer is queued, the policy says
+    what feeder_put () does:
+
+	FEEDER_BLOCK		waits for a buffer; every frame gets out,
+				the render thread runs at ffmpeg's pace
+	FEEDER_DROP_OLDEST	reuses the oldest queued frame's buffer; the
+				video loses that frame and runs short
+	FEEDER_DUPLICATE	drops the new frame and has the newest queued
+				one written twice in its place, so the video
+				keeps its length and its timing
+
+    If the pipe goes away, ffmpeg having exited, the thread stops writing
+    and feeder_put () drops every frame from then on without converting
+    it; both count what they lose.  The caller must have SIGPIPE ignored
+    for that, or the first write kills the process.
+
+    The counters are updated as it goes and may be read from any thread.
+
+ ***/
+
+#define FEEDER_DEFAULT_DEPTH	8
+
+typedef enum {
+  FEEDER_BLOCK,
+  FEEDER_DROP_OLDEST,
+  FEEDER_DUPLICATE
+} feeder_policy_e;
+
+typedef struct {
+  std::atomic<int>      depth;		// frames queued now
+  std::atomic<int>      max_depth;
+  std::atomic<long>     frames;		// written, duplicates included
+  std::atomic<uint64_t> bytes;
+  std::atomic<long>     dropped;
+  std::atomic<long>     duplicated;
+  std::atomic<long>     blocked;	// feeder_put () calls that waited
+  std::atomic<long>     lost;		// not written, the pipe having gone
+} feeder_counters_s;
+
+typedef struct {
+  int                    slot;
+  int                    repeat;	// extra copies to write
+} feeder_entry_s;
+
+typedef struct {
+  FILE                  *out;
+  int                    width, height;
+  size_t                 bytes;		// an I420 frame
+  feeder_policy_e        policy;
+  std::vector<std::vector<unsigned char> > buffers;
+  std::vector<int>       free;		// slots
+  std::deque<feeder_entry_s> queue;	// oldest first
+  std::mutex             lock;
+  std::condition_variable queued;	// for the thread
+  std::condition_variable freed;	// for feeder_put ()
+  std::thread            thread;
+  bool                   running;
+  bool                   stop;
+  std::atomic<bool>      failed;	// the pipe went away
+  feeder_counters_s      count;
+} feeder_s;
+
+// width and height even
+void feeder_start (feeder_s *f, FILE *out, int width, int height, int depth,
+		   feeder_policy_e policy);
+
+void feeder_put (feeder_s *f, const void *rgba);
+
+// writes out whatever is queued, then joins the thread
+void feeder_stop (feeder_s *f);
+
+// "block", "drop" or "duplicate"; false if it is none of them
+bool feeder_policy_parse (const char *arg, feeder_policy_e *policy);
+
+const char *feeder_policy_name (feeder_policy_e policy);
+
+void feeder_report (feeder_s *f, FILE *fp);
+
+#endif // FEEDER_H
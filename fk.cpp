@@ -0,0 +1,342 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#include <math.h>
+#include <string.h>
+
+#include "fk.h"
+
+#define NQ 6			// delta_x, delta_y, delta_z, phi, theta, rho
+
+/***
+    Largest step taken per iteration.  Near the solution the Newton step is
+    far smaller than this; far from it, capping the step keeps a cold start
+    from jumping to one of the other assemblies that satisfy the same six
+    angles.  A step that does not reduce sum f^2 is halved, at most
+    FK_MAX_HALVINGS times.
+ ***/
+#define FK_MAX_LINEAR_STEP	1.0	// cm
+#define FK_MAX_ANGULAR_STEP	0.2	// radians
+#define FK_MAX_HALVINGS		8
+
+/***
+    Residuals and, if jac is non-NULL, their derivatives wrt the pose.  If
+    twist is non-NULL it gets the derivatives wrt a twist (v, w) instead,
+    rows [g, r x g], and dfda the derivative of each f wrt its own raw
+    servo angle.
+
+    With d = P - B, the gradient of f wrt d is
+
+	g = 2d - 2a sin (alpha) y^ + sgn (N) 2a cos (alpha) (cos b, 0, sin b)
+
+    (the sgn from N = -|N|).  Translations move d directly; a rotation
+    about unit axis e moves the rotated anchor r by e x r, so its column is
+    g . (e x r).  The axes of xrot (theta) * yrot (rho) * zrot (phi) are
+    x^, xrot y^ and xrot yrot z^.
+ ***/
+
+static double
+evaluate (const ik_geometry_s *geo, const double *sa, const double *ca,
+	  const ik_pose_s *pose, double *f, double jac[NQ][NQ],
+	  double twist[NQ][NQ] = NULL, double *dfda = NULL)
+{
+  double sx = sin (pose->theta), cx = cos (pose->theta);
+  double sy = sin (pose->rho),   cy = cos (pose->rho);
+  double sz = sin (pose->phi),   cz = cos (pose->phi);
+  double R[3][3] = {
+    { cy * cz,                -cy * sz,                 sy      },
+    { cx * sz + sx * sy * cz,  cx * cz - sx * sy * sz, -sx * cy },
+    { sx * sz - cx * sy * cz,  sx * cz + cx * sy * sz,  cx * cy }
+  };
+  double e_phi[3]   = { R[0][2], R[1][2], R[2][2] };
+  double e_theta[3] = { 1.0, 0.0, 0.0 };
+  double e_rho[3]   = { 0.0, cx, sx };
+  double worst = 0.0;
+
+  for (int i = 0; i < IK_SERVOS; i++) {
+    double a[3] = { geo->anchor_x[i], geo->anchor_y[i], geo->anchor_z[i] };
+    double r[3];
+    for (int k = 0; k < 3; k++)
+      r[k] = R[k][0] * a[0] + R[k][1] * a[1] + R[k][2] * a[2];
+    double d[3] = {
+      pose->delta_x + r[0] - geo->base_x[i],
+      pose->delta_y + geo->h0 + r[1],
+      pose->delta_z + r[2] - geo->base_z[i]
+    };
+
+    double L = d[0] * d[0] + d[1] * d[1] + d[2] * d[2] - geo->leg_arm;
+    double M = geo->two_arm * d[1];
+    double Nraw = geo->two_arm *
+      (d[0] * geo->cos_beta[i] + d[2] * geo->sin_beta[i]);
+    double sgn = (Nraw < 0.0) ? -1.0 : 1.0;
+    double N = -fabs (Nraw);
+
+    f[i] = L - M * sa[i] - N * ca[i];
+    if (fabs (f[i]) > worst) worst = fabs (f[i]);
+    if (dfda) dfda[i] = N * sa[i] - M * ca[i];
+    if (!jac && !twist) continue;
+
+    double g[3] = {
+      2.0 * d[0] + sgn * geo->two_arm * ca[i] * geo->cos_beta[i],
+      2.0 * d[1] - geo->two_arm * sa[i],
+      2.0 * d[2] + sgn * geo->two_arm * ca[i] * geo->sin_beta[i]
+    };
+    // r x g, dotted with each axis gives g . (e x r)
+    double rg[3] = {
+      r[1] * g[2] - r[2] * g[1],
+      r[2] * g[0] - r[0] * g[2],
+      r[0] * g[1] - r[1] * g[0]
+    };
+    if (twist) {
+      for (int k = 0; k < 3; k++) {
+	twist[i][k]     = g[k];
+	twist[i][k + 3] = rg[k];
+      }
+    }
+    if (!jac) continue;
+    jac[i][0] = g[0];
+    jac[i][1] = g[1];
+    jac[i][2] = g[2];
+    jac[i][3] = e_phi[0] * rg[0] + e_phi[1] * rg[1] + e_phi[2] * rg[2];
+    jac[i][4] = e_theta[0] * rg[0];
+    jac[i][5] = e_rho[1] * rg[1] + e_rho[2] * rg[2];
+  }
+  return worst;
+}
+
+/***
+    Solves jac * x = b in place by Gaussian elimination with partial
+    pivoting, for the n right hand sides in the first columns of b, which
+    are replaced by the x.  Returns false if jac is singular.
+ ***/
+
+static bool
+solve6n (double jac[NQ][NQ], double b[NQ][NQ], int n)
+{
+  for (int c = 0; c < NQ; c++) {
+    int p = c;
+    for (int r = c + 1; r < NQ; r++)
+      if (fabs (jac[r][c]) > fabs (jac[p][c])) p = r;
+    if (fabs (jac[p][c]) < 1.0e-14) return false;
+    if (p != c) {
+      for (int k = 0; k < NQ; k++) {
+	double t = jac[c][k]; jac[c][k] = jac[p][k]; jac[p][k] = t;
+      }
+      for (int k = 0; k < n; k++) {
+	double t = b[c][k]; b[c][k] = b[p][k]; b[p][k] = t;
+      }
+    }
+    for (int r = c + 1; r < NQ; r++) {
+      double m = jac[r][c] / jac[c][c];
+      for (int k = c; k < NQ; k++) jac[r][k] -= m * jac[c][k];
+      for (int k = 0; k < n; k++) b[r][k] -= m * b[c][k];
+    }
+  }
+  for (int c = NQ - 1; c >= 0; c--) {
+    for (int k = 0; k < n; k++) {
+      double s = b[c][k];
+      for (int j = c + 1; j < NQ; j++) s -= jac[c][j] * b[j][k];
+      b[c][k] = s / jac[c][c];
+    }
+  }
+  return true;
+}
+
+// solve6n with the one right hand side
+static bool
+solve6 (double jac[NQ][NQ], double *b)
+{
+  double col[NQ][NQ];
+  for (int r = 0; r < NQ; r++) col[r][0] = b[r];
+  if (!solve6n (jac, col, 1)) return false;
+  for (int r = 0; r < NQ; r++) b[r] = col[r][0];
+  return true;
+}
+
+static double
+wrap_angle (double a)
+{
+  if (a > M_PI || a < -M_PI) a = remainder (a, 2.0 * M_PI);
+  return a;
+}
+
+static void
+raw_angles (const double *alpha, double *sa, double *ca)
+{
+  for (int i = 0; i < IK_SERVOS; i++) {
+    double a = (i & 1) ? -alpha[i] : alpha[i];
+    sa[i] = sin (a);
+    ca[i] = cos (a);
+  }
+}
+
+double
+fk_residual (const ik_geometry_s *geo, const double *alpha,
+	     const ik_pose_s *pose)
+{
+  double sa[IK_SERVOS], ca[IK_SERVOS], f[IK_SERVOS];
+  raw_angles (alpha, sa, ca);
+  return evaluate (geo, sa, ca, pose, f, NULL);
+}
+
+static double
+sum_sq (const double *f)
+{
+  double s = 0.0;
+  for (int i = 0; i < IK_SERVOS; i++) s += f[i] * f[i];
+  return s;
+}
+
+bool
+fk_solve (const ik_geometry_s *geo, const double *alpha,
+	  ik_pose_s *pose, fk_result_s *res)
+{
+  double sa[IK_SERVOS], ca[IK_SERVOS];
+  double f[IK_SERVOS], step[IK_SERVOS], tf[IK_SERVOS];
+  double jac[NQ][NQ], tjac[NQ][NQ];
+  bool converged = false;
+  int iter = 0;
+
+  raw_angles (alpha, sa, ca);
+  double worst = evaluate (geo, sa, ca, pose, f, jac);
+  double merit = sum_sq (f);
+
+  while (worst > FK_TOLERANCE && iter < FK_MAX_ITERATIONS) {
+    memcpy (step, f, sizeof(step));
+    if (!solve6 (jac, step)) break;
+    double lin = fmax (fmax (fabs (step[0]), fabs (step[1])), fabs (step[2]));
+    double ang = fmax (fmax (fabs (step[3]), fabs (step[4])), fabs (step[5]));
+    double scale = 1.0;
+    if (lin > FK_MAX_LINEAR_STEP) scale = FK_MAX_LINEAR_STEP / lin;
+    if (ang * scale > FK_MAX_ANGULAR_STEP) scale = FK_MAX_ANGULAR_STEP / ang;
+
+    ik_pose_s trial;
+    double tworst = worst;
+    for (int h = 0; h <= FK_MAX_HALVINGS; h++, scale *= 0.5) {
+      trial.delta_x = pose->delta_x - scale * step[0];
+      trial.delta_y = pose->delta_y - scale * step[1];
+      trial.delta_z = pose->delta_z - scale * step[2];
+      trial.phi     = wrap_angle (pose->phi   - scale * step[3]);
+      trial.theta   = wrap_angle (pose->theta - scale * step[4]);
+      trial.rho     = wrap_angle (pose->rho   - scale * step[5]);
+      tworst = evaluate (geo, sa, ca, &trial, tf, tjac);
+      if (sum_sq (tf) < merit) break;
+    }
+    iter++;
+    if (isnan (tworst) || !(sum_sq (tf) < merit)) break;	// stalled
+
+    *pose = trial;
+    worst = tworst;
+    merit = sum_sq (tf);
+    memcpy (f, tf, sizeof(f));
+    memcpy (jac, tjac, sizeof(jac));
+  }
+  converged = worst <= FK_TOLERANCE;
+
+  if (res) {
+    res->iterations = iter;
+    res->residual   = worst;
+    res->converged  = converged;
+  }
+  return converged;
+}
+
+/***
+    Eigenvalues of a symmetric 6x6 by cyclic Jacobi rotations; a is
+    destroyed.  A handful of sweeps is enough at this size.
+ ***/
+
+static void
+sym_eigenvalues (double a[NQ][NQ], double *ev)
+{
+  for (int sweep = 0; sweep < 12; sweep++) {
+    double off = 0.0, diag = 0.0;
+    for (int p = 0; p < NQ; p++) {
+      diag += a[p][p] * a[p][p];
+      for (int q = p + 1; q < NQ; q++) off += a[p][q] * a[p][q];
+    }
+    if (off <= 1.0e-22 * diag) break;
+
+    for (int p = 0; p < NQ - 1; p++) {
+      for (int q = p + 1; q < NQ; q++) {
+	if (a[p][q] == 0.0) continue;
+	double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+	double t = ((theta >= 0.0) ? 1.0 : -1.0) /
+	  (fabs (theta) + sqrt (theta * theta + 1.0));
+	double c = 1.0 / sqrt (t * t + 1.0);
+	double s = t * c;
+	for (int k = 0; k < NQ; k++) {		// columns p, q
+	  double akp = a[k][p], akq = a[k][q];
+	  a[k][p] = c * akp - s * akq;
+	  a[k][q] = s * akp + c * akq;
+	}
+	for (int k = 0; k < NQ; k++) {		// rows p, q
+	  double apk = a[p][k], aqk = a[q][k];
+	  a[p][k] = c * apk - s * aqk;
+	  a[q][k] = s * apk + c * aqk;
+	}
+      }
+    }
+  }
+  for (int k = 0; k < NQ; k++) ev[k] = a[k][k];
+}
+
+bool
+fk_jacobian (const ik_geometry_s *geo, const double *alpha,
+	     const ik_pose_s *pose, fk_jacobian_s *out)
+{
+  double sa[IK_SERVOS], ca[IK_SERVOS];
+  double f[IK_SERVOS], dfda[IK_SERVOS];
+  double twist[NQ][NQ], rhs[NQ][NQ];
+
+  raw_angles (alpha, sa, ca);
+  evaluate (geo, sa, ca, pose, f, NULL, twist, dfda);
+
+  // twist rows . (v, w) + dfda * alpha_dot = 0, per leg
+  for (int i = 0; i < NQ; i++) {
+    double sign = (i & 1) ? 1.0 : -1.0;	// -dfda, and alpha = -raw if odd
+    for (int k = 0; k < NQ; k++) rhs[i][k] = 0.0;
+    rhs[i][i] = sign * dfda[i];
+  }
+  if (!solve6n (twist, rhs, NQ)) {
+    out->sigma_min = 0.0;
+    out->sigma_max = HUGE_VAL;
+    out->cond = HUGE_VAL;
+    return false;
+  }
+  memcpy (out->J, rhs, sizeof(out->J));
+
+  double jtj[NQ][NQ], ev[NQ];
+  for (int r = 0; r < NQ; r++)
+    for (int c = r; c < NQ; c++) {
+      double s = 0.0;
+      for (int k = 0; k < NQ; k++) s += rhs[k][r] * rhs[k][c];
+      jtj[r][c] = jtj[c][r] = s;
+    }
+  sym_eigenvalues (jtj, ev);
+  double lo = ev[0], hi = ev[0];
+  for (int k = 1; k < NQ; k++) {
+    if (ev[k] < lo) lo = ev[k];
+    if (ev[k] > hi) hi = ev[k];
+  }
+  out->sigma_max = sqrt (fmax (hi, 0.0));
+  out->sigma_min = sqrt (fmax (lo, 0.0));
+  out->cond = (out->sigma_min > 0.0) ? out->sigma_max / out->sigma_min
+    : HUGE_VAL;
+  return true;
+}
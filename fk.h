@@ -0,0 +1,85 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef FK_H
+#define FK_H
+
+#include "ikbatch.h"
+
+/***
+
+    Forward kinematics: servo angles to platform pose.
+
+    Each leg contributes the residual the inverse solution is built on,
+
+	f = L - M sin (alpha) - N cos (alpha)
+
+    with L, M and N as in update_alpha () (Eq 9).  Newton-Raphson drives
+    all six to zero using the analytic 6x6 Jacobian.  The pose passed in is
+    the starting guess, so feeding back the previous frame's answer
+    typically converges in two or three iterations.
+
+ ***/
+
+#define FK_MAX_ITERATIONS	20
+#define FK_TOLERANCE		1.0e-10	// cm^2, on max |f|
+
+typedef struct {
+  int    iterations;
+  double residual;		// max |f| on return
+  bool   converged;
+} fk_result_s;
+
+/***
+    alpha[] is six servo angles with the servo::alpha sign convention.
+    pose is the warm start on entry and the solution on return; it is left
+    as the last iterate if the solve fails.  res may be NULL.
+ ***/
+
+bool fk_solve (const ik_geometry_s *geo, const double *alpha,
+	       ik_pose_s *pose, fk_result_s *res);
+
+// residuals only, for callers checking a pose against a set of angles
+double fk_residual (const ik_geometry_s *geo, const double *alpha,
+		    const ik_pose_s *pose);
+
+/***
+    Velocity Jacobian at a solved pose: platform twist, the linear velocity
+    of the platform origin (cm) and the angular velocity (rad) both in the
+    base frame, per unit of servo angle rate,
+
+	(vx vy vz wx wy wz)' = J * alpha_dot
+
+    found by differentiating the same per-leg residuals and solving the
+    6x6 system.  cond is sigma_max / sigma_min of J; it mixes cm and
+    radians, so compare it against itself rather than an absolute scale.
+    It grows without bound toward a singular pose.  Returns false, with
+    cond set to HUGE_VAL, if the pose is singular.
+ ***/
+
+typedef struct {
+  double J[IK_SERVOS][IK_SERVOS];
+  double sigma_min;
+  double sigma_max;
+  double cond;
+} fk_jacobian_s;
+
+bool fk_jacobian (const ik_geometry_s *geo, const double *alpha,
+		  const ik_pose_s *pose, fk_jacobian_s *out);
+
+#endif // FK_H
@@ -0,0 +1,196 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#include "fleet.h"
+#include "parallel.h"
+
+#define FLEET_REPORT	20		// platforms listed
+
+static bool
+fleet_line (char *text, int lineno, const ik_geometry_s *geo,
+	    const jitter_spec_s *spec, fleet_s *fleet)
+{
+  sim_instance_s inst;
+  jitter_spec_s jitter = *spec;
+  script_s *script = NULL;
+  uint64_t seed = (uint64_t)lineno;
+  char *save = NULL;
+  bool ok = true;
+
+  sim_instance_init (&inst, geo);
+  for (char *tok = strtok_r (text, " \t", &save); ok && tok;
+       tok = strtok_r (NULL, " \t", &save)) {
+    char *eq = strchr (tok, '=');
+    if (!eq) {
+      if (!inst.name.empty ()) ok = false;
+      else inst.name = tok;
+      continue;
+    }
+    *eq++ = 0;
+    if (!strcmp (tok, "geometry")) {
+      geometry_s g;
+      geometry_default (&g);
+      if (!geometry_load (eq, &g)) ok = false;
+      else {
+	ik_geometry_s ig;
+	geometry_to_ik (&g, &ig);
+	sim_instance_init (&inst, &ig);
+      }
+    }
+    else if (!strcmp (tok, "jitter"))
+      ok = jitter_spec_parse (&jitter, eq, ",");
+    else if (!strcmp (tok, "script")) {
+      if (script) delete script;
+      script = new script_s;
+      ok = script_load (eq, script);
+    }
+    else if (!strcmp (tok, "seed")) {
+      char *end;
+      seed = strtoull (eq, &end, 0);
+      ok = (end != eq && !*end);
+    }
+    else ok = false;
+  }
+
+  if (ok) {
+    if (inst.name.empty ())
+      inst.name = "line " + std::to_string (lineno);
+    if (script) {
+      fleet->scripts.push_back (script);
+      motion_script (&inst.motion, script);
+    }
+    else motion_jitter (&inst.motion, &jitter, seed);
+    fleet->inst.push_back (inst);
+  }
+  else if (script) delete script;
+  return ok;
+}
+
+bool
+fleet_load (const char *arg, const ik_geometry_s *geo,
+	    const jitter_spec_s *spec, fleet_s *fleet)
+{
+  char *end;
+  char line[1024];
+  int lineno = 0;
+  bool ok = true;
+
+  fleet_free (fleet);
+  unsigned long count = strtoul (arg, &end, 10);
+  if (end != arg && !*end) {
+    for (unsigned long i = 0; i < count; i++) {
+      sim_instance_s inst;
+      sim_instance_init (&inst, geo);
+      inst.name = "copy " + std::to_string (i + 1);
+      motion_jitter (&inst.motion, spec, i + 1);
+      fleet->inst.push_back (inst);
+    }
+    return true;
+  }
+
+  FILE *fp = fopen (arg, "r");
+  if (!fp) {
+    perror (arg);
+    return false;
+  }
+  while (ok && fgets (line, sizeof(line), fp)) {
+    lineno++;
+    char *hash = strchr (line, '#');
+    if (hash) *hash = 0;
+    line[strcspn (line, "\r\n")] = 0;
+    if (!line[strspn (line, " \t")]) continue;
+    if (!fleet_line (line, lineno, geo, spec, fleet)) {
+      fprintf (stderr, "%s:%d: bad platform\n", arg, lineno);
+      ok = false;
+    }
+  }
+  fclose (fp);
+
+  if (ok && fleet->inst.empty ()) {
+    fprintf (stderr, "%s: no platforms\n", arg);
+    ok = false;
+  }
+  if (!ok) fleet_free (fleet);
+  return ok;
+}
+
+void
+fleet_free (fleet_s *fleet)
+{
+  fleet->inst.clear ();
+  for (size_t i = 0; i < fleet->scripts.size (); i++)
+    delete fleet->scripts[i];
+  fleet->scripts.clear ();
+}
+
+int
+fleet_run (fleet_s *fleet, double rate, double seconds)
+{
+  size_t n = fleet->inst.size ();
+  double dt = 1.0 / rate;
+  uint64_t steps = (uint64_t)(seconds * rate + 0.5);
+  struct timespec start, end;
+
+  if (n == 0) return -1;
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  parallel_for (n, 1, [&](size_t begin, size_t end, int) {
+      for (size_t i = begin; i < end; i++)
+	sim_instance_run (&fleet->inst[i], dt, steps);
+    });
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  double secs = (double)(end.tv_sec - start.tv_sec) +
+    1.0e-9 * (double)(end.tv_nsec - start.tv_nsec);
+
+  uint64_t total = 0, held = 0;
+  for (size_t i = 0; i < n; i++) {
+    total += fleet->inst[i].steps;
+    held += fleet->inst[i].held;
+  }
+  int nthreads = std::min ((size_t)parallel_threads (), n);
+
+  fprintf (stdout, "fleet:     %zu platforms, %g sec each at %g Hz\n",
+	   n, (double)steps * dt, rate);
+  fprintf (stdout, "time:      %.3f sec, %d threads\n", secs, nthreads);
+  fprintf (stdout, "steps:     %llu, %.0f steps/sec, %.0f per thread, "
+	   "%.0f x real time over the fleet\n", (unsigned long long)total,
+	   (double)total / secs, (double)total / secs / nthreads,
+	   (double)steps * dt * (double)n / secs);
+  fprintf (stdout, "held:      %llu steps (%.3f%%) out of reach\n",
+	   (unsigned long long)held,
+	   total ? 100.0 * (double)held / (double)total : 0.0);
+
+  fprintf (stdout, "\n%-20s %-7s %8s\n", "platform", "motion", "held");
+  for (size_t i = 0; i < n && i < FLEET_REPORT; i++) {
+    const sim_instance_s *inst = &fleet->inst[i];
+    fprintf (stdout, "%-20s %-7s %7.3f%%\n", inst->name.c_str (),
+	     (inst->motion.kind == MOTION_SCRIPT) ? "script" : "jitter",
+	     inst->steps ? 100.0 * (double)inst->held / (double)inst->steps
+	     : 0.0);
+  }
+  if (n > FLEET_REPORT)
+    fprintf (stdout, "... and %zu more\n", n - FLEET_REPORT);
+  return 0;
+}
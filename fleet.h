@@ -0,0 +1,66 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef FLEET_H
+#define FLEET_H
+
+#include <vector>
+
+#include "instance.h"
+
+/***
+
+    Many platforms in one process.  A fleet file has one platform a line,
+    a name and then any of
+
+	geometry=file	geometry file, default the --geometry one
+	jitter=s	hardware4 jitter spec as for --jitter, commas between
+			the keys, on top of the --jitter one
+	script=file	a motion script (script.h) instead of jitter
+	seed=n		jitter generator seed, default the line's number
+
+    with # comments, e.g.
+
+	rig1 geometry=long_legs.geo jitter=jdx=2,jroll=5
+	rig2 script=dance.script
+
+    A bare number instead of a file name is that many copies of the
+    default platform, each jittering with its own seed.
+
+    fleet_run () steps every platform through seconds of motion at rate
+    steps a second.  Platforms are independent, so each is one work item;
+    parallel_for () hands them out to the workers as they come free, which
+    keeps the cores busy when the platforms cost different amounts.
+
+ ***/
+
+typedef struct {
+  std::vector<sim_instance_s> inst;
+  std::vector<script_s *>     scripts;	// owned, shared by instances
+} fleet_s;
+
+// Leaves fleet empty and reports to stderr if the file is bad.
+bool fleet_load (const char *arg, const ik_geometry_s *geo,
+		 const jitter_spec_s *spec, fleet_s *fleet);
+
+void fleet_free (fleet_s *fleet);
+
+// prints the report to stdout; returns 0, or -1 if the fleet is empty
+int  fleet_run (fleet_s *fleet, double rate, double seconds);
+
+#endif // FLEET_H
@@ -0,0 +1,154 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "geometry.h"
+
+void
+geometry_default (geometry_s *geo)
+{
+  static const double base[GEOMETRY_SERVOS] =
+    { B0_ANGLE, B1_ANGLE, B2_ANGLE, B3_ANGLE, B4_ANGLE, B5_ANGLE };
+  static const double plat[GEOMETRY_SERVOS] =
+    { P0_ANGLE, P1_ANGLE, P2_ANGLE, P3_ANGLE, P4_ANGLE, P5_ANGLE };
+  static const double shaft[GEOMETRY_SERVOS] =
+    { SA0, SA1, SA2, SA3, SA4, SA5 };
+
+  geo->base_radius     = DEFAULT_BASE_RADIUS;
+  geo->platform_radius = DEFAULT_PLATFORM_RADIUS;
+  geo->arm_length      = DEFAULT_ARM_LENGTH;
+  geo->leg_length      = DEFAULT_LEG_LENGTH;
+  memcpy (geo->base_angle,     base,  sizeof(base));
+  memcpy (geo->platform_angle, plat,  sizeof(plat));
+  memcpy (geo->shaft_angle,    shaft, sizeof(shaft));
+}
+
+static bool
+parse_values (char *rest, double *vals, int want)
+{
+  char *end;
+  for (int i = 0; i < want; i++) {
+    vals[i] = strtod (rest, &end);
+    if (end == rest) return false;
+    rest = end;
+  }
+  while (*rest == ' ' || *rest == '\t') rest++;
+  return *rest == 0;
+}
+
+bool
+geometry_load (const char *filename, geometry_s *geo)
+{
+  static const struct {
+    const char *key;
+    size_t      offset;
+    int         count;
+  } keys[] = {
+    { "base_radius",     offsetof (geometry_s, base_radius),     1 },
+    { "platform_radius", offsetof (geometry_s, platform_radius), 1 },
+    { "arm_length",      offsetof (geometry_s, arm_length),      1 },
+    { "leg_length",      offsetof (geometry_s, leg_length),      1 },
+    { "base_angles",     offsetof (geometry_s, base_angle),
+      GEOMETRY_SERVOS },
+    { "platform_angles", offsetof (geometry_s, platform_angle),
+      GEOMETRY_SERVOS },
+    { "shaft_angles",    offsetof (geometry_s, shaft_angle),
+      GEOMETRY_SERVOS },
+  };
+  geometry_s lcl = *geo;
+  char line[512];
+  int lineno = 0;
+  bool ok = true;
+
+  FILE *fp = fopen (filename, "r");
+  if (!fp) {
+    perror (filename);
+    return false;
+  }
+
+  while (ok && fgets (line, sizeof(line), fp)) {
+    lineno++;
+    char *hash = strchr (line, '#');
+    if (hash) *hash = 0;
+    line[strcspn (line, "\r\n")] = 0;
+
+    char *key = line + strspn (line, " \t");
+    if (!*key) continue;
+    char *rest = key + strcspn (key, " \t");
+    if (*rest) *rest++ = 0;
+
+    int k;
+    for (k = 0; k < (int)(sizeof(keys) / sizeof(keys[0])); k++)
+      if (!strcmp (key, keys[k].key)) break;
+    if (k == (int)(sizeof(keys) / sizeof(keys[0]))) {
+      fprintf (stderr, "%s:%d: unknown key %s\n", filename, lineno, key);
+      ok = false;
+    }
+    else if (!parse_values (rest, (double *)((char *)&lcl + keys[k].offset),
+			    keys[k].count)) {
+      fprintf (stderr, "%s:%d: %s wants %d number%s\n", filename, lineno,
+	       key, keys[k].count, (keys[k].count == 1) ? "" : "s");
+      ok = false;
+    }
+  }
+  fclose (fp);
+
+  if (ok && (lcl.base_radius <= 0.0 || lcl.platform_radius <= 0.0 ||
+	     lcl.arm_length <= 0.0 || lcl.leg_length <= 0.0)) {
+    fprintf (stderr, "%s: radii and lengths must be positive\n", filename);
+    ok = false;
+  }
+
+  if (ok) *geo = lcl;
+  return ok;
+}
+
+static void
+save_values (FILE *fp, const char *key, const double *vals, int count)
+{
+  fprintf (fp, "%-16s", key);
+  for (int i = 0; i < count; i++) fprintf (fp, " %.9g", vals[i]);
+  fprintf (fp, "\n");
+}
+
+bool
+geometry_save (const char *filename, const geometry_s *geo)
+{
+  FILE *fp = fopen (filename, "w");
+  if (!fp) {
+    perror (filename);
+    return false;
+  }
+  fprintf (fp, "# Stewart platform geometry, cm and radians\n");
+  save_values (fp, "base_radius",     &geo->base_radius,     1);
+  save_values (fp, "platform_radius", &geo->platform_radius, 1);
+  save_values (fp, "arm_length",      &geo->arm_length,      1);
+  save_values (fp, "leg_length",      &geo->leg_length,      1);
+  save_values (fp, "base_angles",     geo->base_angle,     GEOMETRY_SERVOS);
+  save_values (fp, "platform_angles", geo->platform_angle, GEOMETRY_SERVOS);
+  save_values (fp, "shaft_angles",    geo->shaft_angle,    GEOMETRY_SERVOS);
+  if (fclose (fp) != 0) {
+    perror (filename);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,88 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <math.h>
+
+/************* default platform description ***************/
+
+#define DEFAULT_ARM_LENGTH	 2.0
+#define DEFAULT_LEG_LENGTH	 9.0
+
+#define B0_ANGLE  2.69159
+#define B1_ANGLE -2.69159
+#define B2_ANGLE -1.4972
+#define B3_ANGLE -0.597197
+#define B4_ANGLE  0.597197
+#define B5_ANGLE  1.4972
+#define DEFAULT_BASE_RADIUS	7.5
+
+#define SA0	M_PI_2			// radians shaft angle
+#define SA1	M_PI_2
+#define SA2	(-M_PI / 6.0)
+#define SA3	(-M_PI / 6.0)
+#define SA4	(7.0 * M_PI / 6.0)
+#define SA5	(7.0 * M_PI / 6.0)
+
+#define P0_ANGLE  2.54
+#define P1_ANGLE -2.54
+#define P2_ANGLE -1.65
+#define P3_ANGLE -0.44
+#define P4_ANGLE  0.44
+#define P5_ANGLE  1.65
+#define DEFAULT_PLATFORM_RADIUS	1.75
+
+/***
+
+    Geometry files are plain text, one key per line, # to end of line is a
+    comment.  Lengths are in cm, angles in radians.  Keys that are left out
+    keep their default values.
+
+	base_radius	7.5
+	platform_radius	1.75
+	arm_length	2.0
+	leg_length	9.0
+	base_angles	 2.69159 -2.69159 -1.4972 -0.597197 0.597197 1.4972
+	platform_angles	 2.54 -2.54 -1.65 -0.44 0.44 1.65
+	shaft_angles	 1.5708 1.5708 -0.5236 -0.5236 3.6652 3.6652
+
+ ***/
+
+#define GEOMETRY_SERVOS 6
+
+typedef struct {
+  double base_radius;
+  double platform_radius;
+  double arm_length;
+  double leg_length;
+  double base_angle[GEOMETRY_SERVOS];
+  double platform_angle[GEOMETRY_SERVOS];
+  double shaft_angle[GEOMETRY_SERVOS];
+} geometry_s;
+
+void geometry_default (geometry_s *geo);
+
+// Leaves geo untouched and reports to stderr if the file is bad.
+bool geometry_load (const char *filename, geometry_s *geo);
+
+// Writes every key, in the format geometry_load () reads.
+bool geometry_save (const char *filename, const geometry_s *geo);
+
+#endif // GEOMETRY_H
@@ -0,0 +1 @@
+../ikfixed.h
\ No newline at end of file
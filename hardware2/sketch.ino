@@ -17,10 +17,12 @@ Stewart. If not, see <https://www.gnu.org/licenses/>.
  ***/
 
 #include <Servo.h>
-#include <BasicLinearAlgebra.h>
 #include <LiquidCrystal.h>
 #include <ezButton.h>
 
+#include "ikcore.h"		// symlinks to ../ikcore.h and ../ikfixed.h,
+#include "ikfixed.h"		// shared with the sim
+
 /***  Operational parameters ***/
 
 #define MAX_POSITIONAL_JITTER  20    // millimetres
@@ -126,64 +128,10 @@ double onset_time    = 0.2;
 double relax_time    = 1.0;
 double interval_time = 3.2;
  
-// x-axis
-static BLA::Matrix<4,4> rotatePitch(double r)
-{
-  BLA::Matrix<4,4> mtx = {
-    1.0,     0.0,    0.0,        0.0,
-    0.0,     cos(r), -sin(r),    0.0,
-    0.0,     sin(r),  cos(r),    0.0,
-    0.0,     0.0,     0.0,       1.0
-  };
-  return mtx;
-}
-
-// y-axis
-static BLA::Matrix<4,4> rotateRoll(double r)
-{
-  BLA::Matrix<4,4> mtx = {
-    cos(r),  0.0, sin(r), 0.0,
-    0.0,     1.0, 0.0,    0.0,
-    -sin(r), 0.0, cos(r), 0.0,
-    0.0,     0.0, 0.0,    1.0
-  };
-  return mtx;
-}
-
-// z-axis
-static BLA::Matrix<4,4> rotateYaw(double r)
-{
-  BLA::Matrix<4,4> mtx = {
-    cos(r),  -sin(r), 0.0, 0.0,
-    sin(r),   cos(r), 0.0, 0.0,
-    0.0,      0.0,    1.0, 0.0,
-    0.0,      0.0,    0.0, 1.0
-  };
-  return mtx;
-}
-
-#if 0
-static void showVector(char *t, BLA::Matrix<4> v)
-{
-  Serial.println(t);
-  Serial << v;
-  Serial.print("\n");
-}
-
-static void showMatrix(char *t, BLA::Matrix<4,4> v)
-{
-  Serial.println(t);
-  Serial << v;
-  Serial.print("\n");
-}
-#endif
-
-static double length(BLA::Matrix<4> v)
-{
-  return sqrt((v(0) * v(0)) +
-                  (v(1) * v(1)) +
-                  (v(2) * v(2)));
-}
+/* No FPU on the Mega, so the IK runs in Q16.16 fixed point; float would
+   do too, at about five times the cost. */
+typedef ikc_fixed ik_scalar;
+ikc_geometry<ik_scalar> ikGeo;
 
 #define R2D(r) ((r / M_PI) * 180.0)
 
@@ -193,56 +141,21 @@ double pincr;
 
 static void update_alpha()
 {
-
-  BLA::Matrix<4,4> pRot = rotatePitch(myPlatform.pitch);
-  BLA::Matrix<4,4> rRot = rotatePitch(myPlatform.roll);
-  BLA::Matrix<4,4> yRot = rotateYaw(myPlatform.yaw);
-  BLA::Matrix<4,4> cRot = pRot * rRot * yRot;
-
-  //double alpha_stage[6];
-  bool is_valid = true;
-
-  for (int i = 0; i < NUM_SERVOS; i++) {
-    // Eq 3
-    BLA::Matrix<4> P0 = {myPlatform.dx,
-                        myPlatform.dy + h0,
-                        myPlatform.dz, 1.0}; 
-    
-    BLA::Matrix<4> P1 = {myPlatform.anchor[i].x,
-                         myPlatform.anchor[i].y,
-                         myPlatform.anchor[i].z, 
-                         1.0};
-                                      
-    BLA::Matrix<4> P  = P0 +  (cRot * P1);
-
-    BLA::Matrix<4> B = {myBase.pos[i].x,
-                        0.0,
-                        myBase.pos[i].y, 
-                        1.0};
-    BLA::Matrix<4> deltaPB = P - B;
-    
-    // Eq 9
-    double beta = (i & 1) ? (M_PI/6.0) : (-M_PI/6.0);
-  
-    double l = length (deltaPB);
-    //Serial.print(i); Serial.print(" l = "); Serial.println(l);
-
-    double L  =
-      (l * l) - ((LEG_LENGTH * LEG_LENGTH) - 
-                 (ARM_LENGTH * ARM_LENGTH));
-
-    double M  = 2.0 * ARM_LENGTH * deltaPB(1);
-    double N  = 2.0 * ARM_LENGTH *
-      (deltaPB(0) * cos (beta) + deltaPB(2) * sin (beta));
-    N = -fabs (N);
-    double arg = L / sqrt ((M * M) + (N * N));
-    double alphaX = asin (arg) - atan2 (N, M);
-    if (isnan (alphaX)) {
-      is_valid = false;
-      break;
-    }
-    else {
-      alpha[i] = R2D((i&1) ? alphaX : alphaX);
+  ikc_pose<ik_scalar> pose;
+  pose.delta_x = ik_scalar (myPlatform.dx);
+  pose.delta_y = ik_scalar (myPlatform.dy);
+  pose.delta_z = ik_scalar (myPlatform.dz);
+  pose.phi     = ik_scalar (myPlatform.yaw);
+  pose.theta   = ik_scalar (myPlatform.pitch);
+  pose.rho     = ik_scalar (myPlatform.roll);
+
+  ik_scalar alpha_stage[NUM_SERVOS];
+  if (ikc_solve (&ikGeo, &pose, alpha_stage)) {
+    // this board has always been driven with the raw Eq 9 angle
+    for (int i = 0; i < NUM_SERVOS; i++) {
+      double raw = ikc_to_double (alpha_stage[i]);
+      if (i & 1) raw = -raw;
+      alpha[i] = R2D(raw);
     }
   }
 }
@@ -430,19 +343,19 @@ void setup() {
   digitalWrite(POSITION_LED_PIN, LOW);
   digitalWrite(TIME_LED_PIN,     LOW);
 
-  h0 = 0.0;					// Eq 10
-  for (int i = 0; i < 6; i++) {
+  for (int i = 0; i < NUM_SERVOS; i++) {
     incr[i] = ((double)random(-1000, 1000))/500.0;
-    double xp = myPlatform.anchor[i].x;
-    double yp = myPlatform.anchor[i].y;
-    double xb = myBase.pos[i].x;
-    double yb = myBase.pos[i].y;
-    h0 += sqrt ( (LEG_LENGTH * LEG_LENGTH) +
-		    (ARM_LENGTH * ARM_LENGTH) -
-		  ( ((xp - xb) * (xp - xb)) +
-		    ((yp - yb) * (yp - yb))));
+    ikGeo.base_x[i]   = ik_scalar (myBase.pos[i].x);
+    ikGeo.base_z[i]   = ik_scalar (myBase.pos[i].y);
+    ikGeo.anchor_x[i] = ik_scalar (myPlatform.anchor[i].x);
+    ikGeo.anchor_y[i] = ik_scalar (myPlatform.anchor[i].y);
+    ikGeo.anchor_z[i] = ik_scalar (myPlatform.anchor[i].z);
   }
-  h0 /= 6.0;
+  ikGeo.arm_length = ik_scalar (ARM_LENGTH);
+  ikGeo.leg_length = ik_scalar (LEG_LENGTH);
+  ikc_prepare (&ikGeo);
+  ikGeo.h0 = ikc_h0 (&ikGeo);			// Eq 10
+  h0 = ikc_to_double (ikGeo.h0);
   update_alpha ();
   pincr = ((double)random(1000))/10000.0;
 }
@@ -0,0 +1 @@
+../geometry.h
\ No newline at end of file
@@ -18,6 +18,13 @@ Javascript being served to the browser.
 #include <WiFiNINA.h>
 #include <JOAAT.h>
 
+/* The inverse kinematics and the default platform dimensions are the
+   simulator's own; these are symlinks to ../ikcore.h, ../ikfixed.h and
+   ../geometry.h so that there is only one copy of each. */
+#include "geometry.h"
+#include "ikcore.h"
+#include "ikfixed.h"
+
 /********** global variables ***********/
 
 /* An instantiation of a class that generates hashes */
@@ -84,6 +91,14 @@ typedef struct {
 /* A pointer to an unallocated array of the parameters. */
 parm_s *parms = nullptr;
 
+/* Platform geometry in the form the IK wants, and the latest servo angles
+   in radians.  The SAMD21 has no FPU, so the IK runs in Q16.16 fixed point,
+   about five times quicker than soft float (see ikbench in the simulator
+   directory).  float works here too, just slower. */
+typedef ikc_fixed ik_scalar;
+ikc_geometry<ik_scalar> ikGeo;
+ik_scalar alpha[IKC_SERVOS];
+
 
 /******** subroutines and functions *********/
 
@@ -209,6 +224,58 @@ void *bsearch (const void *key, const void *base0,
 }
 
 
+/* look a parameter up by name, the same way the update handler does */
+
+double parm_value (const char *name)
+{
+  uint32_t hash = joaat.encode_str (JOAAT_STR (name));
+  void *res = bsearch (reinterpret_cast<void *>(hash), parms,
+		       lbl_cnt, sizeof(parm_s), cmp_parm_str);
+  return (res != nullptr) ? ((parm_s *)res)->val : 0.0;
+}
+
+
+/* set up the geometry, from the simulator defaults */
+
+void setup_geometry ()
+{
+  static const double base[IKC_SERVOS] =
+    { B0_ANGLE, B1_ANGLE, B2_ANGLE, B3_ANGLE, B4_ANGLE, B5_ANGLE };
+  static const double plat[IKC_SERVOS] =
+    { P0_ANGLE, P1_ANGLE, P2_ANGLE, P3_ANGLE, P4_ANGLE, P5_ANGLE };
+
+  for (int i = 0; i < IKC_SERVOS; i++) {
+    ikGeo.base_x[i]   = ik_scalar (DEFAULT_BASE_RADIUS * cos (base[i]));
+    ikGeo.base_z[i]   = ik_scalar (DEFAULT_BASE_RADIUS * sin (base[i]));
+    ikGeo.anchor_x[i] = ik_scalar (DEFAULT_PLATFORM_RADIUS * cos (plat[i]));
+    ikGeo.anchor_y[i] = ik_scalar (0);
+    ikGeo.anchor_z[i] = ik_scalar (DEFAULT_PLATFORM_RADIUS * sin (plat[i]));
+  }
+  ikGeo.arm_length = ik_scalar (DEFAULT_ARM_LENGTH);
+  ikGeo.leg_length = ik_scalar (DEFAULT_LEG_LENGTH);
+  ikc_prepare (&ikGeo);
+  ikGeo.h0 = ikc_h0 (&ikGeo);
+}
+
+
+/* work out the servo angles for the position parameters.  Leaves alpha
+   alone and returns false if the platform can't get there. */
+
+#define D2R(d) ((d) * (M_PI / 180.0))
+
+bool update_alpha ()
+{
+  ikc_pose<ik_scalar> pose;
+  pose.delta_x = ik_scalar (parm_value ("pdx"));
+  pose.delta_y = ik_scalar (parm_value ("pdy"));
+  pose.delta_z = ik_scalar (parm_value ("pdz"));
+  pose.phi     = ik_scalar (D2R (parm_value ("pyaw")));
+  pose.theta   = ik_scalar (D2R (parm_value ("ppitch")));
+  pose.rho     = ik_scalar (D2R (parm_value ("proll")));
+  return ikc_solve (&ikGeo, &pose, alpha);
+}
+
+
 /* a utility Javascript function that sets the values of HTML entities in
 the browser with the current parameter values known to the Arduino. */
 
@@ -569,6 +636,8 @@ void setup()
 
   qsort (parms, sizeof(parm_s), 0, lbl_cnt - 1, cmp_parm);
 
+  setup_geometry ();
+  update_alpha ();
 }
 
 
@@ -629,6 +698,17 @@ void loop() {
 		    ((parm_s *)res)->val = val;
 		    Serial.println (vbl + " = "
 				    + String (((parm_s *)res)->val, 2));
+
+		    // and, if it moved the platform, the servo angles
+		    if (vbl.startsWith ("p")) {
+		      if (update_alpha ()) {
+			String angles = "alpha";
+			for (int i = 0; i < IKC_SERVOS; i++)
+			  angles += " " + String (ikc_to_double (alpha[i]), 4);
+			Serial.println (angles);
+		      }
+		      else Serial.println ("out of reach");
+		    }
 		  }
 		}
 	      }
@@ -0,0 +1 @@
+../ikcore.h
\ No newline at end of file
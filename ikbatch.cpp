@@ -0,0 +1,104 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#include <math.h>
+#include <stdio.h>
+
+#include "ikbatch.h"
+
+void
+ik_geometry_prepare (ik_geometry_s *geo)
+{
+  ikc_prepare (geo);
+}
+
+size_t
+ik_batch_scalar (const ik_geometry_s *geo, const ik_pose_s *poses,
+		 double *alphas, unsigned char *valid, size_t count)
+{
+  size_t nvalid = 0;
+  for (size_t i = 0; i < count; i++) {
+    double *a = &alphas[i * IK_SERVOS];
+    bool is_valid = ikc_solve (geo, &poses[i], a);
+    if (is_valid) nvalid++;
+    else {
+      for (int s = 0; s < IK_SERVOS; s++) a[s] = NAN;
+    }
+    if (valid) valid[i] = is_valid ? 1 : 0;
+  }
+  return nvalid;
+}
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define IKB_WIDTH	2
+#define IKB_NAME	ik_batch_sse2
+#define IKB_SQRT(v)	((ikb_vd)_mm_sqrt_pd ((__m128d)(v)))
+#include "ikbatch_kernel.h"
+#else
+size_t
+ik_batch_sse2 (const ik_geometry_s *geo, const ik_pose_s *poses,
+	       double *alphas, unsigned char *valid, size_t count)
+{
+  return ik_batch_scalar (geo, poses, alphas, valid, count);
+}
+#endif
+
+bool
+ik_batch_have_sse2 ()
+{
+#ifdef __SSE2__
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool
+ik_batch_have_avx2 ()
+{
+#if defined (__x86_64__) || defined (__i386__)
+  static int have = -1;
+  if (have < 0) {
+    __builtin_cpu_init ();
+    have = __builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma");
+  }
+  return have;
+#else
+  return false;
+#endif
+}
+
+const char *
+ik_batch_isa ()
+{
+  if (ik_batch_have_avx2 ()) return "avx2";
+  if (ik_batch_have_sse2 ()) return "sse2";
+  return "scalar";
+}
+
+size_t
+ik_batch (const ik_geometry_s *geo, const ik_pose_s *poses,
+	  double *alphas, unsigned char *valid, size_t count)
+{
+  if (ik_batch_have_avx2 ())
+    return ik_batch_avx2 (geo, poses, alphas, valid, count);
+  if (ik_batch_have_sse2 ())
+    return ik_batch_sse2 (geo, poses, alphas, valid, count);
+  return ik_batch_scalar (geo, poses, alphas, valid, count);
+}
@@ -0,0 +1,62 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef IKBATCH_H
+#define IKBATCH_H
+
+#include <stddef.h>
+
+#include "ikcore.h"
+
+/***
+
+    Batched inverse kinematics.  Solves the same equations as ikc_solve (),
+    which update_alpha () in stewart.cpp uses, but for an array of poses at
+    a time.  Results are written six per pose, in servo order and with the
+    same sign convention as servo::alpha.  A pose that cannot be reached
+    gets six NaNs and a zero in valid[].
+
+ ***/
+
+#define IK_SERVOS IKC_SERVOS
+
+// the double precision instances of the shared core, see ikcore.h
+typedef ikc_pose<double>     ik_pose_s;
+typedef ikc_geometry<double> ik_geometry_s;
+
+void ik_geometry_prepare (ik_geometry_s *geo);
+
+/***
+    All variants return the number of reachable poses.  valid may be NULL.
+    ik_batch () picks the widest kernel the cpu supports.
+ ***/
+
+size_t ik_batch (const ik_geometry_s *geo, const ik_pose_s *poses,
+		 double *alphas, unsigned char *valid, size_t count);
+size_t ik_batch_scalar (const ik_geometry_s *geo, const ik_pose_s *poses,
+			double *alphas, unsigned char *valid, size_t count);
+size_t ik_batch_sse2 (const ik_geometry_s *geo, const ik_pose_s *poses,
+		      double *alphas, unsigned char *valid, size_t count);
+size_t ik_batch_avx2 (const ik_geometry_s *geo, const ik_pose_s *poses,
+		      double *alphas, unsigned char *valid, size_t count);
+
+bool ik_batch_have_sse2 ();
+bool ik_batch_have_avx2 ();
+const char *ik_batch_isa ();
+
+#endif // IKBATCH_H
@@ -0,0 +1,36 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+// Built with $(AVX2_CFLAGS); only ever called when ik_batch_have_avx2 ().
+
+#include "ikbatch.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#define IKB_WIDTH	4
+#define IKB_NAME	ik_batch_avx2
+#define IKB_SQRT(v)	((ikb_vd)_mm256_sqrt_pd ((__m256d)(v)))
+#include "ikbatch_kernel.h"
+#else
+size_t
+ik_batch_avx2 (const ik_geometry_s *geo, const ik_pose_s *poses,
+	       double *alphas, unsigned char *valid, size_t count)
+{
+  return ik_batch_sse2 (geo, poses, alphas, valid, count);
+}
+#endif
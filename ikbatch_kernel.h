@@ -0,0 +1,227 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+/***
+
+    Vector IK kernel, written once with gcc vector extensions and compiled
+    once per instruction set.  The including file defines
+
+	IKB_WIDTH	doubles per vector (2 for sse2, 4 for avx2)
+	IKB_NAME	name of the generated batch function
+	IKB_SQRT(v)	lane-wise square root
+
+    and is compiled with the matching -m flags.  Lanes are poses; the six
+    servos are walked in an unrolled loop so the rotation is built once per
+    group of poses.  sin, cos, asin and atan2 are evaluated in-lane with the
+    fdlibm/cephes polynomials, so no lane ever drops back to libm.
+
+ ***/
+
+#include <math.h>
+
+namespace {
+
+typedef double ikb_vd __attribute__ ((vector_size (IKB_WIDTH * 8)));
+typedef long long ikb_vi __attribute__ ((vector_size (IKB_WIDTH * 8)));
+
+static inline ikb_vd
+ikb_splat (double v)
+{
+  ikb_vd r;
+  for (int k = 0; k < IKB_WIDTH; k++) r[k] = v;
+  return r;
+}
+
+static inline ikb_vd
+ikb_abs (ikb_vd x)
+{
+  return (ikb_vd)((ikb_vi)x & ~(ikb_vi)ikb_splat (-0.0));
+}
+
+static inline ikb_vd
+ikb_round (ikb_vd x)		// nearest integer, |x| < 2^51
+{
+  const ikb_vd magic = ikb_splat (6755399441055744.0);
+  return (x + magic) - magic;
+}
+
+static inline void
+ikb_sincos (ikb_vd x, ikb_vd *sp, ikb_vd *cp)
+{
+  // Cody-Waite reduction by pi/2, then fdlibm kernels on [-pi/4, pi/4]
+  ikb_vd q = ikb_round (x * ikb_splat (M_2_PI));
+  ikb_vd r = x - q * ikb_splat (1.57079632673412561417e+00);
+  r -= q * ikb_splat (6.07710050630396597660e-11);
+  r -= q * ikb_splat (2.02226624879595063154e-21);
+  ikb_vd z = r * r;
+
+  ikb_vd ps = ikb_splat (1.58969099521155010221e-10);
+  ps = ps * z + ikb_splat (-2.50507602534068634195e-08);
+  ps = ps * z + ikb_splat (2.75573137070700676789e-06);
+  ps = ps * z + ikb_splat (-1.98412698298579493134e-04);
+  ps = ps * z + ikb_splat (8.33333333332248946124e-03);
+  ps = ps * z + ikb_splat (-1.66666666666666324348e-01);
+  ikb_vd sr = r + r * z * ps;
+
+  ikb_vd pc = ikb_splat (-1.13596475577881948265e-11);
+  pc = pc * z + ikb_splat (2.08757232129817482790e-09);
+  pc = pc * z + ikb_splat (-2.75573143513906633035e-07);
+  pc = pc * z + ikb_splat (2.48015872894767294178e-05);
+  pc = pc * z + ikb_splat (-1.38888888888741095749e-03);
+  pc = pc * z + ikb_splat (4.16666666666666019037e-02);
+  ikb_vd cr = ikb_splat (1.0) - ikb_splat (0.5) * z + z * z * pc;
+
+  ikb_vi qi = __builtin_convertvector (q, ikb_vi);
+  ikb_vi swap = (qi & 1) != 0;
+  ikb_vd s = swap ? cr : sr;
+  ikb_vd c = swap ? sr : cr;
+  *sp = ((qi & 2) != 0) ? -s : s;
+  *cp = (((qi + 1) & 2) != 0) ? -c : c;
+}
+
+static inline ikb_vd
+ikb_atan (ikb_vd x)
+{
+  // cephes atan: reduce to |x| <= 0.66, then a 4/5 rational
+  const double T3P8 = 2.41421356237309504880;
+  const double MOREBITS = 6.123233995736765886130e-17;
+  ikb_vi neg = (ikb_vi)x < 0;
+  ikb_vd a = ikb_abs (x);
+  ikb_vi big = a > ikb_splat (T3P8);
+  ikb_vi mid = (a > ikb_splat (0.66)) & ~big;
+  ikb_vd y0 = big ? ikb_splat (M_PI_2) : (mid ? ikb_splat (M_PI_4)
+					  : ikb_splat (0.0));
+  ikb_vd xr = big ? ikb_splat (-1.0) / a
+    : (mid ? (a - ikb_splat (1.0)) / (a + ikb_splat (1.0)) : a);
+  ikb_vd more = big ? ikb_splat (MOREBITS) : (mid ? ikb_splat (0.5 * MOREBITS)
+					      : ikb_splat (0.0));
+  ikb_vd z = xr * xr;
+  ikb_vd p = ikb_splat (-8.750608600031904122785E-1);
+  p = p * z + ikb_splat (-1.615753718733365076637E1);
+  p = p * z + ikb_splat (-7.500855792314704667340E1);
+  p = p * z + ikb_splat (-1.228866684490136173410E2);
+  p = p * z + ikb_splat (-6.485021904942025371773E1);
+  ikb_vd qq = z + ikb_splat (2.485846490142306297962E1);
+  qq = qq * z + ikb_splat (1.650270098316988542046E2);
+  qq = qq * z + ikb_splat (4.328810604912902668951E2);
+  qq = qq * z + ikb_splat (4.853903996359136964868E2);
+  qq = qq * z + ikb_splat (1.945506571482613964425E2);
+  ikb_vd y = y0 + (xr * z * p / qq + xr) + more;
+  return neg ? -y : y;
+}
+
+static inline ikb_vd
+ikb_atan2 (ikb_vd y, ikb_vd x)
+{
+  // sign bits rather than < 0 so that -0.0 lands where libm puts it
+  ikb_vi yneg = (ikb_vi)y < 0;
+  ikb_vi xneg = (ikb_vi)x < 0;
+  ikb_vd q = (y == ikb_splat (0.0)) ? ikb_splat (0.0) : y / x;
+  ikb_vd w = xneg ? (yneg ? ikb_splat (-M_PI) : ikb_splat (M_PI))
+    : ikb_splat (0.0);
+  ikb_vd r = w + ikb_atan (q);
+  return ((y == ikb_splat (0.0)) & ~xneg) ? y : r;
+}
+
+}	// anonymous namespace
+
+size_t
+IKB_NAME (const ik_geometry_s *geo, const ik_pose_s *poses,
+	  double *alphas, unsigned char *valid, size_t count)
+{
+  size_t nvalid = 0;
+  size_t i = 0;
+  const ikb_vd h0 = ikb_splat (geo->h0);
+  const ikb_vd two_arm = ikb_splat (geo->two_arm);
+  const ikb_vd leg_arm = ikb_splat (geo->leg_arm);
+  const ikb_vd one = ikb_splat (1.0);
+  const ikb_vd zero = ikb_splat (0.0);
+
+  for (; i + IKB_WIDTH <= count; i += IKB_WIDTH) {
+    ikb_vd dx, dy, dz, phi, theta, rho;
+    for (int k = 0; k < IKB_WIDTH; k++) {
+      const ik_pose_s *p = &poses[i + k];
+      dx[k]    = p->delta_x;
+      dy[k]    = p->delta_y;
+      dz[k]    = p->delta_z;
+      phi[k]   = p->phi;
+      theta[k] = p->theta;
+      rho[k]   = p->rho;
+    }
+
+    // Eq 1, xrot (theta) * yrot (rho) * zrot (phi), expanded
+    ikb_vd sx, cx, sy, cy, sz, cz;
+    ikb_sincos (theta, &sx, &cx);
+    ikb_sincos (rho,   &sy, &cy);
+    ikb_sincos (phi,   &sz, &cz);
+    ikb_vd r00 = cy * cz;
+    ikb_vd r01 = -cy * sz;
+    ikb_vd r02 = sy;
+    ikb_vd r10 = cx * sz + sx * sy * cz;
+    ikb_vd r11 = cx * cz - sx * sy * sz;
+    ikb_vd r12 = -sx * cy;
+    ikb_vd r20 = sx * sz - cx * sy * cz;
+    ikb_vd r21 = sx * cz + cx * sy * sz;
+    ikb_vd r22 = cx * cy;
+    ikb_vd ty  = dy + h0;
+
+    ikb_vd out[IK_SERVOS];
+    ikb_vi ok = (ikb_vi)(one == one);
+    for (int s = 0; s < IK_SERVOS; s++) {
+      const ikb_vd ax = ikb_splat (geo->anchor_x[s]);
+      const ikb_vd ay = ikb_splat (geo->anchor_y[s]);
+      const ikb_vd az = ikb_splat (geo->anchor_z[s]);
+
+      // Eq 3, P - B
+      ikb_vd px = dx + r00 * ax + r01 * ay + r02 * az
+	- ikb_splat (geo->base_x[s]);
+      ikb_vd py = ty + r10 * ax + r11 * ay + r12 * az;
+      ikb_vd pz = dz + r20 * ax + r21 * ay + r22 * az
+	- ikb_splat (geo->base_z[s]);
+
+      // Eq 9
+      ikb_vd L = px * px + py * py + pz * pz - leg_arm;
+      ikb_vd M = two_arm * py;
+      ikb_vd N = -ikb_abs (two_arm * (px * ikb_splat (geo->cos_beta[s]) +
+				      pz * ikb_splat (geo->sin_beta[s])));
+      ikb_vd arg = L / IKB_SQRT (M * M + N * N);
+      ikb_vd t = (one - arg) * (one + arg);
+      ok &= t >= zero;
+      t = (t >= zero) ? t : zero;
+      ikb_vd alpha = ikb_atan2 (arg, IKB_SQRT (t)) - ikb_atan2 (N, M);
+      out[s] = (s & 1) ? -alpha : alpha;
+    }
+
+    for (int k = 0; k < IKB_WIDTH; k++) {
+      double *a = &alphas[(i + k) * IK_SERVOS];
+      if (ok[k]) {
+	for (int s = 0; s < IK_SERVOS; s++) a[s] = out[s][k];
+	nvalid++;
+      }
+      else {
+	for (int s = 0; s < IK_SERVOS; s++) a[s] = NAN;
+      }
+      if (valid) valid[i + k] = ok[k] ? 1 : 0;
+    }
+  }
+
+  if (i < count)
+    nvalid += ik_batch_scalar (geo, poses + i, alphas + i * IK_SERVOS,
+			       valid ? valid + i : NULL, count - i);
+  return nvalid;
+}
@@ -0,0 +1,364 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+/***
+
+    Host-side benchmark of the shared IK core, ikcore.h, in the precisions
+    the simulator and the boards use: double, float and the Q16.16 of
+    ikfixed.h.  No window, no glm: this is the code the sketches compile,
+    so the float and fixed figures are the ones to watch when changing it.
+    The fixed error bound ikfixed.h states is checked, and the exit status
+    is 1 if it does not hold.
+
+    Host timings say little about a board without an FPU, so each variant
+    is also run through a counting wrapper and the counts priced with
+    per-operation cycle costs for a Cortex-M0+ (the SAMD21 in the MKR 1010)
+    using libgcc soft float.  The costs are estimates, kept in m0plus_cost[]
+    so they are easy to refine against a real measurement.
+
+	ikbench [-g geometry-file] [-n poses]
+
+ ***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include "geometry.h"
+#include "ikcore.h"
+#include "ikfixed.h"
+
+#define DEFAULT_POSES 1000000
+#define COUNTED_POSES 1000
+#define M0PLUS_MHZ    48.0
+
+enum {
+  OP_ADD,		// add, subtract, negate
+  OP_MUL,
+  OP_DIV,
+  OP_CMP,
+  OP_FABS,
+  OP_SQRT,
+  OP_SIN,
+  OP_COS,
+  OP_ASIN,
+  OP_ATAN2,
+  OP_KINDS
+};
+
+static const char *op_name[OP_KINDS] = {
+  "add", "mul", "div", "cmp", "fabs", "sqrt", "sin", "cos", "asin", "atan2"
+};
+
+static unsigned long op_count[OP_KINDS];
+static double asin_arg;			// largest |argument| since reset
+
+/***
+    Rough Cortex-M0+ cycle costs.  Soft float comes from libgcc and newlib;
+    fixed point is a 64 bit multiply (__aeabi_lmul, no umull on v6-M) or
+    divide (__aeabi_ldivmod) plus the table lookup, the sqrt is the 32 step
+    bitwise loop.
+ ***/
+
+static const double m0plus_cost[3][OP_KINDS] = {
+  //  add  mul  div  cmp fabs  sqrt   sin   cos  asin  atan2
+  {   120, 300, 900,  40,   4, 1500, 6000, 6000, 8000,  8000 },	// double
+  {    75,  65, 230,  25,   2,  500, 2500, 2500, 3000,  3000 },	// float
+  {     1,  30, 250,   2,   3,  400,   80,   80,  750,   300 },	// fixed
+};
+
+/***
+    A scalar that counts what is done with it, so ikc_solve () can be run
+    as is and tell us how many of each operation one pose costs, and how
+    close to 1 its asin arguments come.
+ ***/
+
+template <typename T>
+struct counted {
+  T v;
+
+  counted () {}
+  explicit counted (int i) : v (i) {}
+  explicit counted (double d) : v (d) {}
+  static counted wrap (T x) { counted c; c.v = x; return c; }
+
+  counted operator- () const { op_count[OP_ADD]++; return wrap (-v); }
+  counted operator+ (counted b) const { op_count[OP_ADD]++; return wrap (v + b.v); }
+  counted operator- (counted b) const { op_count[OP_ADD]++; return wrap (v - b.v); }
+  counted operator* (counted b) const { op_count[OP_MUL]++; return wrap (v * b.v); }
+  counted operator/ (counted b) const { op_count[OP_DIV]++; return wrap (v / b.v); }
+  counted &operator+= (counted b) { op_count[OP_ADD]++; v = v + b.v; return *this; }
+  bool operator<  (counted b) const { op_count[OP_CMP]++; return v <  b.v; }
+  bool operator<= (counted b) const { op_count[OP_CMP]++; return v <= b.v; }
+  bool operator>  (counted b) const { op_count[OP_CMP]++; return v >  b.v; }
+  bool operator>= (counted b) const { op_count[OP_CMP]++; return v >= b.v; }
+};
+
+template <typename T> struct ikc_math<counted<T> > {
+  typedef counted<T> C;
+  typedef ikc_math<T> m;
+  static C sqrt  (C x)      { op_count[OP_SQRT]++;  return C::wrap (m::sqrt (x.v)); }
+  static C sin   (C x)      { op_count[OP_SIN]++;   return C::wrap (m::sin (x.v)); }
+  static C cos   (C x)      { op_count[OP_COS]++;   return C::wrap (m::cos (x.v)); }
+  static C asin  (C x)      {
+    op_count[OP_ASIN]++;
+    asin_arg = std::max (asin_arg, ::fabs (ikc_to_double (x.v)));
+    return C::wrap (m::asin (x.v));
+  }
+  static C atan2 (C y, C x) { op_count[OP_ATAN2]++; return C::wrap (m::atan2 (y.v, x.v)); }
+  static C fabs  (C x)      { op_count[OP_FABS]++;  return C::wrap (m::fabs (x.v)); }
+};
+
+template <typename T>
+static void
+make_geometry (const geometry_s *g, ikc_geometry<T> *geo)
+{
+  for (int i = 0; i < IKC_SERVOS; i++) {
+    geo->base_x[i]   = T (g->base_radius * cos (g->base_angle[i]));
+    geo->base_z[i]   = T (g->base_radius * sin (g->base_angle[i]));
+    geo->anchor_x[i] = T (g->platform_radius * cos (g->platform_angle[i]));
+    geo->anchor_y[i] = T (0);
+    geo->anchor_z[i] = T (g->platform_radius * sin (g->platform_angle[i]));
+  }
+  geo->arm_length = T (g->arm_length);
+  geo->leg_length = T (g->leg_length);
+  ikc_prepare (geo);
+  geo->h0 = ikc_h0 (geo);
+}
+
+static double
+elapsed (struct timespec *start)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (double)(now.tv_sec - start->tv_sec) +
+    1.0e-9 * (double)(now.tv_nsec - start->tv_nsec);
+}
+
+template <typename T>
+static double
+run (const ikc_geometry<T> *geo, const std::vector<ikc_pose<double> > &poses,
+     std::vector<T> &alphas, std::vector<unsigned char> &valid)
+{
+  std::vector<ikc_pose<T> > lcl (poses.size ());
+  for (size_t i = 0; i < poses.size (); i++) {
+    lcl[i].delta_x = T (poses[i].delta_x);
+    lcl[i].delta_y = T (poses[i].delta_y);
+    lcl[i].delta_z = T (poses[i].delta_z);
+    lcl[i].phi     = T (poses[i].phi);
+    lcl[i].theta   = T (poses[i].theta);
+    lcl[i].rho     = T (poses[i].rho);
+  }
+
+  struct timespec start;
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (size_t i = 0; i < lcl.size (); i++)
+    valid[i] = ikc_solve (geo, &lcl[i], &alphas[i * IKC_SERVOS]);
+  return elapsed (&start);
+}
+
+// ops per pose, priced with m0plus_cost[cost]; returns estimated cycles
+template <typename T>
+static double
+count_ops (const geometry_s *g, const std::vector<ikc_pose<double> > &poses,
+	   const char *name, int cost)
+{
+  ikc_geometry<counted<T> > geo;
+  make_geometry (g, &geo);
+
+  size_t n = (poses.size () < COUNTED_POSES) ? poses.size () : COUNTED_POSES;
+  for (int k = 0; k < OP_KINDS; k++) op_count[k] = 0;
+  for (size_t i = 0; i < n; i++) {
+    ikc_pose<counted<T> > p;
+    p.delta_x = counted<T> (poses[i].delta_x);
+    p.delta_y = counted<T> (poses[i].delta_y);
+    p.delta_z = counted<T> (poses[i].delta_z);
+    p.phi     = counted<T> (poses[i].phi);
+    p.theta   = counted<T> (poses[i].theta);
+    p.rho     = counted<T> (poses[i].rho);
+    counted<T> alpha[IKC_SERVOS];
+    ikc_solve (&geo, &p, alpha);
+  }
+
+  double cycles = 0.0;
+  fprintf (stdout, "%-8s", name);
+  for (int k = 0; k < OP_KINDS; k++) {
+    double per = (double)op_count[k] / (double)n;
+    cycles += per * m0plus_cost[cost][k];
+    fprintf (stdout, " %5.1f", per);
+  }
+  fprintf (stdout, "  %8.0f  %7.1f\n", cycles, cycles / M0PLUS_MHZ);
+  return cycles;
+}
+
+// each pose's largest |asin argument| in the double core, over all servos
+static void
+asin_args (const geometry_s *g, const std::vector<ikc_pose<double> > &poses,
+	   std::vector<double> &args)
+{
+  ikc_geometry<counted<double> > geo;
+  make_geometry (g, &geo);
+
+  for (size_t i = 0; i < poses.size (); i++) {
+    ikc_pose<counted<double> > p;
+    p.delta_x = counted<double> (poses[i].delta_x);
+    p.delta_y = counted<double> (poses[i].delta_y);
+    p.delta_z = counted<double> (poses[i].delta_z);
+    p.phi     = counted<double> (poses[i].phi);
+    p.theta   = counted<double> (poses[i].theta);
+    p.rho     = counted<double> (poses[i].rho);
+    counted<double> alpha[IKC_SERVOS];
+    asin_arg = 0.0;
+    ikc_solve (&geo, &p, alpha);
+    args[i] = asin_arg;
+  }
+}
+
+/***
+    max and 99th percentile of |alpha - ref| over the poses both solve.
+    With bound, also the max over the poses whose every asin argument is
+    under FIXED_ASIN_LIMIT, the claim ikfixed.h makes; returns false if
+    that goes over bound.
+ ***/
+
+#define FIXED_ASIN_LIMIT	0.9
+#define FIXED_BOUND		1.6e-4	// rad
+
+template <typename T>
+static bool
+compare (const char *name, const std::vector<double> &ref,
+	 const std::vector<unsigned char> &ref_valid,
+	 const std::vector<T> &alphas, const std::vector<unsigned char> &valid,
+	 const std::vector<double> &args, double bound)
+{
+  std::vector<double> errs;
+  long disagree = 0, inside = 0;
+  double inside_max = 0.0;
+  for (size_t i = 0; i < ref_valid.size (); i++) {
+    if (ref_valid[i] != valid[i]) disagree++;
+    if (!ref_valid[i] || !valid[i]) continue;
+    double worst = 0.0;
+    for (int s = 0; s < IKC_SERVOS; s++) {
+      double e = fabs (ref[i * IKC_SERVOS + s] -
+		       ikc_to_double (alphas[i * IKC_SERVOS + s]));
+      if (e > worst) worst = e;
+    }
+    errs.push_back (worst);
+    if (args[i] < FIXED_ASIN_LIMIT) {
+      inside++;
+      inside_max = std::max (inside_max, worst);
+    }
+  }
+  if (errs.empty ()) return true;
+  std::sort (errs.begin (), errs.end ());
+  double p99 = errs[(size_t)(0.99 * (double)(errs.size () - 1))];
+  fprintf (stdout, "%-6s vs double: max %.3g rad (%.3g deg), p99 %.3g rad, "
+	   "%ld reachability disagreements\n", name, errs.back (),
+	   errs.back () * 180.0 / M_PI, p99, disagree);
+  if (bound <= 0.0) return true;
+
+  bool ok = inside_max <= bound;
+  fprintf (stdout, "%-6s asin under %g: max %.3g rad over %ld poses, bound "
+	   "%.3g rad, %s\n", name, FIXED_ASIN_LIMIT, inside_max, inside,
+	   bound, ok ? "ok" : "EXCEEDED");
+  return ok;
+}
+
+int
+main (int argc, char *argv[])
+{
+  geometry_s g;
+  long count = DEFAULT_POSES;
+  int opt;
+
+  geometry_default (&g);
+  while ((opt = getopt (argc, argv, "g:n:")) != -1) {
+    switch (opt) {
+    case 'g':
+      if (!geometry_load (optarg, &g)) return 1;
+      break;
+    case 'n':
+      count = atol (optarg);
+      break;
+    default:
+      fprintf (stderr, "usage: %s [-g geometry-file] [-n poses]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (count <= 0) count = DEFAULT_POSES;
+
+  ikc_geometry<double>    geo_d;
+  ikc_geometry<float>     geo_f;
+  ikc_geometry<ikc_fixed> geo_x;
+  make_geometry (&g, &geo_d);
+  make_geometry (&g, &geo_f);
+  make_geometry (&g, &geo_x);
+
+  // the same envelope as --bench-ik
+  std::vector<ikc_pose<double> > poses (count);
+  srand48 (1);
+  for (long i = 0; i < count; i++) {
+    poses[i].delta_x = 4.0 * (drand48 () - 0.5);
+    poses[i].delta_y = 4.0 * (drand48 () - 0.5);
+    poses[i].delta_z = 4.0 * (drand48 () - 0.5);
+    poses[i].phi     = 0.4 * (drand48 () - 0.5);
+    poses[i].theta   = 0.4 * (drand48 () - 0.5);
+    poses[i].rho     = 0.4 * (drand48 () - 0.5);
+  }
+
+  std::vector<double>    alpha_d (count * IKC_SERVOS);
+  std::vector<float>     alpha_f (count * IKC_SERVOS);
+  std::vector<ikc_fixed> alpha_x (count * IKC_SERVOS);
+  std::vector<unsigned char> valid_d (count), valid_f (count), valid_x (count);
+
+  double secs_d = run (&geo_d, poses, alpha_d, valid_d);
+  double secs_f = run (&geo_f, poses, alpha_f, valid_f);
+  double secs_x = run (&geo_x, poses, alpha_x, valid_x);
+
+  long nvalid = 0;
+  for (long i = 0; i < count; i++) nvalid += valid_d[i];
+
+  fprintf (stdout, "ikcore, %ld poses, %ld reachable, h0 %g cm\n",
+	   count, nvalid, geo_d.h0);
+  fprintf (stdout, "host:\n");
+  fprintf (stdout, "%-8s %12.0f poses/sec %8.1f ns/pose\n", "double",
+	   (double)count / secs_d, 1.0e9 * secs_d / (double)count);
+  fprintf (stdout, "%-8s %12.0f poses/sec %8.1f ns/pose\n", "float",
+	   (double)count / secs_f, 1.0e9 * secs_f / (double)count);
+  fprintf (stdout, "%-8s %12.0f poses/sec %8.1f ns/pose\n", "fixed",
+	   (double)count / secs_x, 1.0e9 * secs_x / (double)count);
+  std::vector<double> args (count);
+  asin_args (&g, poses, args);
+  compare ("float", alpha_d, valid_d, alpha_f, valid_f, args, 0.0);
+  bool within = compare ("fixed", alpha_d, valid_d, alpha_x, valid_x, args,
+			 FIXED_BOUND);
+
+  fprintf (stdout, "\nCortex-M0+ estimate, ops per pose:\n%-8s", "");
+  for (int k = 0; k < OP_KINDS; k++) fprintf (stdout, " %5s", op_name[k]);
+  fprintf (stdout, "  %8s  %7s\n", "cycles", "us@48");
+  double cyc_d = count_ops<double>    (&g, poses, "double", 0);
+  double cyc_f = count_ops<float>     (&g, poses, "float",  1);
+  double cyc_x = count_ops<ikc_fixed> (&g, poses, "fixed",  2);
+  fprintf (stdout, "fixed is x%.1f double, x%.1f float, "
+	   "about %.0f poses/sec\n", cyc_d / cyc_x, cyc_f / cyc_x,
+	   1.0e6 * M0PLUS_MHZ / cyc_x);
+  return within ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef IKCORE_H
+#define IKCORE_H
+
+/***
+
+    The inverse kinematics, once, for everything that drives a platform:
+    the simulator (stewart.cpp, ikbatch.cpp), the Mega in hardware2 and the
+    MKR 1010 in hardware4.  The sketch directories carry symlinks to this
+    file, since the Arduino tools only look inside the sketch.
+
+    It is header-only and needs nothing beyond <math.h>: no glm, no
+    BasicLinearAlgebra, no allocation, no globals.  Everything is templated
+    on the scalar type.  double is what the simulator uses; float is what
+    the boards want, neither has a double precision FPU and the SAMD21 has
+    none at all.  Another scalar type only needs an ikc_math<> and an
+    ikc_to_double () for it; ikfixed.h adds Q16.16 fixed point that way.
+
+    Based on the paper "The Mathematics of the Stewart Platform" from
+https://content.instructables.com/ORIG/FFI/8ZXW/I55MMY14/FFI8ZXWI55MMY14.pdf
+
+ ***/
+
+#include <math.h>
+
+#define IKC_SERVOS 6
+
+template <typename T> struct ikc_math;
+
+template <> struct ikc_math<double> {
+  static double sqrt  (double x)           { return ::sqrt (x); }
+  static double sin   (double x)           { return ::sin (x); }
+  static double cos   (double x)           { return ::cos (x); }
+  static double asin  (double x)           { return ::asin (x); }
+  static double atan2 (double y, double x) { return ::atan2 (y, x); }
+  static double fabs  (double x)           { return ::fabs (x); }
+};
+
+template <> struct ikc_math<float> {
+  static float sqrt  (float x)          { return ::sqrtf (x); }
+  static float sin   (float x)          { return ::sinf (x); }
+  static float cos   (float x)          { return ::cosf (x); }
+  static float asin  (float x)          { return ::asinf (x); }
+  static float atan2 (float y, float x) { return ::atan2f (y, x); }
+  static float fabs  (float x)          { return ::fabsf (x); }
+};
+
+// back to double, for printing and for servo libraries
+inline double ikc_to_double (double v) { return v; }
+inline double ikc_to_double (float v)  { return v; }
+
+template <typename T>
+struct ikc_pose {
+  T delta_x;
+  T delta_y;
+  T delta_z;
+  T phi;		// yaw		opengl y, real z
+  T theta;		// pitch	opengl z, real y
+  T rho;		// roll		opengl x, real x
+};
+
+/***
+    Structure-of-arrays geometry, all in opengl coordinates (y up).  Fill in
+    the positions and lengths, then call ikc_prepare () to set up the
+    derived per-servo constants.
+ ***/
+
+template <typename T>
+struct ikc_geometry {
+  T base_x[IKC_SERVOS];		// servo shaft position
+  T base_z[IKC_SERVOS];
+  T anchor_x[IKC_SERVOS];	// platform anchor, platform frame
+  T anchor_y[IKC_SERVOS];
+  T anchor_z[IKC_SERVOS];
+  T h0;
+  T arm_length;
+  T leg_length;
+
+  // derived, set by ikc_prepare ()
+  T cos_beta[IKC_SERVOS];
+  T sin_beta[IKC_SERVOS];
+  T two_arm;			// 2a
+  T leg_arm;			// s^2 - a^2
+};
+
+template <typename T>
+void
+ikc_prepare (ikc_geometry<T> *geo)
+{
+  // beta is -pi/6 for the even servos, pi/6 for the odd
+  for (int i = 0; i < IKC_SERVOS; i++) {
+    geo->cos_beta[i] = T (0.86602540378443864676);
+    geo->sin_beta[i] = (i & 1) ? T (0.5) : T (-0.5);
+  }
+  geo->two_arm = T (2) * geo->arm_length;
+  geo->leg_arm = geo->leg_length * geo->leg_length -
+    geo->arm_length * geo->arm_length;
+}
+
+/***
+    Eq 10, the neutral height.  The anchor term is the anchor's y, which is
+    zero for a flat platform, against the servo's z; that is how the
+    simulator and the sketches have always placed the platform at rest.
+ ***/
+
+template <typename T>
+T
+ikc_h0 (const ikc_geometry<T> *geo)
+{
+  typedef ikc_math<T> m;
+  T h0 = T (0);
+  for (int i = 0; i < IKC_SERVOS; i++) {
+    T dx = geo->anchor_x[i] - geo->base_x[i];
+    T dy = geo->anchor_y[i] - geo->base_z[i];
+    h0 += m::sqrt (geo->leg_length * geo->leg_length +
+		   geo->arm_length * geo->arm_length - (dx * dx + dy * dy));
+  }
+  return h0 / T (IKC_SERVOS);
+}
+
+/***
+    Eq 1 - 9 for one pose.  alpha gets six servo angles, radians, with the
+    odd servos negated (the servo::alpha convention in the simulator).  If
+    any leg cannot reach, alpha is left untouched and false is returned.
+ ***/
+
+template <typename T>
+bool
+ikc_solve (const ikc_geometry<T> *geo, const ikc_pose<T> *p, T *alpha)
+{
+  typedef ikc_math<T> m;
+  T sx = m::sin (p->theta), cx = m::cos (p->theta);
+  T sy = m::sin (p->rho),   cy = m::cos (p->rho);
+  T sz = m::sin (p->phi),   cz = m::cos (p->phi);
+
+  // R = Rx (theta) Ry (rho) Rz (phi)
+  T r00 = cy * cz;
+  T r01 = -cy * sz;
+  T r02 = sy;
+  T r10 = cx * sz + sx * sy * cz;
+  T r11 = cx * cz - sx * sy * sz;
+  T r12 = -sx * cy;
+  T r20 = sx * sz - cx * sy * cz;
+  T r21 = sx * cz + cx * sy * sz;
+  T r22 = cx * cy;
+
+  T stage[IKC_SERVOS];
+  for (int s = 0; s < IKC_SERVOS; s++) {
+    T ax = geo->anchor_x[s];
+    T ay = geo->anchor_y[s];
+    T az = geo->anchor_z[s];
+
+    // Eq 3, leg vector from servo to anchor
+    T px = p->delta_x + r00 * ax + r01 * ay + r02 * az - geo->base_x[s];
+    T py = p->delta_y + geo->h0 + r10 * ax + r11 * ay + r12 * az;
+    T pz = p->delta_z + r20 * ax + r21 * ay + r22 * az - geo->base_z[s];
+
+    // Eq 9
+    T L = px * px + py * py + pz * pz - geo->leg_arm;
+    T M = geo->two_arm * py;
+    T N = -m::fabs (geo->two_arm *
+		    (px * geo->cos_beta[s] + pz * geo->sin_beta[s]));
+    T arg = L / m::sqrt (M * M + N * N);
+    if (!(arg >= T (-1) && arg <= T (1))) return false;	// NaN too
+    T a = m::asin (arg) - m::atan2 (N, M);
+    stage[s] = (s & 1) ? -a : a;
+  }
+  for (int s = 0; s < IKC_SERVOS; s++) alpha[s] = stage[s];
+  return true;
+}
+
+#endif // IKCORE_H
@@ -0,0 +1,322 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef IKFIXED_H
+#define IKFIXED_H
+
+/***
+
+    Q16.16 fixed point for ikcore.h, for boards without an FPU.  With this
+    included, ikc_geometry<ikc_fixed> and ikc_solve<ikc_fixed> () run the
+    same Eq 1 - 9 in 32 bit integers, 64 bit intermediates, and no floating
+    point at all once ikc_prepare () has converted the geometry.
+
+    sin and cos interpolate a 257 entry quarter-wave table, atan2 and asin
+    an atan table over [0, 1], both Q30 and in flash.  sqrt is bitwise.
+    Each is within one Q16 step, 1.5e-5, of libm.
+
+    Against the double core, the one update_alpha () uses, servo angles
+    are within 1.6e-4 rad (0.01 deg) whenever every asin argument is
+    under 0.9; ikbench checks that and exits 1 if it fails, and prints
+    1.2e-4 rad over its million poses.  Over its whole envelope p99 is
+    1.4e-4 rad.  Only at the very edge of reach, where the slope of asin
+    is unbounded, does the error grow, to 7.8e-3 rad (0.45 deg), and a
+    dozen poses there are reachable in one and not the other.  A hobby
+    servo resolves 0.1 deg or so.
+
+    Range: Q16.16 holds +-32767, and Eq 9 squares the leg vector and
+    2a |leg|, so keep those below 181 cm; any platform that fits on a desk
+    is fine.  Overflow is not checked.
+
+ ***/
+
+#include <stdint.h>
+
+#include "ikcore.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define IKC_TABLE		const PROGMEM
+#define IKC_TABLE_READ(t, i)	((int32_t)pgm_read_dword (&(t)[i]))
+#else
+#define IKC_TABLE		const
+#define IKC_TABLE_READ(t, i)	((t)[i])
+#endif
+
+#define IKC_FIXED_FRAC	16
+#define IKC_FIXED_ONE	((int32_t)1 << IKC_FIXED_FRAC)
+
+class ikc_fixed {
+public:
+  int32_t raw;
+
+  ikc_fixed () {}
+  explicit ikc_fixed (int i) : raw ((int32_t)i * IKC_FIXED_ONE) {}
+  explicit ikc_fixed (double d)
+    : raw ((int32_t)(d * (double)IKC_FIXED_ONE + ((d < 0.0) ? -0.5 : 0.5))) {}
+
+  static ikc_fixed from_raw (int32_t r) { ikc_fixed f; f.raw = r; return f; }
+  double to_double () const { return (double)raw / (double)IKC_FIXED_ONE; }
+  float  to_float  () const { return (float)raw / (float)IKC_FIXED_ONE; }
+
+  ikc_fixed operator- () const { return from_raw (-raw); }
+  ikc_fixed operator+ (ikc_fixed b) const { return from_raw (raw + b.raw); }
+  ikc_fixed operator- (ikc_fixed b) const { return from_raw (raw - b.raw); }
+  ikc_fixed operator* (ikc_fixed b) const {
+    int64_t p = (int64_t)raw * b.raw;
+    return from_raw ((int32_t)((p + (IKC_FIXED_ONE >> 1)) >> IKC_FIXED_FRAC));
+  }
+  // x / 0 saturates, which ikc_solve () then rejects as out of range
+  ikc_fixed operator/ (ikc_fixed b) const {
+    if (b.raw == 0) return from_raw ((raw < 0) ? -INT32_MAX : INT32_MAX);
+    int64_t n = (int64_t)raw << IKC_FIXED_FRAC;
+    int64_t h = ((b.raw < 0) ? -(int64_t)b.raw : b.raw) >> 1;
+    return from_raw ((int32_t)(((n < 0) ? n - h : n + h) / b.raw));
+  }
+  ikc_fixed &operator+= (ikc_fixed b) { raw += b.raw; return *this; }
+  ikc_fixed &operator-= (ikc_fixed b) { raw -= b.raw; return *this; }
+
+  bool operator<  (ikc_fixed b) const { return raw <  b.raw; }
+  bool operator<= (ikc_fixed b) const { return raw <= b.raw; }
+  bool operator>  (ikc_fixed b) const { return raw >  b.raw; }
+  bool operator>= (ikc_fixed b) const { return raw >= b.raw; }
+  bool operator== (ikc_fixed b) const { return raw == b.raw; }
+  bool operator!= (ikc_fixed b) const { return raw != b.raw; }
+};
+
+// sin (k pi / 512), k = 0 .. 256, Q30
+static IKC_TABLE int32_t ikc_sin_table[257] = {
+  0, 6588356, 13176464, 19764076, 26350943,
+  32936819, 39521455, 46104602, 52686014, 59265442,
+  65842639, 72417357, 78989349, 85558366, 92124163,
+  98686491, 105245103, 111799753, 118350194, 124896179,
+  131437462, 137973796, 144504935, 151030634, 157550647,
+  164064728, 170572633, 177074115, 183568930, 190056834,
+  196537583, 203010932, 209476638, 215934457, 222384147,
+  228825464, 235258165, 241682010, 248096755, 254502159,
+  260897982, 267283981, 273659918, 280025552, 286380643,
+  292724951, 299058239, 305380268, 311690799, 317989595,
+  324276419, 330551034, 336813204, 343062693, 349299266,
+  355522689, 361732726, 367929144, 374111709, 380280190,
+  386434353, 392573967, 398698801, 404808624, 410903207,
+  416982319, 423045732, 429093217, 435124548, 441139496,
+  447137835, 453119340, 459083786, 465030947, 470960600,
+  476872522, 482766489, 488642281, 494499676, 500338453,
+  506158392, 511959275, 517740883, 523502998, 529245404,
+  534967884, 540670223, 546352205, 552013618, 557654248,
+  563273883, 568872310, 574449320, 580004702, 585538248,
+  591049748, 596538995, 602005783, 607449906, 612871159,
+  618269338, 623644239, 628995660, 634323400, 639627258,
+  644907034, 650162530, 655393548, 660599890, 665781362,
+  670937767, 676068911, 681174602, 686254647, 691308855,
+  696337036, 701339000, 706314559, 711263525, 716185713,
+  721080937, 725949013, 730789757, 735602987, 740388522,
+  745146182, 749875788, 754577161, 759250125, 763894504,
+  768510122, 773096806, 777654384, 782182683, 786681534,
+  791150767, 795590213, 799999706, 804379079, 808728167,
+  813046808, 817334838, 821592095, 825818421, 830013654,
+  834177638, 838310216, 842411232, 846480531, 850517961,
+  854523370, 858496606, 862437520, 866345964, 870221790,
+  874064853, 877875009, 881652112, 885396022, 889106597,
+  892783698, 896427186, 900036924, 903612776, 907154608,
+  910662286, 914135678, 917574653, 920979082, 924348837,
+  927683790, 930983817, 934248793, 937478595, 940673101,
+  943832191, 946955747, 950043650, 953095785, 956112036,
+  959092290, 962036435, 964944360, 967815955, 970651112,
+  973449725, 976211688, 978936898, 981625251, 984276646,
+  986890984, 989468165, 992008094, 994510675, 996975812,
+  999403415, 1001793390, 1004145648, 1006460100, 1008736660,
+  1010975242, 1013175761, 1015338134, 1017462281, 1019548121,
+  1021595575, 1023604567, 1025575020, 1027506862, 1029400018,
+  1031254418, 1033069992, 1034846671, 1036584389, 1038283080,
+  1039942680, 1041563127, 1043144360, 1044686319, 1046188946,
+  1047652185, 1049075980, 1050460278, 1051805027, 1053110176,
+  1054375676, 1055601479, 1056787540, 1057933813, 1059040255,
+  1060106826, 1061133483, 1062120190, 1063066909, 1063973603,
+  1064840240, 1065666786, 1066453210, 1067199483, 1067905576,
+  1068571464, 1069197120, 1069782521, 1070327646, 1070832474,
+  1071296985, 1071721163, 1072104991, 1072448455, 1072751542,
+  1073014240, 1073236540, 1073418433, 1073559913, 1073660973,
+  1073721611, 1073741824
+};
+
+// atan (k / 256), k = 0 .. 256, Q30
+static IKC_TABLE int32_t ikc_atan_table[257] = {
+  0, 4194283, 8388437, 12582336, 16775851,
+  20968854, 25161218, 29352814, 33543516, 37733196,
+  41921726, 46108981, 50294833, 54479155, 58661822,
+  62842708, 67021687, 71198634, 75373424, 79545932,
+  83716036, 87883610, 92048532, 96210679, 100369930,
+  104526161, 108679253, 112829084, 116975536, 121118487,
+  125257820, 129393416, 133525159, 137652930, 141776614,
+  145896097, 150011262, 154121996, 158228185, 162329719,
+  166426484, 170518371, 174605269, 178687069, 182763663,
+  186834944, 190900805, 194961140, 199015846, 203064818,
+  207107953, 211145151, 215176309, 219201328, 223220110,
+  227232556, 231238569, 235238055, 239230917, 243217063,
+  247196400, 251168835, 255134279, 259092643, 263043837,
+  266987774, 270924369, 274853536, 278775192, 282689253,
+  286595638, 290494267, 294385059, 298267937, 302142824,
+  306009643, 309868320, 313718782, 317560955, 321394768,
+  325220151, 329037035, 332845353, 336645037, 340436023,
+  344218245, 347991640, 351756148, 355511705, 359258254,
+  362995735, 366724092, 370443267, 374153206, 377853855,
+  381545162, 385227074, 388899541, 392562515, 396215946,
+  399859787, 403493994, 407118521, 410733324, 414338361,
+  417933591, 421518973, 425094468, 428660037, 432215645,
+  435761254, 439296830, 442822340, 446337750, 449843028,
+  453338145, 456823070, 460297774, 463762232, 467216414,
+  470660297, 474093856, 477517067, 480929907, 484332355,
+  487724391, 491105994, 494477146, 497837829, 501188027,
+  504527723, 507856902, 511175551, 514483656, 517781204,
+  521068185, 524344587, 527610402, 530865619, 534110231,
+  537344232, 540567613, 543780370, 546982499, 550173994,
+  553354853, 556525073, 559684652, 562833591, 565971887,
+  569099543, 572216558, 575322936, 578418678, 581503788,
+  584578271, 587642129, 590695370, 593737999, 596770023,
+  599791448, 602802283, 605802536, 608792216, 611771334,
+  614739898, 617697921, 620645413, 623582386, 626508854,
+  629424828, 632330323, 635225352, 638109930, 640984073,
+  643847795, 646701114, 649544044, 652376604, 655198810,
+  658010682, 660812236, 663603492, 666384468, 669155185,
+  671915663, 674665921, 677405981, 680135863, 682855589,
+  685565182, 688264663, 690954054, 693633380, 696302662,
+  698961924, 701611191, 704250487, 706879836, 709499262,
+  712108791, 714708448, 717298260, 719878250, 722448447,
+  725008876, 727559563, 730100536, 732631822, 735153448,
+  737665442, 740167831, 742660643, 745143906, 747617650,
+  750081902, 752536690, 754982045, 757417995, 759844569,
+  762261796, 764669707, 767068330, 769457696, 771837835,
+  774208776, 776570551, 778923188, 781266719, 783601175,
+  785926586, 788242982, 790550395, 792848855, 795138394,
+  797419043, 799690833, 801953796, 804207961, 806453363,
+  808690030, 810917996, 813137292, 815347949, 817549999,
+  819743474, 821928406, 824104826, 826272767, 828432260,
+  830583337, 832726030, 834860371, 836986393, 839104126,
+  841213603, 843314857
+};
+
+#define IKC_Q30_PI_2	((int64_t)1686629713)		// pi/2, Q30
+#define IKC_TURN_SCALE	((int64_t)683565276)		// 2^32 / 2pi
+
+// table lookup, p in [0, 2^30] spanning the table, Q30 result
+static inline int32_t
+ikc_table_lerp (const int32_t *table, uint32_t p)
+{
+  uint32_t idx  = p >> 22;
+  int32_t  frac = (int32_t)((p >> 6) & 0xffff);
+  int32_t  v    = IKC_TABLE_READ (table, idx);
+  if (frac) {
+    int32_t step = IKC_TABLE_READ (table, idx + 1) - v;
+    v += (int32_t)(((int64_t)step * frac) >> 16);
+  }
+  return v;
+}
+
+static inline ikc_fixed
+ikc_q30_to_fixed (int64_t v)
+{
+  const int sh = 30 - IKC_FIXED_FRAC;
+  return ikc_fixed::from_raw ((int32_t)((v + ((int64_t)1 << (sh - 1))) >> sh));
+}
+
+// sin of a phase in Q32 turns
+static inline int32_t
+ikc_sin_turns (uint32_t phase)
+{
+  uint32_t quadrant = phase >> 30;
+  uint32_t p = phase & 0x3fffffff;
+  if (quadrant & 1) p = ((uint32_t)1 << 30) - p;
+  int32_t v = ikc_table_lerp (ikc_sin_table, p);
+  return (quadrant & 2) ? -v : v;
+}
+
+static inline uint32_t
+ikc_turns (ikc_fixed x)
+{
+  return (uint32_t)(((int64_t)x.raw * IKC_TURN_SCALE) >> IKC_FIXED_FRAC);
+}
+
+// atan2 of two values on the same (any) scale, Q30 result
+static inline int64_t
+ikc_atan2_q30 (int64_t y, int64_t x)
+{
+  int64_t ay = (y < 0) ? -y : y;
+  int64_t ax = (x < 0) ? -x : x;
+  int64_t a;
+  if (ay == 0 && ax == 0) return 0;
+  if (ay <= ax)
+    a = ikc_table_lerp (ikc_atan_table, (uint32_t)((ay << 30) / ax));
+  else
+    a = IKC_Q30_PI_2 - ikc_table_lerp (ikc_atan_table,
+				       (uint32_t)((ax << 30) / ay));
+  if (x < 0) a = 2 * IKC_Q30_PI_2 - a;
+  return (y < 0) ? -a : a;
+}
+
+static inline uint64_t
+ikc_isqrt64 (uint64_t v)
+{
+  uint64_t res = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+  while (bit > v) bit >>= 2;
+  while (bit) {
+    if (v >= res + bit) {
+      v -= res + bit;
+      res = (res >> 1) + bit;
+    }
+    else res >>= 1;
+    bit >>= 2;
+  }
+  return res;
+}
+
+inline double ikc_to_double (ikc_fixed v) { return v.to_double (); }
+
+template <> struct ikc_math<ikc_fixed> {
+  static ikc_fixed sqrt (ikc_fixed x) {
+    if (x.raw <= 0) return ikc_fixed (0);
+    uint64_t v = (uint64_t)x.raw << IKC_FIXED_FRAC;
+    uint64_t r = ikc_isqrt64 (v);
+    if (v - r * r > r) r++;			// round to nearest
+    return ikc_fixed::from_raw ((int32_t)r);
+  }
+  static ikc_fixed sin (ikc_fixed x) {
+    return ikc_q30_to_fixed (ikc_sin_turns (ikc_turns (x)));
+  }
+  static ikc_fixed cos (ikc_fixed x) {
+    return ikc_q30_to_fixed (ikc_sin_turns (ikc_turns (x) +
+					    ((uint32_t)1 << 30)));
+  }
+  // atan2 (x, sqrt (1 - x^2)), the square root taken in Q24
+  static ikc_fixed asin (ikc_fixed x) {
+    int64_t one_q32 = (int64_t)1 << (2 * IKC_FIXED_FRAC);
+    int64_t c2 = one_q32 - (int64_t)x.raw * x.raw;	// Q32
+    if (c2 < 0) c2 = 0;
+    int64_t c = (int64_t)ikc_isqrt64 ((uint64_t)c2 << 16);	// Q24
+    return ikc_q30_to_fixed (ikc_atan2_q30 ((int64_t)x.raw << 8, c));
+  }
+  static ikc_fixed atan2 (ikc_fixed y, ikc_fixed x) {
+    return ikc_q30_to_fixed (ikc_atan2_q30 (y.raw, x.raw));
+  }
+  static ikc_fixed fabs (ikc_fixed x) {
+    return (x.raw < 0) ? -x : x;
+  }
+};
+
+#endif // IKFIXED_H
@@ -0,0 +1,130 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#include <string.h>
+#include <time.h>
+
+#include "inputlog.h"
+
+bool
+il_record_open (il_recorder_s *rec, const char *filename, int width,
+		int height, uint64_t seed)
+{
+  rec->fp = fopen (filename, "w");
+  if (!rec->fp) {
+    perror (filename);
+    return false;
+  }
+  memset (&rec->header, 0, sizeof(rec->header));
+  memcpy (rec->header.magic, IL_MAGIC, sizeof(rec->header.magic));
+  rec->header.version = IL_VERSION;
+  rec->header.width = width;
+  rec->header.height = height;
+  rec->header.seed = seed;
+  if (fwrite (&rec->header, sizeof(rec->header), 1, rec->fp) != 1) {
+    perror (filename);
+    fclose (rec->fp);
+    rec->fp = NULL;
+    return false;
+  }
+  clock_gettime (CLOCK_MONOTONIC, &rec->start);
+  rec->last = 0;
+  return true;
+}
+
+void
+il_record (il_recorder_s *rec, il_type_e type, int mod, int state, int code,
+	   int x, int y)
+{
+  struct timespec now;
+  il_event_s ev;
+
+  if (!rec->fp) return;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  uint64_t us = (uint64_t)(now.tv_sec - rec->start.tv_sec) * 1000000 +
+    (now.tv_nsec - rec->start.tv_nsec) / 1000;
+  uint64_t dt = us - rec->last;
+
+  memset (&ev, 0, sizeof(ev));
+  ev.dt = (dt > UINT32_MAX) ? UINT32_MAX : (uint32_t)dt;
+  ev.type = (uint8_t)type;
+  ev.mod = (uint8_t)mod;
+  ev.state = (uint8_t)state;
+  ev.code = (int16_t)code;
+  ev.x = (int16_t)x;
+  ev.y = (int16_t)y;
+  if (fwrite (&ev, sizeof(ev), 1, rec->fp) != 1) {
+    perror ("input log, recording stopped");
+    fclose (rec->fp);			// header left saying 0 events
+    rec->fp = NULL;
+    return;
+  }
+  rec->last += ev.dt;
+  rec->header.events++;
+}
+
+void
+il_record_close (il_recorder_s *rec)
+{
+  if (!rec->fp) return;
+  rewind (rec->fp);
+  bool ok = fwrite (&rec->header, sizeof(rec->header), 1, rec->fp) == 1;
+  if (fclose (rec->fp) != 0 || !ok) perror ("input log");
+  rec->fp = NULL;
+}
+
+bool
+il_load (const char *filename, il_log_s *log)
+{
+  il_header_s hdr;
+  FILE *fp = fopen (filename, "r");
+  if (!fp) {
+    perror (filename);
+    return false;
+  }
+
+  bool ok = (fread (&hdr, sizeof(hdr), 1, fp) == 1 &&
+	     !memcmp (hdr.magic, IL_MAGIC, sizeof(hdr.magic)) &&
+	     hdr.version == IL_VERSION);
+  // a run that never closed its log still has every event written
+  std::vector<il_event_s> events;
+  il_event_s ev;
+  while (ok && fread (&ev, sizeof(ev), 1, fp) == 1) events.push_back (ev);
+  fclose (fp);
+  if (!ok) {
+    fprintf (stderr, "%s: not a whole input log\n", filename);
+    return false;
+  }
+  if (hdr.events == 0 && !events.empty ())
+    fprintf (stderr, "%s: not closed, may be cut short, %zu events\n",
+	     filename, events.size ());
+  else if (hdr.events > events.size ())
+    fprintf (stderr, "%s: cut short, %zu of %llu events\n", filename,
+	     events.size (), (unsigned long long)hdr.events);
+
+  log->header = hdr;
+  log->events = events;
+  log->t.resize (events.size ());
+  double t = 0.0;
+  for (size_t i = 0; i < events.size (); i++) {
+    t += 1.0e-6 * (double)events[i].dt;
+    log->t[i] = t;
+  }
+  log->next = 0;
+  return true;
+}
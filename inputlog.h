@@ -0,0 +1,107 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef INPUTLOG_H
+#define INPUTLOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <vector>
+
+/***
+
+    Input event log, so a run of the renderer can be driven the same way
+    twice.  --input-record writes every keyboard, special key, mouse
+    button, mouse motion and reshape callback with its time; --input-replay feeds them back
+    at those times, in the window or, with --headless, straight into the
+    simulation on its fixed timestep.
+
+    File layout, host byte order:
+
+	il_header_s
+	il_event_s events[]
+
+    Each event holds the microseconds since the one before it, so the
+    whole event is 16 bytes however long the run.  The header keeps what
+    else the callbacks depend on: the window size mouse motion is scaled
+    by, until an IL_RESHAPE changes it, and the seed of the demo motion.
+    events is written when the log is closed; a log that is not closed,
+    after a crash or a failed write, has 0 there and may be cut short.
+
+ ***/
+
+#define IL_MAGIC	"STIL"
+#define IL_VERSION	1
+
+typedef enum {
+  IL_KEYBOARD,			// code is the key
+  IL_SPECIAL,			// code is the GLUT_KEY_*
+  IL_MOUSE,			// code is the button, state GLUT_DOWN or UP
+  IL_MOTION,
+  IL_RESHAPE			// x, y are the new width and height
+} il_type_e;
+
+typedef struct {
+  uint32_t dt;			// microseconds since the last event
+  uint8_t  type;		// il_type_e
+  uint8_t  mod;			// glutGetModifiers ()
+  uint8_t  state;
+  uint8_t  reserved;
+  int16_t  code;
+  int16_t  x;
+  int16_t  y;
+  int16_t  reserved2;
+} il_event_s;
+
+typedef struct {
+  char     magic[4];
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint64_t seed;		// demo motion
+  uint64_t events;		// written on close, not needed to replay
+} il_header_s;
+
+typedef struct {
+  FILE           *fp;
+  il_header_s     header;
+  struct timespec start;
+  uint64_t        last;		// microseconds since start
+} il_recorder_s;
+
+bool il_record_open (il_recorder_s *rec, const char *filename,
+		     int width, int height, uint64_t seed);
+// a failed write reports to stderr and stops the recording, log unclosed
+void il_record (il_recorder_s *rec, il_type_e type, int mod, int state,
+		int code, int x, int y);
+void il_record_close (il_recorder_s *rec);
+
+typedef struct {
+  il_header_s             header;
+  std::vector<il_event_s> events;
+  std::vector<double>     t;		// seconds since the start
+  size_t                  next;		// replay position
+} il_log_s;
+
+// Leaves log untouched and reports to stderr if the file is bad; warns if
+// it was not closed, or holds fewer events than its header says.
+bool il_load (const char *filename, il_log_s *log);
+
+#endif // INPUTLOG_H
@@ -0,0 +1,122 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#include <math.h>
+#include <string.h>
+
+#include "instance.h"
+
+void
+motion_jitter (motion_s *motion, const jitter_spec_s *spec, uint64_t seed)
+{
+  motion->kind = MOTION_JITTER;
+  motion->spec = *spec;
+  traj_clear (&motion->traj);
+  motion->script = NULL;
+  motion->cursor = 0;
+  motion->time = 0.0;
+  rng_seed (&motion->rng, seed, 0);
+}
+
+void
+motion_script (motion_s *motion, const script_s *script)
+{
+  motion->kind = MOTION_SCRIPT;
+  traj_clear (&motion->traj);
+  motion->script = script;
+  motion->cursor = 0;
+  motion->time = 0.0;
+}
+
+void
+motion_step (motion_s *motion, double dt, double *pos)
+{
+  traj_point_s p;
+
+  motion->time += dt;
+  if (motion->kind == MOTION_SCRIPT) {
+    traj_eval_at (&motion->script->traj, &motion->cursor, motion->time, &p);
+    memcpy (pos, p.pos, sizeof(p.pos));
+    return;
+  }
+
+  // the next cycle starts from wherever the platform is
+  if (motion->time >= traj_end (&motion->traj)) {
+    traj_point_s from;
+    memset (&from, 0, sizeof(from));
+    memcpy (from.pos, pos, sizeof(from.pos));
+    motion->time -= traj_end (&motion->traj);
+    traj_clear (&motion->traj);
+    traj_jitter_cycle (&motion->traj, &from, &motion->spec, &motion->rng);
+  }
+  traj_eval (&motion->traj, motion->time, &p);
+  memcpy (pos, p.pos, sizeof(p.pos));
+}
+
+void
+geometry_to_ik (const geometry_s *g, ik_geometry_s *geo)
+{
+  for (int i = 0; i < IK_SERVOS; i++) {
+    geo->base_x[i]   = g->base_radius * cos (g->base_angle[i]);
+    geo->base_z[i]   = g->base_radius * sin (g->base_angle[i]);
+    geo->anchor_x[i] = g->platform_radius * cos (g->platform_angle[i]);
+    geo->anchor_y[i] = 0.0;
+    geo->anchor_z[i] = g->platform_radius * sin (g->platform_angle[i]);
+  }
+  geo->arm_length = g->arm_length;
+  geo->leg_length = g->leg_length;
+  ik_geometry_prepare (geo);
+  geo->h0 = ikc_h0 (geo);
+}
+
+void
+sim_instance_init (sim_instance_s *inst, const ik_geometry_s *geo)
+{
+  ik_pose_s pose;
+
+  inst->geo = *geo;
+  ik_geometry_prepare (&inst->geo);
+  inst->geo.h0 = ikc_h0 (&inst->geo);
+  memset (inst->pos, 0, sizeof(inst->pos));
+  memset (&pose, 0, sizeof(pose));
+  if (!ikc_solve (&inst->geo, &pose, inst->alpha))
+    memset (inst->alpha, 0, sizeof(inst->alpha));
+  inst->steps = 0;
+  inst->held = 0;
+}
+
+void
+sim_instance_run (sim_instance_s *inst, double dt, uint64_t n)
+{
+  uint64_t held = 0;
+  ik_pose_s pose;
+
+  // counted locally, neighbouring instances may be on other cores
+  for (uint64_t i = 0; i < n; i++) {
+    motion_step (&inst->motion, dt, inst->pos);
+    pose.delta_x = inst->pos[WS_AXIS_X];
+    pose.delta_y = inst->pos[WS_AXIS_Y];
+    pose.delta_z = inst->pos[WS_AXIS_Z];
+    pose.rho     = inst->pos[WS_AXIS_ROLL];
+    pose.theta   = inst->pos[WS_AXIS_PITCH];
+    pose.phi     = inst->pos[WS_AXIS_YAW];
+    if (!ikc_solve (&inst->geo, &pose, inst->alpha)) held++;
+  }
+  inst->steps += n;
+  inst->held += held;
+}
@@ -0,0 +1,86 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include <stdint.h>
+
+#include <string>
+
+#include "geometry.h"
+#include "ikbatch.h"
+#include "rng.h"
+#include "script.h"
+#include "trajectory.h"
+
+/***
+
+    One simulated platform, with nothing in globals: its geometry, where
+    it is, its servo angles, and what moves it.  The renderer drives its
+    one platform's pose from a motion_s; --fleet steps whole vectors of
+    sim_instance_s on all cores.
+
+ ***/
+
+typedef enum {
+  MOTION_JITTER,		// hardware4's jitter cycles, one at a time
+  MOTION_SCRIPT			// a prebuilt script, played once
+} motion_e;
+
+typedef struct {
+  motion_e        kind;
+  jitter_spec_s   spec;
+  traj_s          traj;		// MOTION_JITTER, the cycle running
+  const script_s *script;	// MOTION_SCRIPT, shared, never written
+  size_t          cursor;	// into script->traj
+  double          time;		// seconds into traj or script->traj
+  rng_s           rng;
+} motion_s;
+
+void motion_jitter (motion_s *motion, const jitter_spec_s *spec,
+		    uint64_t seed);
+void motion_script (motion_s *motion, const script_s *script);
+
+// advances dt seconds; pos is the pose in WS_AXIS_* order, read and set
+void motion_step (motion_s *motion, double dt, double *pos);
+
+typedef struct {
+  std::string   name;
+  ik_geometry_s geo;
+  motion_s      motion;
+  double        pos[WS_AXES];
+  double        alpha[IK_SERVOS];
+  uint64_t      steps;
+  uint64_t      held;		// steps the IK could not reach
+} sim_instance_s;
+
+// a geometry file's platform as the IK sees it, h0 set
+void geometry_to_ik (const geometry_s *g, ik_geometry_s *geo);
+
+// at rest at the neutral pose, geo prepared with its h0 set
+void sim_instance_init (sim_instance_s *inst, const ik_geometry_s *geo);
+
+/***
+    n fixed steps of dt: the motion, then the IK, keeping the old angles
+    for a pose out of reach the way update_alpha () does.
+ ***/
+
+void sim_instance_run (sim_instance_s *inst, double dt, uint64_t n);
+
+#endif // INSTANCE_H
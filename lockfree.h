@@ -0,0 +1,108 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef LOCKFREE_H
+#define LOCKFREE_H
+
+#include <atomic>
+
+/***
+
+    The two hand-offs between the simulation thread and the GLUT thread.
+    Neither side ever waits on the other.
+
+    triple_buffer: one writer publishes whole snapshots, one reader takes
+    the latest.  The writer fills write_buffer () and calls publish (),
+    which swaps it with the spare; the reader's read () swaps the spare
+    with its own if something new was published.  A slow reader just
+    misses snapshots, a fast one keeps getting the same one.
+
+    spsc_queue: a bounded ring, one producer and one consumer.  push ()
+    fails when the ring is full rather than blocking.
+
+ ***/
+
+#define LOCKFREE_CACHE_LINE 64
+
+template <typename T>
+class triple_buffer {
+public:
+  triple_buffer () : spare (1), back (0), front (2) {}
+
+  // before either thread starts
+  void reset (const T &v) {
+    for (int i = 0; i < 3; i++) buf[i] = v;
+  }
+
+  T *write_buffer () { return &buf[back]; }
+
+  void publish () {
+    unsigned prev = spare.exchange (back | FRESH, std::memory_order_acq_rel);
+    back = prev & INDEX;
+  }
+
+  // true if something was published since the last read ()
+  bool fresh () const {
+    return spare.load (std::memory_order_relaxed) & FRESH;
+  }
+
+  const T *read () {
+    if (fresh ()) {
+      unsigned prev = spare.exchange (front, std::memory_order_acq_rel);
+      front = prev & INDEX;
+    }
+    return &buf[front];
+  }
+
+private:
+  enum { INDEX = 3, FRESH = 4 };
+  T buf[3];
+  alignas(LOCKFREE_CACHE_LINE) std::atomic<unsigned> spare;
+  alignas(LOCKFREE_CACHE_LINE) unsigned back;		// writer's
+  alignas(LOCKFREE_CACHE_LINE) unsigned front;		// reader's
+};
+
+template <typename T, unsigned N>
+class spsc_queue {
+  static_assert ((N & (N - 1)) == 0, "spsc_queue size must be a power of 2");
+public:
+  spsc_queue () : head (0), tail (0) {}
+
+  bool push (const T &v) {
+    unsigned t = tail.load (std::memory_order_relaxed);
+    if (t - head.load (std::memory_order_acquire) == N) return false;
+    ring[t & (N - 1)] = v;
+    tail.store (t + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop (T *v) {
+    unsigned h = head.load (std::memory_order_relaxed);
+    if (h == tail.load (std::memory_order_acquire)) return false;
+    *v = ring[h & (N - 1)];
+    head.store (h + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  T ring[N];
+  alignas(LOCKFREE_CACHE_LINE) std::atomic<unsigned> head;	// consumer's
+  alignas(LOCKFREE_CACHE_LINE) std::atomic<unsigned> tail;	// producer's
+};
+
+#endif // LOCKFREE_H
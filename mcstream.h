@@ -0,0 +1,203 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef MCSTREAM_H
+#define MCSTREAM_H
+
+/***
+
+    The compiled servo command stream (compile.h writes it), one frame of
+    six servo angles per tick, for a board to play from SD or take off the
+    network without solving any IK.  Like ikcore.h this is header-only and
+    needs nothing beyond <stdint.h> and <stddef.h>, so a sketch can carry
+    a copy and decode as the bytes arrive.
+
+    All fields little endian, whatever the host.
+
+	header, MCS_HEADER_BYTES
+	    char     magic[4]		"STMC"
+	    uint16_t version
+	    uint8_t  servos		6
+	    uint8_t  reserved
+	    uint32_t rate		ticks a second
+	    uint32_t ticks
+	    uint32_t scale		nanoradians per count
+	    uint16_t sync		ticks between sync frames
+	    uint16_t reserved
+
+	frames, one per tick
+	    sync frame (tick % sync == 0): six int16_t angles, in counts
+	    delta frame: six zigzag LEB128 varints, each angle's change in
+	    counts since the tick before
+
+    Angles are servo::alpha's, radians times 1e9 / scale, odd servos
+    negated as ikc_solve () leaves them.  Between sync frames most changes
+    fit in one byte, so a frame is usually 6 bytes against 12 for plain
+    int16s; the sync frames let a player start or recover anywhere a sync
+    frame begins.
+
+ ***/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MCS_MAGIC		"STMC"
+#define MCS_VERSION		1
+#define MCS_SERVOS		6
+#define MCS_HEADER_BYTES	24
+#define MCS_FRAME_MAX		(MCS_SERVOS * 3)	// bytes, a 17 bit delta
+
+typedef struct {
+  uint32_t rate;
+  uint32_t ticks;
+  uint32_t scale;
+  uint16_t sync;
+} mcs_header_s;
+
+static inline void
+mcs_put16 (uint8_t *p, uint16_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void
+mcs_put32 (uint8_t *p, uint32_t v)
+{
+  mcs_put16 (p, (uint16_t)v);
+  mcs_put16 (p + 2, (uint16_t)(v >> 16));
+}
+
+static inline uint16_t
+mcs_get16 (const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t
+mcs_get32 (const uint8_t *p)
+{
+  return (uint32_t)mcs_get16 (p) | ((uint32_t)mcs_get16 (p + 2) << 16);
+}
+
+static inline void
+mcs_put_header (uint8_t *buf, const mcs_header_s *h)
+{
+  for (int i = 0; i < 4; i++) buf[i] = (uint8_t)MCS_MAGIC[i];
+  mcs_put16 (buf + 4, MCS_VERSION);
+  buf[6] = MCS_SERVOS;
+  buf[7] = 0;
+  mcs_put32 (buf + 8,  h->rate);
+  mcs_put32 (buf + 12, h->ticks);
+  mcs_put32 (buf + 16, h->scale);
+  mcs_put16 (buf + 20, h->sync);
+  mcs_put16 (buf + 22, 0);
+}
+
+// false if buf is not a stream this code can play
+static inline bool
+mcs_get_header (const uint8_t *buf, mcs_header_s *h)
+{
+  for (int i = 0; i < 4; i++)
+    if (buf[i] != (uint8_t)MCS_MAGIC[i]) return false;
+  if (mcs_get16 (buf + 4) != MCS_VERSION || buf[6] != MCS_SERVOS)
+    return false;
+  h->rate  = mcs_get32 (buf + 8);
+  h->ticks = mcs_get32 (buf + 12);
+  h->scale = mcs_get32 (buf + 16);
+  h->sync  = mcs_get16 (buf + 20);
+  return h->sync != 0;
+}
+
+// frame for tick into buf, MCS_FRAME_MAX bytes at most; returns its length
+static inline size_t
+mcs_put_frame (uint8_t *buf, const mcs_header_s *h, uint32_t tick,
+	       const int16_t *angle, const int16_t *prev)
+{
+  uint8_t *p = buf;
+  for (int s = 0; s < MCS_SERVOS; s++) {
+    if (tick % h->sync == 0) {
+      mcs_put16 (p, (uint16_t)angle[s]);
+      p += 2;
+      continue;
+    }
+    int32_t d = (int32_t)angle[s] - (int32_t)prev[s];
+    uint32_t z = ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+    while (z >= 0x80) {
+      *p++ = (uint8_t)(z | 0x80);
+      z >>= 7;
+    }
+    *p++ = (uint8_t)z;
+  }
+  return (size_t)(p - buf);
+}
+
+/***
+    Player state.  Set tick to the tick of the sync frame playing starts
+    at; angle is the last frame decoded.
+ ***/
+
+typedef struct {
+  mcs_header_s header;
+  uint32_t     tick;
+  int16_t      angle[MCS_SERVOS];
+} mcs_player_s;
+
+/***
+    Decodes the frame at the front of buf into player->angle and returns
+    the bytes it took, or 0 if len does not hold all of it yet or the
+    stream has ended.
+ ***/
+
+static inline size_t
+mcs_get_frame (mcs_player_s *player, const uint8_t *buf, size_t len)
+{
+  const uint8_t *p = buf, *end = buf + len;
+  int16_t next[MCS_SERVOS];
+
+  if (player->tick >= player->header.ticks) return 0;
+  for (int s = 0; s < MCS_SERVOS; s++) {
+    if (player->tick % player->header.sync == 0) {
+      if (end - p < 2) return 0;
+      next[s] = (int16_t)mcs_get16 (p);
+      p += 2;
+      continue;
+    }
+    uint32_t z = 0;
+    for (int shift = 0; ; shift += 7) {
+      if (p == end || shift > 28) return 0;
+      uint8_t b = *p++;
+      z |= (uint32_t)(b & 0x7f) << shift;
+      if (!(b & 0x80)) break;
+    }
+    int32_t d = (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+    next[s] = (int16_t)(player->angle[s] + d);
+  }
+  for (int s = 0; s < MCS_SERVOS; s++) player->angle[s] = next[s];
+  player->tick++;
+  return (size_t)(p - buf);
+}
+
+// a decoded angle in radians
+static inline double
+mcs_radians (const mcs_player_s *player, int16_t count)
+{
+  return (double)count * (double)player->header.scale * 1.0e-9;
+}
+
+#endif // MCSTREAM_H
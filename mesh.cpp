@@ -0,0 +1,370 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+
+#include "mesh.h"
+
+enum {
+  MESH_ATTR_POSITION,
+  MESH_ATTR_NORMAL,
+  MESH_ATTR_COLOUR,
+  MESH_ATTR_SCALE,
+  MESH_ATTR_MODELVIEW		// and the three after it, one per column
+};
+
+static GLuint program = 0;
+static bool instanced = false;
+
+static const char *vertex_src =
+  "#version 120\n"
+  "attribute vec3 position;\n"
+  "attribute vec3 normal;\n"
+  "attribute vec4 colour;\n"
+  "attribute vec3 scale;\n"
+  "attribute vec4 mv0, mv1, mv2, mv3;\n"
+  "varying vec4 shade;\n"
+  "void main () {\n"
+  "  mat4 mv = mat4 (mv0, mv1, mv2, mv3);\n"
+  "  gl_Position = gl_ProjectionMatrix * (mv * vec4 (position * scale, 1.0));\n"
+  "  vec3 n = normalize (mat3 (mv) * (normal / scale));\n"
+  "  vec3 c = gl_LightModel.ambient.rgb;\n"
+  "  for (int i = 0; i < 4; i++) {\n"
+  "    vec3 l = normalize (gl_LightSource[i].position.xyz);\n"
+  "    c += gl_LightSource[i].ambient.rgb +\n"
+  "         gl_LightSource[i].diffuse.rgb * max (dot (n, l), 0.0);\n"
+  "  }\n"
+  "  shade = vec4 (min (c * colour.rgb, vec3 (1.0)), colour.a);\n"
+  "}\n";
+
+static const char *fragment_src =
+  "#version 120\n"
+  "varying vec4 shade;\n"
+  "void main () {\n"
+  "  gl_FragColor = shade;\n"
+  "}\n";
+
+static GLuint
+compile_shader (GLenum type, const char *src)
+{
+  GLint ok = GL_FALSE;
+  GLuint s = glCreateShader (type);
+  glShaderSource (s, 1, &src, NULL);
+  glCompileShader (s);
+  glGetShaderiv (s, GL_COMPILE_STATUS, &ok);
+  if (!ok) {
+    char log[1024];
+    glGetShaderInfoLog (s, sizeof(log), NULL, log);
+    fprintf (stderr, "mesh shader: %s\n", log);
+    glDeleteShader (s);
+    return 0;
+  }
+  return s;
+}
+
+bool
+mesh_init ()
+{
+  static const char *mv[4] = { "mv0", "mv1", "mv2", "mv3" };
+
+  if (!GLEW_VERSION_3_3) return false;
+  GLuint vs = compile_shader (GL_VERTEX_SHADER, vertex_src);
+  GLuint fs = compile_shader (GL_FRAGMENT_SHADER, fragment_src);
+  if (!vs || !fs) return false;
+
+  program = glCreateProgram ();
+  glAttachShader (program, vs);
+  glAttachShader (program, fs);
+  glBindAttribLocation (program, MESH_ATTR_POSITION, "position");
+  glBindAttribLocation (program, MESH_ATTR_NORMAL,   "normal");
+  glBindAttribLocation (program, MESH_ATTR_COLOUR,   "colour");
+  glBindAttribLocation (program, MESH_ATTR_SCALE,    "scale");
+  for (int c = 0; c < 4; c++)
+    glBindAttribLocation (program, MESH_ATTR_MODELVIEW + c, mv[c]);
+  glLinkProgram (program);
+  glDeleteShader (vs);
+  glDeleteShader (fs);
+
+  GLint ok = GL_FALSE;
+  glGetProgramiv (program, GL_LINK_STATUS, &ok);
+  if (!ok) {
+    char log[1024];
+    glGetProgramInfoLog (program, sizeof(log), NULL, log);
+    fprintf (stderr, "mesh program: %s\n", log);
+    glDeleteProgram (program);
+    program = 0;
+    return false;
+  }
+  instanced = true;
+  return true;
+}
+
+static void
+ring (std::vector<GLfloat> &v, int slices, double z, double r,
+      double nx_scale, double nz)
+{
+  for (int i = 0; i <= slices; i++) {
+    double a = 2.0 * M_PI * (double)i / (double)slices;
+    double c = cos (a), s = sin (a);
+    GLfloat vert[6] = { (GLfloat)(r * c), (GLfloat)(r * s), (GLfloat)z,
+			(GLfloat)(nx_scale * c), (GLfloat)(nx_scale * s),
+			(GLfloat)nz };
+    v.insert (v.end (), vert, vert + 6);
+  }
+}
+
+static void
+grid (std::vector<GLuint> &idx, GLuint first, int slices, int rows)
+{
+  GLuint w = slices + 1;
+  for (int j = 0; j < rows; j++)
+    for (int i = 0; i < slices; i++) {
+      GLuint a = first + j * w + i, b = a + w;
+      GLuint quad[6] = { a, b, b + 1, a, b + 1, a + 1 };
+      idx.insert (idx.end (), quad, quad + 6);
+    }
+}
+
+// a centre vertex and a ring, facing nz
+static void
+cap (std::vector<GLfloat> &v, std::vector<GLuint> &idx, int slices,
+     double z, double nz)
+{
+  GLuint centre = v.size () / 6;
+  GLfloat vert[6] = { 0.0f, 0.0f, (GLfloat)z, 0.0f, 0.0f, (GLfloat)nz };
+  v.insert (v.end (), vert, vert + 6);
+  ring (v, slices, z, 1.0, 0.0, nz);
+  for (int i = 0; i < slices; i++) {
+    GLuint a = centre + 1 + i;
+    GLuint tri[3] = { centre, nz > 0.0 ? a : a + 1, nz > 0.0 ? a + 1 : a };
+    idx.insert (idx.end (), tri, tri + 3);
+  }
+}
+
+void
+mesh_build (mesh_s *mesh, mesh_kind_e kind, int slices, int stacks)
+{
+  std::vector<GLfloat> v;
+  std::vector<GLuint> idx;
+
+  mesh->kind = kind;
+  mesh->slices = slices;
+  mesh->stacks = stacks;
+  mesh->vbo = mesh->ibo = 0;
+  mesh->indices = 0;
+  if (!instanced) return;
+
+  if (kind == MESH_SPHERE) {
+    for (int j = 0; j <= stacks; j++) {
+      double phi = M_PI * (double)j / (double)stacks;
+      double r = sin (phi), z = cos (phi);
+      // a unit sphere's normal is its position
+      for (int i = 0; i <= slices; i++) {
+	double a = 2.0 * M_PI * (double)i / (double)slices;
+	GLfloat vert[6] = { (GLfloat)(r * cos (a)), (GLfloat)(r * sin (a)),
+			    (GLfloat)z, (GLfloat)(r * cos (a)),
+			    (GLfloat)(r * sin (a)), (GLfloat)z };
+	v.insert (v.end (), vert, vert + 6);
+      }
+    }
+    grid (idx, 0, slices, stacks);
+  }
+  else {
+    for (int j = 0; j <= stacks; j++)
+      ring (v, slices, (double)j / (double)stacks, 1.0, 1.0, 0.0);
+    grid (idx, 0, slices, stacks);
+    cap (v, idx, slices, 0.0, -1.0);
+    cap (v, idx, slices, 1.0, 1.0);
+  }
+
+  glGenBuffers (1, &mesh->vbo);
+  glBindBuffer (GL_ARRAY_BUFFER, mesh->vbo);
+  glBufferData (GL_ARRAY_BUFFER, v.size () * sizeof(GLfloat), v.data (),
+		GL_STATIC_DRAW);
+  glGenBuffers (1, &mesh->ibo);
+  glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, mesh->ibo);
+  glBufferData (GL_ELEMENT_ARRAY_BUFFER, idx.size () * sizeof(GLuint),
+		idx.data (), GL_STATIC_DRAW);
+  glBindBuffer (GL_ARRAY_BUFFER, 0);
+  glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+  mesh->indices = (GLsizei)idx.size ();
+}
+
+void
+mesh_add (mesh_batch_s *batch, const float *modelview, float sx, float sy,
+	  float sz, const float *rgb)
+{
+  mesh_instance_s inst;
+  memcpy (inst.modelview, modelview, sizeof(inst.modelview));
+  inst.colour[0] = rgb[0];
+  inst.colour[1] = rgb[1];
+  inst.colour[2] = rgb[2];
+  inst.colour[3] = 1.0f;
+  inst.scale[0] = sx;
+  inst.scale[1] = sy;
+  inst.scale[2] = sz;
+  inst.pad = 0.0f;
+  batch->inst.push_back (inst);
+}
+
+static void
+draw_fallback (const mesh_s *mesh, const mesh_batch_s *batch)
+{
+  glPushMatrix ();
+  glEnable (GL_NORMALIZE);		// the scale is in the modelview
+  for (size_t i = 0; i < batch->inst.size (); i++) {
+    const mesh_instance_s *in = &batch->inst[i];
+    glLoadMatrixf (in->modelview);
+    glScalef (in->scale[0], in->scale[1], in->scale[2]);
+    glColor3fv (in->colour);
+    if (mesh->kind == MESH_SPHERE)
+      glutSolidSphere (1.0, mesh->slices, mesh->stacks);
+    else glutSolidCylinder (1.0, 1.0, mesh->slices, mesh->stacks);
+  }
+  glDisable (GL_NORMALIZE);
+  glPopMatrix ();
+}
+
+static void
+instance_attrib (GLuint loc, GLint size, size_t offset)
+{
+  glEnableVertexAttribArray (loc);
+  glVertexAttribPointer (loc, size, GL_FLOAT, GL_FALSE,
+			 sizeof(mesh_instance_s), (const void *)offset);
+  glVertexAttribDivisor (loc, 1);
+}
+
+// what glutSolid* draws for the fallback, or the index count
+static size_t
+mesh_triangles (const mesh_s *mesh)
+{
+  if (mesh->vbo) return mesh->indices / 3;
+  if (mesh->kind == MESH_SPHERE) return 2 * mesh->slices * mesh->stacks;
+  return 2 * mesh->slices * mesh->stacks + 2 * mesh->slices;
+}
+
+size_t
+mesh_draw (const mesh_s *mesh, mesh_batch_s *batch)
+{
+  size_t triangles = batch->inst.size () * mesh_triangles (mesh);
+  if (batch->inst.empty ()) return 0;
+  if (!instanced || !mesh->vbo) {
+    draw_fallback (mesh, batch);
+    batch->inst.clear ();
+    return triangles;
+  }
+
+  // orphan and refill, the driver need not wait for last frame's draw
+  GLsizeiptr bytes = batch->inst.size () * sizeof(mesh_instance_s);
+  if (!batch->vbo) glGenBuffers (1, &batch->vbo);
+  glBindBuffer (GL_ARRAY_BUFFER, batch->vbo);
+  if (bytes > batch->size) batch->size = bytes;
+  glBufferData (GL_ARRAY_BUFFER, batch->size, NULL, GL_STREAM_DRAW);
+  glBufferSubData (GL_ARRAY_BUFFER, 0, bytes, batch->inst.data ());
+  instance_attrib (MESH_ATTR_COLOUR, 4, offsetof (mesh_instance_s, colour));
+  instance_attrib (MESH_ATTR_SCALE, 3, offsetof (mesh_instance_s, scale));
+  for (int c = 0; c < 4; c++)
+    instance_attrib (MESH_ATTR_MODELVIEW + c, 4,
+		     offsetof (mesh_instance_s, modelview) +
+		     c * 4 * sizeof(float));
+
+  glBindBuffer (GL_ARRAY_BUFFER, mesh->vbo);
+  glEnableVertexAttribArray (MESH_ATTR_POSITION);
+  glVertexAttribPointer (MESH_ATTR_POSITION, 3, GL_FLOAT, GL_FALSE,
+			 6 * sizeof(GLfloat), (const void *)0);
+  glEnableVertexAttribArray (MESH_ATTR_NORMAL);
+  glVertexAttribPointer (MESH_ATTR_NORMAL, 3, GL_FLOAT, GL_FALSE,
+			 6 * sizeof(GLfloat),
+			 (const void *)(3 * sizeof(GLfloat)));
+  glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, mesh->ibo);
+
+  glUseProgram (program);
+  glDrawElementsInstanced (GL_TRIANGLES, mesh->indices, GL_UNSIGNED_INT,
+			   (const void *)0, (GLsizei)batch->inst.size ());
+  glUseProgram (0);
+
+  // leave nothing behind for the fixed function drawing
+  for (GLuint loc = MESH_ATTR_POSITION; loc < MESH_ATTR_MODELVIEW + 4;
+       loc++) {
+    glVertexAttribDivisor (loc, 0);
+    glDisableVertexAttribArray (loc);
+  }
+  glBindBuffer (GL_ARRAY_BUFFER, 0);
+  glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+  batch->inst.clear ();
+  return triangles;
+}
+
+static const int lod_slices[MESH_LODS] = { 32, 16, 10, 6 };
+
+int
+mesh_lod_slices (int level)
+{
+  return lod_slices[level];
+}
+
+void
+mesh_lod_build (mesh_lod_s *lod, mesh_kind_e kind)
+{
+  for (int l = 0; l < MESH_LODS; l++) {
+    int s = lod_slices[l];
+    mesh_build (&lod->level[l], kind, s,
+		(kind == MESH_SPHERE) ? s / 2 : 1);
+    lod->batch[l].inst.clear ();
+    lod->batch[l].vbo = 0;
+    lod->batch[l].size = 0;
+  }
+}
+
+void
+mesh_lod_add (mesh_lod_s *lod, const float *modelview, float sx, float sy,
+	      float sz, const float *rgb, double pixels)
+{
+  // the silhouette's radius in pixels, from the distance along the view
+  double depth = -modelview[14];
+  double r = fmax (fabs (sx), fabs (sy));
+  if (lod->level[0].kind == MESH_SPHERE) r = fmax (r, fabs (sz));
+  int level = 0;
+  if (depth > 0.0) {
+    double r_px = r * pixels / depth;
+    // a facet of an s-gon falls r (1 - cos (pi / s)) inside the circle
+    while (level + 1 < MESH_LODS &&
+	   r_px * (1.0 - cos (M_PI / lod_slices[level + 1])) <=
+	   MESH_LOD_ERROR)
+      level++;
+  }
+  mesh_add (&lod->batch[level], modelview, sx, sy, sz, rgb);
+}
+
+void
+mesh_lod_draw (mesh_lod_s *lod, mesh_stats_s *stats)
+{
+  for (int l = 0; l < MESH_LODS; l++) {
+    int n = (int)lod->batch[l].inst.size ();
+    if (n == 0) continue;
+    stats->instances[l] += n;
+    stats->triangles += mesh_draw (&lod->level[l], &lod->batch[l]);
+    stats->draws += (instanced && lod->level[l].vbo) ? 1 : n;
+  }
+}
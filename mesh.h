@@ -0,0 +1,122 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef MESH_H
+#define MESH_H
+
+#include <vector>
+
+#include <GL/glew.h>
+
+/***
+
+    Cached meshes for the balls and rods of the mechanism.  The unit
+    sphere and cylinder are built once into buffer objects; every frame
+    the show_ functions add one instance per ball or rod to a batch, its
+    modelview, scale and colour, and mesh_draw () puts the whole batch
+    on screen with a single instanced draw call.
+
+    The shader does what the fixed function pipeline did for glutSolid*:
+    per-vertex diffuse lighting from the enabled GL_LIGHTn and the light
+    model ambient, the instance colour standing in for GL_COLOR_MATERIAL.
+    Without GL 3.3, whose core glVertexAttribDivisor and
+    glDrawElementsInstanced it calls, or if the shader will not build,
+    mesh_draw () falls back to glutSolidSphere and glutSolidCylinder, one
+    per instance, with no flushes.
+
+    The modelview must be a rotation and translation; the scale is kept
+    apart so the shader can fix up the normals.
+
+    Each shape comes in MESH_LODS tessellations.  mesh_lod_add () puts an
+    instance in the batch of the coarsest level whose facets stay within
+    MESH_LOD_ERROR pixels of the true outline at the instance's distance,
+    so far away balls cost a few dozen triangles instead of two thousand.
+    Cylinders have straight sides and per-vertex lighting does not change
+    along them, so they get one stack at every level.
+
+ ***/
+
+#define MESH_LODS	4
+#define MESH_LOD_ERROR	0.5		// pixels, outline to facet
+
+typedef enum {
+  MESH_SPHERE,			// radius 1 about the origin
+  MESH_CYLINDER			// radius 1, from z = 0 to z = 1, capped
+} mesh_kind_e;
+
+typedef struct {
+  mesh_kind_e kind;
+  int         slices;
+  int         stacks;
+  GLuint      vbo;		// position, normal, interleaved
+  GLuint      ibo;
+  GLsizei     indices;
+} mesh_s;
+
+typedef struct {
+  float modelview[16];		// column major, as glLoadMatrixf takes
+  float colour[4];
+  float scale[3];
+  float pad;
+} mesh_instance_s;
+
+typedef struct {
+  std::vector<mesh_instance_s> inst;
+  GLuint                       vbo;	// instance data, 0 until first draw
+  GLsizeiptr                   size;	// of vbo, bytes
+} mesh_batch_s;
+
+// once there is a GL context; false if only the fallback will be used
+bool mesh_init ();
+
+void mesh_build (mesh_s *mesh, mesh_kind_e kind, int slices, int stacks);
+
+void mesh_add (mesh_batch_s *batch, const float *modelview,
+	       float sx, float sy, float sz, const float *rgb);
+
+// draws and empties the batch; returns the triangles drawn
+size_t mesh_draw (const mesh_s *mesh, mesh_batch_s *batch);
+
+typedef struct {
+  mesh_s       level[MESH_LODS];	// finest first
+  mesh_batch_s batch[MESH_LODS];
+} mesh_lod_s;
+
+typedef struct {
+  size_t triangles;
+  int    draws;
+  int    instances[MESH_LODS];
+} mesh_stats_s;
+
+// slices round the axis at level
+int  mesh_lod_slices (int level);
+
+void mesh_lod_build (mesh_lod_s *lod, mesh_kind_e kind);
+
+/***
+    pixels is how many pixels a unit length covers one unit in front of
+    the eye, viewport height / 2 * the projection's cot (fovy / 2).
+ ***/
+
+void mesh_lod_add (mesh_lod_s *lod, const float *modelview, float sx,
+		   float sy, float sz, const float *rgb, double pixels);
+
+// draws and empties every level's batch, adding to stats
+void mesh_lod_draw (mesh_lod_s *lod, mesh_stats_s *stats);
+
+#endif // MESH_H
@@ -0,0 +1,175 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "offscreen.h"
+
+static EGLDisplay
+get_display ()
+{
+#if defined (EGL_PLATFORM_SURFACELESS_MESA)
+  const char *ext = eglQueryString (EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+    (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+    eglGetProcAddress ("eglGetPlatformDisplayEXT");
+  if (ext && strstr (ext, "EGL_MESA_platform_surfaceless") &&
+      get_platform_display) {
+    EGLDisplay d = get_platform_display (EGL_PLATFORM_SURFACELESS_MESA,
+					 EGL_DEFAULT_DISPLAY, NULL);
+    if (d != EGL_NO_DISPLAY) return d;
+  }
+#endif
+  return eglGetDisplay (EGL_DEFAULT_DISPLAY);
+}
+
+bool
+offscreen_open (offscreen_s *off, int width, int height)
+{
+  static const EGLint config_attribs[] = {
+    EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+    EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+    EGL_NONE
+  };
+  static const EGLint context_attribs[] = {
+    EGL_CONTEXT_OPENGL_PROFILE_MASK,
+    EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+    EGL_NONE
+  };
+  static const EGLint pbuffer_attribs[] = {
+    EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE
+  };
+  EGLint major, minor, configs = 0;
+  EGLConfig config;
+
+  memset (off, 0, sizeof(*off));
+  off->surface = EGL_NO_SURFACE;
+  off->context = EGL_NO_CONTEXT;
+  off->width = width;
+  off->height = height;
+
+  off->display = get_display ();
+  if (off->display == EGL_NO_DISPLAY ||
+      !eglInitialize (off->display, &major, &minor)) {
+    fprintf (stderr, "offscreen: no EGL display\n");
+    return false;
+  }
+  if (!eglBindAPI (EGL_OPENGL_API)) {
+    fprintf (stderr, "offscreen: no desktop OpenGL\n");
+    eglTerminate (off->display);
+    return false;
+  }
+  // a surfaceless context can do without a config
+  if (!eglChooseConfig (off->display, config_attribs, &config, 1, &configs) ||
+      configs < 1)
+    config = EGL_NO_CONFIG_KHR;
+  off->context = eglCreateContext (off->display, config, EGL_NO_CONTEXT,
+				   context_attribs);
+  if (off->context == EGL_NO_CONTEXT) {
+    fprintf (stderr, "offscreen: no context, EGL error 0x%x\n",
+	     eglGetError ());
+    eglTerminate (off->display);
+    return false;
+  }
+  // surfaceless first, a pbuffer only for an EGL that wants one
+  if (!eglMakeCurrent (off->display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+		       off->context)) {
+    if (config != EGL_NO_CONFIG_KHR)
+      off->surface = eglCreatePbufferSurface (off->display, config,
+					      pbuffer_attribs);
+    if (off->surface == EGL_NO_SURFACE ||
+	!eglMakeCurrent (off->display, off->surface, off->surface,
+			 off->context)) {
+      fprintf (stderr, "offscreen: cannot make the context current\n");
+      offscreen_close (off);
+      return false;
+    }
+  }
+
+  // a GLX build of GLEW loads the GL entry points, then finds no X display
+  GLenum err = glewInit ();
+#if defined (GLEW_ERROR_NO_GLX_DISPLAY)
+  if (err == GLEW_ERROR_NO_GLX_DISPLAY) err = GLEW_OK;
+#endif
+  if (err != GLEW_OK || !glGenFramebuffers) {
+    fprintf (stderr, "offscreen: glew: %s\n", glewGetErrorString (err));
+    offscreen_close (off);
+    return false;
+  }
+
+  glGenFramebuffers (1, &off->fbo);
+  glBindFramebuffer (GL_FRAMEBUFFER, off->fbo);
+  glGenRenderbuffers (1, &off->colour);
+  glBindRenderbuffer (GL_RENDERBUFFER, off->colour);
+  glRenderbufferStorage (GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+			     GL_RENDERBUFFER, off->colour);
+  glGenRenderbuffers (1, &off->depth);
+  glBindRenderbuffer (GL_RENDERBUFFER, off->depth);
+  glRenderbufferStorage (GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+  glFramebufferRenderbuffer (GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+			     GL_RENDERBUFFER, off->depth);
+  glBindRenderbuffer (GL_RENDERBUFFER, 0);
+  GLenum status = glCheckFramebufferStatus (GL_FRAMEBUFFER);
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
+    fprintf (stderr, "offscreen: %dx%d framebuffer incomplete, 0x%x\n",
+	     width, height, status);
+    offscreen_close (off);
+    return false;
+  }
+  glDrawBuffer (GL_COLOR_ATTACHMENT0);
+  glReadBuffer (GL_COLOR_ATTACHMENT0);
+  glViewport (0, 0, width, height);
+
+  fprintf (stderr, "offscreen: %dx%d on %s\n", width, height,
+	   (const char *)glGetString (GL_RENDERER));
+  return true;
+}
+
+void
+offscreen_close (offscreen_s *off)
+{
+  if (off->context != EGL_NO_CONTEXT) {
+    if (off->fbo) {
+      glBindFramebuffer (GL_FRAMEBUFFER, 0);
+      glDeleteFramebuffers (1, &off->fbo);
+      glDeleteRenderbuffers (1, &off->colour);
+      glDeleteRenderbuffers (1, &off->depth);
+      off->fbo = off->colour = off->depth = 0;
+    }
+    eglMakeCurrent (off->display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+		    EGL_NO_CONTEXT);
+    eglDestroyContext (off->display, off->context);
+    off->context = EGL_NO_CONTEXT;
+  }
+  if (off->surface != EGL_NO_SURFACE) {
+    eglDestroySurface (off->display, off->surface);
+    off->surface = EGL_NO_SURFACE;
+  }
+  if (off->display != EGL_NO_DISPLAY) {
+    eglTerminate (off->display);
+    off->display = EGL_NO_DISPLAY;
+  }
+}
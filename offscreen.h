@@ -0,0 +1,53 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+
+#ifndef OFFSCREEN_H
+#define OFFSCREEN_H
+
+#include <GL/glew.h>
+#include <EGL/egl.h>
+
+/***
+
+    An OpenGL context with no window, for rendering video on machines
+    with no display and no GPU.  offscreen_open () gets a compatibility
+    profile context from EGL, on Mesa's surfaceless platform where there
+    is one (llvmpipe needs nothing else) and on the default display with
+    a 1x1 pbuffer otherwise.  It then binds a framebuffer object of the
+    given size, RGBA8 with a 24 bit depth buffer, that everything is
+    drawn into and glReadPixels reads from GL_COLOR_ATTACHMENT0.
+
+ ***/
+
+typedef struct {
+  EGLDisplay display;
+  EGLContext context;
+  EGLSurface surface;		// EGL_NO_SURFACE when surfaceless
+  GLuint     fbo;
+  GLuint     colour;		// renderbuffers
+  GLuint     depth;
+  int        width, height;
+} offscreen_s;
+
+// makes the context current and the framebuffer bound; false if it cannot
+bool offscreen_open (offscreen_s *off, int width, int height);
+
+void offscreen_close (offscreen_s *off);
+
+#endif // OFFSCREEN_H
@@ -0,0 +1,412 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "optimize.h"
+#include "fk.h"
+#include "instance.h"
+#include "parallel.h"
+#include "rng.h"
+
+#define OPT_CR		0.9		// crossover probability
+#define OPT_F		0.6		// differential weight
+#define OPT_SCALARS	4		// radii and lengths, then the angles
+#define OPT_DIMS	(OPT_SCALARS + 2 * GEOMETRY_SERVOS)
+#define D2R(d)		((d) * M_PI / 180.0)
+#define R2D(r)		((r) * 180.0 / M_PI)
+
+void
+opt_spec_default (opt_spec_s *spec)
+{
+  spec->objective   = OPT_VOLUME;
+  spec->population  = 40;
+  spec->generations = 60;
+  spec->samples     = 4096;
+  spec->seed        = 1;
+  spec->base_lo     = 4.0;
+  spec->base_hi     = 10.0;
+  spec->platform_lo = 1.0;
+  spec->platform_hi = 4.0;
+  spec->arm_lo      = 1.0;
+  spec->arm_hi      = 3.0;
+  spec->leg_lo      = 6.0;
+  spec->leg_hi      = 12.0;
+  spec->span        = 20.0;
+  spec->gap         = 15.0;
+  spec->out         = "optimized.geo";
+}
+
+bool
+opt_spec_parse (opt_spec_s *spec, const char *arg)
+{
+  static const struct {
+    const char *key;
+    double opt_spec_s::*lo;
+    double opt_spec_s::*hi;
+  } ranges[] = {
+    { "base",     &opt_spec_s::base_lo,     &opt_spec_s::base_hi },
+    { "platform", &opt_spec_s::platform_lo, &opt_spec_s::platform_hi },
+    { "arm",      &opt_spec_s::arm_lo,      &opt_spec_s::arm_hi },
+    { "leg",      &opt_spec_s::leg_lo,      &opt_spec_s::leg_hi },
+  };
+  opt_spec_s lcl = *spec;
+  char *copy = strdup (arg);
+  bool ok = true;
+
+  for (char *tok = strtok (copy, ","); ok && tok; tok = strtok (NULL, ",")) {
+    char *eq = strchr (tok, '=');
+    if (!eq) {
+      if (!strcmp (tok, "volume"))         lcl.objective = OPT_VOLUME;
+      else if (!strcmp (tok, "dexterity")) lcl.objective = OPT_DEXTERITY;
+      else ok = false;
+      continue;
+    }
+    *eq++ = 0;
+    char *end;
+    if (!strcmp (tok, "out")) {
+      if (*eq) lcl.out = strdup (eq);
+      else ok = false;
+      continue;
+    }
+    if (!strcmp (tok, "population") || !strcmp (tok, "generations") ||
+	!strcmp (tok, "samples") || !strcmp (tok, "seed")) {
+      unsigned long long n = strtoull (eq, &end, 0);
+      if (end == eq || *end) ok = false;
+      else if (!strcmp (tok, "population"))  lcl.population = (unsigned)n;
+      else if (!strcmp (tok, "generations")) lcl.generations = (unsigned)n;
+      else if (!strcmp (tok, "samples"))     lcl.samples = n;
+      else lcl.seed = n;
+      continue;
+    }
+    if (!strcmp (tok, "span") || !strcmp (tok, "gap")) {
+      double v = strtod (eq, &end);
+      if (end == eq || *end || v < 0.0) ok = false;
+      else if (!strcmp (tok, "span")) lcl.span = v;
+      else lcl.gap = v;
+      continue;
+    }
+    int k;
+    for (k = 0; k < (int)(sizeof(ranges) / sizeof(ranges[0])); k++)
+      if (!strcmp (tok, ranges[k].key)) break;
+    if (k == (int)(sizeof(ranges) / sizeof(ranges[0]))) ok = false;
+    else {
+      double lo, hi;
+      char *colon = strchr (eq, ':');
+      if (!colon) ok = false;
+      else {
+	*colon++ = 0;
+	lo = strtod (eq, &end);
+	if (end == eq || *end) ok = false;
+	hi = strtod (colon, &end);
+	if (end == colon || *end) ok = false;
+	if (ok && (lo <= 0.0 || hi < lo)) ok = false;
+	if (ok) {
+	  lcl.*ranges[k].lo = lo;
+	  lcl.*ranges[k].hi = hi;
+	}
+      }
+    }
+  }
+  free (copy);
+
+  // DE/rand/1 needs three members besides the one being replaced
+  if (ok && (lcl.population < 4 || lcl.generations == 0 || lcl.samples == 0))
+    ok = false;
+  if (ok) *spec = lcl;
+  return ok;
+}
+
+typedef struct {
+  double volume;		// reachable share of the samples
+  double dexterity;		// sum of 1 / cond over the samples, shared
+} opt_score_s;
+
+static void
+to_geometry (const double *x, const geometry_s *start, geometry_s *g)
+{
+  *g = *start;
+  g->base_radius     = x[0];
+  g->platform_radius = x[1];
+  g->arm_length      = x[2];
+  g->leg_length      = x[3];
+  for (int i = 0; i < GEOMETRY_SERVOS; i++) {
+    g->base_angle[i]     = x[OPT_SCALARS + i];
+    g->platform_angle[i] = x[OPT_SCALARS + GEOMETRY_SERVOS + i];
+  }
+}
+
+static void
+from_geometry (const geometry_s *g, double *x)
+{
+  x[0] = g->base_radius;
+  x[1] = g->platform_radius;
+  x[2] = g->arm_length;
+  x[3] = g->leg_length;
+  for (int i = 0; i < GEOMETRY_SERVOS; i++) {
+    x[OPT_SCALARS + i]                   = g->base_angle[i];
+    x[OPT_SCALARS + GEOMETRY_SERVOS + i] = g->platform_angle[i];
+  }
+}
+
+// least angle between neighbours going round the circle
+static double
+min_gap (const double *angle)
+{
+  double a[GEOMETRY_SERVOS];
+  for (int i = 0; i < GEOMETRY_SERVOS; i++) {
+    a[i] = fmod (angle[i], 2.0 * M_PI);
+    if (a[i] < 0.0) a[i] += 2.0 * M_PI;
+  }
+  std::sort (a, a + GEOMETRY_SERVOS);
+  double gap = a[0] + 2.0 * M_PI - a[GEOMETRY_SERVOS - 1];
+  for (int i = 1; i < GEOMETRY_SERVOS; i++)
+    gap = std::min (gap, a[i] - a[i - 1]);
+  return gap;
+}
+
+typedef struct {
+  std::vector<double>        alphas;
+  std::vector<unsigned char> valid;
+  uint64_t                   ik_calls;
+} opt_scratch_s;
+
+static bool
+evaluate (const geometry_s *g, const opt_spec_s *spec,
+	  const std::vector<ik_pose_s> &poses, opt_scratch_s *scratch,
+	  opt_score_s *score)
+{
+  ik_geometry_s geo;
+  ik_pose_s neutral;
+  double alpha[IK_SERVOS];
+
+  if (min_gap (g->base_angle) < D2R (spec->gap) ||
+      min_gap (g->platform_angle) < D2R (spec->gap))
+    return false;
+  geometry_to_ik (g, &geo);
+  if (!isfinite (geo.h0)) return false;
+  memset (&neutral, 0, sizeof(neutral));
+  if (!ikc_solve (&geo, &neutral, alpha)) return false;
+
+  size_t n = poses.size ();
+  size_t reachable = ik_batch (&geo, poses.data (), scratch->alphas.data (),
+			       scratch->valid.data (), n);
+  scratch->ik_calls += n;
+  score->volume = (double)reachable / (double)n;
+  score->dexterity = 0.0;
+  if (spec->objective == OPT_DEXTERITY) {
+    for (size_t i = 0; i < n; i++) {
+      fk_jacobian_s jac;
+      if (scratch->valid[i] &&
+	  fk_jacobian (&geo, &scratch->alphas[i * IK_SERVOS], &poses[i], &jac))
+	score->dexterity += 1.0 / jac.cond;
+    }
+    score->dexterity /= (double)n;
+  }
+  return true;
+}
+
+static double
+objective (const opt_spec_s *spec, const opt_score_s *s)
+{
+  return (spec->objective == OPT_VOLUME) ? s->volume : s->dexterity;
+}
+
+int
+opt_run (geometry_s *geo, const ws_spec_s *box, const opt_spec_s *spec)
+{
+  struct timespec start, end;
+  clock_gettime (CLOCK_MONOTONIC, &start);
+
+  ws_spec_s halton = *box;
+  halton.mode = WS_HALTON;
+  halton.samples = spec->samples;
+  std::vector<ik_pose_s> poses (spec->samples);
+  for (uint64_t i = 0; i < spec->samples; i++)
+    ws_sample_pose (&halton, i, &poses[i]);
+
+  double lo[OPT_DIMS], hi[OPT_DIMS], x0[OPT_DIMS];
+  from_geometry (geo, x0);
+  lo[0] = spec->base_lo;     hi[0] = spec->base_hi;
+  lo[1] = spec->platform_lo; hi[1] = spec->platform_hi;
+  lo[2] = spec->arm_lo;      hi[2] = spec->arm_hi;
+  lo[3] = spec->leg_lo;      hi[3] = spec->leg_hi;
+  for (int d = OPT_SCALARS; d < OPT_DIMS; d++) {
+    lo[d] = x0[d] - D2R (spec->span);
+    hi[d] = x0[d] + D2R (spec->span);
+  }
+  for (int d = 0; d < OPT_DIMS; d++)
+    x0[d] = std::min (hi[d], std::max (lo[d], x0[d]));
+
+  int nthreads = parallel_threads ();
+  std::vector<opt_scratch_s> scratch (nthreads);
+  for (int t = 0; t < nthreads; t++) {
+    scratch[t].alphas.resize (spec->samples * IK_SERVOS);
+    scratch[t].valid.resize (spec->samples);
+    scratch[t].ik_calls = 0;
+  }
+
+  unsigned np = spec->population;
+  std::vector<double> pop (np * OPT_DIMS), trial (np * OPT_DIMS);
+  std::vector<opt_score_s> score (np), trial_score (np);
+  std::vector<double> fit (np), trial_fit (np);
+  uint64_t candidates = 0;
+
+  // every member of a batch is scored independently, -1 if infeasible
+  auto score_all = [&](const std::vector<double> &x,
+		       std::vector<opt_score_s> &s, std::vector<double> &f) {
+    parallel_for (np, 1, [&](size_t begin, size_t end, int t) {
+	for (size_t i = begin; i < end; i++) {
+	  geometry_s g;
+	  to_geometry (&x[i * OPT_DIMS], geo, &g);
+	  if (evaluate (&g, spec, poses, &scratch[t], &s[i]))
+	    f[i] = objective (spec, &s[i]);
+	  else {
+	    s[i].volume = s[i].dexterity = 0.0;
+	    f[i] = -1.0;
+	  }
+	}
+      });
+    candidates += np;
+  };
+
+  // the starting geometry is member 0, the rest are uniform in the bounds
+  rng_s r;
+  rng_seed (&r, spec->seed, 0);
+  memcpy (&pop[0], x0, sizeof(x0));
+  for (unsigned i = 1; i < np; i++)
+    for (int d = 0; d < OPT_DIMS; d++)
+      pop[i * OPT_DIMS + d] = lo[d] + rng_uniform (&r) * (hi[d] - lo[d]);
+  score_all (pop, score, fit);
+  opt_score_s start_score = score[0];
+  double start_fit = fit[0];
+
+  unsigned report = std::max (1u, spec->generations / 10);
+  fprintf (stdout, "optimize: %s, population %u, %llu samples per "
+	   "candidate, %d threads, %s kernel\n",
+	   (spec->objective == OPT_VOLUME) ? "volume" : "dexterity", np,
+	   (unsigned long long)spec->samples, nthreads, ik_batch_isa ());
+
+  for (unsigned gen = 0; gen < spec->generations; gen++) {
+    rng_seed (&r, spec->seed, gen + 1);
+    for (unsigned i = 0; i < np; i++) {
+      unsigned a, b, c;
+      do a = (unsigned)(rng_next (&r) % np); while (a == i);
+      do b = (unsigned)(rng_next (&r) % np); while (b == i || b == a);
+      do c = (unsigned)(rng_next (&r) % np); while (c == i || c == a || c == b);
+      int jrand = (int)(rng_next (&r) % OPT_DIMS);
+      const double *xi = &pop[i * OPT_DIMS];
+      double *ti = &trial[i * OPT_DIMS];
+      for (int d = 0; d < OPT_DIMS; d++) {
+	if (d != jrand && rng_uniform (&r) >= OPT_CR) {
+	  ti[d] = xi[d];
+	  continue;
+	}
+	double v = pop[a * OPT_DIMS + d] +
+	  OPT_F * (pop[b * OPT_DIMS + d] - pop[c * OPT_DIMS + d]);
+	// out of bounds goes halfway back towards the parent
+	if (v < lo[d]) v = 0.5 * (lo[d] + xi[d]);
+	if (v > hi[d]) v = 0.5 * (hi[d] + xi[d]);
+	ti[d] = v;
+      }
+    }
+    score_all (trial, trial_score, trial_fit);
+    for (unsigned i = 0; i < np; i++) {
+      if (trial_fit[i] < fit[i]) continue;
+      memcpy (&pop[i * OPT_DIMS], &trial[i * OPT_DIMS],
+	      OPT_DIMS * sizeof(double));
+      score[i] = trial_score[i];
+      fit[i] = trial_fit[i];
+    }
+
+    if ((gen + 1) % report == 0 || gen + 1 == spec->generations) {
+      double best = -1.0, sum = 0.0;
+      unsigned feasible = 0;
+      for (unsigned i = 0; i < np; i++) {
+	best = std::max (best, fit[i]);
+	if (fit[i] >= 0.0) {
+	  sum += fit[i];
+	  feasible++;
+	}
+      }
+      fprintf (stdout, "gen %5u  best %.5f  mean %.5f  feasible %u\n",
+	       gen + 1, best, feasible ? sum / feasible : 0.0, feasible);
+    }
+  }
+
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  double secs = (double)(end.tv_sec - start.tv_sec) +
+    1.0e-9 * (double)(end.tv_nsec - start.tv_nsec);
+  uint64_t ik_calls = 0;
+  for (int t = 0; t < nthreads; t++) ik_calls += scratch[t].ik_calls;
+
+  unsigned best = 0;
+  for (unsigned i = 1; i < np; i++)
+    if (fit[i] > fit[best]) best = i;
+  fprintf (stdout, "time:     %.3f sec, %llu candidates, %.0f IK "
+	   "solutions/sec\n", secs, (unsigned long long)candidates,
+	   (double)ik_calls / secs);
+  if (fit[best] < 0.0) {
+    fprintf (stderr, "optimize: no feasible geometry within the bounds\n");
+    return -1;
+  }
+
+  double volume = 1.0;
+  for (int a = 0; a < WS_AXES; a++) volume *= box->max[a] - box->min[a];
+
+  geometry_s win;
+  to_geometry (&pop[best * OPT_DIMS], geo, &win);
+  fprintf (stdout, "\n%-18s %12s %12s\n", "", "start", "winner");
+  if (start_fit >= 0.0)
+    fprintf (stdout, "%-18s %12.5f %12.5f\n", "reachable share",
+	     start_score.volume, score[best].volume);
+  else
+    fprintf (stdout, "%-18s %12s %12.5f\n", "reachable share",
+	     "infeasible", score[best].volume);
+  fprintf (stdout, "%-18s %12.5g %12.5g\n", "volume cm^3 rad^3",
+	   start_score.volume * volume, score[best].volume * volume);
+  if (spec->objective == OPT_DEXTERITY)
+    fprintf (stdout, "%-18s %12.5f %12.5f\n", "dexterity",
+	     start_score.dexterity, score[best].dexterity);
+  fprintf (stdout, "%-18s %12.5g %12.5g\n", "base_radius",
+	   geo->base_radius, win.base_radius);
+  fprintf (stdout, "%-18s %12.5g %12.5g\n", "platform_radius",
+	   geo->platform_radius, win.platform_radius);
+  fprintf (stdout, "%-18s %12.5g %12.5g\n", "arm_length",
+	   geo->arm_length, win.arm_length);
+  fprintf (stdout, "%-18s %12.5g %12.5g\n", "leg_length",
+	   geo->leg_length, win.leg_length);
+  for (int i = 0; i < GEOMETRY_SERVOS; i++)
+    fprintf (stdout, "base angle %d (deg) %12.5g %12.5g\n", i,
+	     R2D (geo->base_angle[i]), R2D (win.base_angle[i]));
+  for (int i = 0; i < GEOMETRY_SERVOS; i++)
+    fprintf (stdout, "plat angle %d (deg) %12.5g %12.5g\n", i,
+	     R2D (geo->platform_angle[i]), R2D (win.platform_angle[i]));
+
+  *geo = win;
+  if (!geometry_save (spec->out, geo)) return -1;
+  fprintf (stdout, "\nwritten to %s\n", spec->out);
+  return 0;
+}
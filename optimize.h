@@ -0,0 +1,92 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include <stdint.h>
+
+#include "geometry.h"
+#include "workspace.h"
+
+/***
+
+    Geometry optimizer.  Searches the base and platform radii, the arm and
+    leg lengths and the twelve base and platform angles for the geometry
+    that reaches the most of the workspace box (--ws-spec), by differential
+    evolution (DE/rand/1/bin).
+
+    A candidate is scored on a fixed set of Halton samples of the box, the
+    same set for every candidate, each run through ik_batch () on the
+    widest kernel the cpu has.  The objective is either
+
+	volume		the reachable share of the box
+	dexterity	the same samples weighted by 1 / condition number of
+			the velocity Jacobian, so poses near a singularity
+			count for little
+
+    Constraints: every radius and length stays inside its bounds, every
+    angle within span of where it started, neighbouring servos and
+    neighbouring anchors at least gap apart, and the neutral pose must be
+    reachable.  A candidate that breaks one scores -1.
+
+    Each generation's candidates are scored in parallel; the trial vectors
+    are drawn serially from a generator seeded with the generation number,
+    so the result does not depend on the thread count.
+
+ ***/
+
+typedef enum {
+  OPT_VOLUME,
+  OPT_DEXTERITY
+} opt_objective_e;
+
+typedef struct {
+  opt_objective_e objective;
+  unsigned population;
+  unsigned generations;
+  uint64_t samples;		// Halton poses per candidate
+  uint64_t seed;
+  double   base_lo,     base_hi;	// cm, base radius
+  double   platform_lo, platform_hi;	// cm, platform radius
+  double   arm_lo,      arm_hi;		// cm
+  double   leg_lo,      leg_hi;		// cm
+  double   span;		// degrees, each angle either way
+  double   gap;			// degrees, least angle between neighbours
+  const char *out;		// geometry file for the winner
+} opt_spec_s;
+
+void opt_spec_default (opt_spec_s *spec);
+
+/***
+    A comma separated list of key=value, plus the bare words volume and
+    dexterity.  Bounds are given as lo:hi, e.g.
+	"dexterity,arm=1.5:3,leg=7:11,generations=100,out=best.geo"
+ ***/
+
+bool opt_spec_parse (opt_spec_s *spec, const char *arg);
+
+/***
+    geo is the starting point on entry and the winner on return.  Prints
+    the report to stdout; returns 0, or -1 if no candidate was feasible,
+    in which case geo is left alone.
+ ***/
+
+int  opt_run (geometry_s *geo, const ws_spec_s *box, const opt_spec_s *spec);
+
+#endif // OPTIMIZE_H
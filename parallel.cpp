@@ -0,0 +1,70 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "parallel.h"
+
+static int nthreads = 0;
+
+int
+parallel_threads ()
+{
+  if (nthreads > 0) return nthreads;
+  int n = (int)std::thread::hardware_concurrency ();
+  return (n > 0) ? n : 1;
+}
+
+void
+set_parallel_threads (int n)
+{
+  nthreads = (n > 0) ? n : 0;
+}
+
+void
+parallel_for (size_t count, size_t chunk, chunk_fn fn)
+{
+  if (chunk == 0) chunk = 1;
+  size_t nchunks = (count + chunk - 1) / chunk;
+  int n = parallel_threads ();
+  if ((size_t)n > nchunks) n = (int)nchunks;
+
+  std::atomic<size_t> next (0);
+  auto worker = [&](int t) {
+    for (;;) {
+      size_t c = next.fetch_add (1, std::memory_order_relaxed);
+      if (c >= nchunks) break;
+      size_t begin = c * chunk;
+      size_t end = begin + chunk;
+      if (end > count) end = count;
+      fn (begin, end, t);
+    }
+  };
+
+  if (n <= 1) {
+    worker (0);
+    return;
+  }
+
+  std::vector<std::thread> pool;
+  for (int t = 1; t < n; t++) pool.push_back (std::thread (worker, t));
+  worker (0);
+  for (auto &th : pool) th.join ();
+}
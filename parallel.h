@@ -0,0 +1,40 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+#include <functional>
+
+/***
+    Splits [0, count) into chunks of at most chunk items and hands them to
+    parallel_threads () workers as they come free.  fn gets the chunk bounds
+    and the index of the worker running it, 0 .. nthreads - 1, so callers
+    can keep per-thread accumulators without locking.  Chunk starts are
+    always multiples of chunk.
+ ***/
+
+typedef std::function<void (size_t begin, size_t end, int thread)> chunk_fn;
+
+void parallel_for (size_t count, size_t chunk, chunk_fn fn);
+
+int  parallel_threads ();
+void set_parallel_threads (int n);	// 0 means one per core
+
+#endif // PARALLEL_H
@@ -0,0 +1,242 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+#include "quantize.h"
+#include "fk.h"
+#include "parallel.h"
+
+#define QF_CHUNK	4096
+#define QF_CODES	65536
+
+typedef struct {
+  uint64_t reachable;
+  uint64_t failures;
+  double   lin_sum;
+  double   ang_sum;
+  double   worst;			// cm
+  uint64_t worst_idx;
+  std::vector<uint64_t>      lin_hist;
+  std::vector<uint64_t>      ang_hist;
+  std::vector<ik_pose_s>     poses;
+  std::vector<double>        alphas;
+  std::vector<unsigned char> valid;
+} qf_accum_s;
+
+static uint16_t
+encode (double v, double scale)
+{
+  double c = nearbyint (v / scale);
+  return (c >= (double)QF_SATURATED) ? QF_SATURATED : (uint16_t)c;
+}
+
+// the smallest code with at least frac of the total at or below it
+static double
+percentile (const std::vector<uint64_t> &hist, uint64_t total, double frac,
+	    double scale)
+{
+  uint64_t want = (uint64_t)ceil (frac * (double)total);
+  uint64_t seen = 0;
+  for (int c = 0; c < QF_CODES; c++) {
+    seen += hist[c];
+    if (seen >= want && seen > 0) return c * scale;
+  }
+  return QF_SATURATED * scale;
+}
+
+int
+qf_sweep (const ik_geometry_s *geo, const ws_spec_s *spec,
+	  double resolution, const char *filename)
+{
+  uint64_t count = ws_sample_count (spec);
+  std::vector<qf_sample_s> field (count);
+  double step = resolution * M_PI / 180.0;
+  int nthreads = parallel_threads ();
+  std::vector<qf_accum_s> accum (nthreads);
+  struct timespec start, end;
+
+  for (int t = 0; t < nthreads; t++) {
+    qf_accum_s *acc = &accum[t];
+    acc->reachable = acc->failures = 0;
+    acc->lin_sum = acc->ang_sum = 0.0;
+    acc->worst = -1.0;
+    acc->lin_hist.assign (QF_CODES, 0);
+    acc->ang_hist.assign (QF_CODES, 0);
+  }
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+
+  parallel_for (count, QF_CHUNK, [&](size_t begin, size_t end, int t) {
+      qf_accum_s *acc = &accum[t];
+      size_t n = end - begin;
+      if (acc->poses.size () < n) {
+	acc->poses.resize (QF_CHUNK);
+	acc->alphas.resize (QF_CHUNK * IK_SERVOS);
+	acc->valid.resize (QF_CHUNK);
+      }
+      for (size_t i = 0; i < n; i++)
+	ws_sample_pose (spec, begin + i, &acc->poses[i]);
+      acc->reachable += ik_batch (geo, acc->poses.data (),
+				  acc->alphas.data (), acc->valid.data (), n);
+
+      for (size_t i = 0; i < n; i++) {
+	qf_sample_s *out = &field[begin + i];
+	out->lin = out->ang = QF_UNREACHABLE;
+	if (!acc->valid[i]) continue;
+
+	// the servo rounds to its nearest step; the sign convention of
+	// servo::alpha does not matter, rounding is symmetric
+	double q[IK_SERVOS];
+	for (int s = 0; s < IK_SERVOS; s++)
+	  q[s] = step * nearbyint (acc->alphas[i * IK_SERVOS + s] / step);
+	const ik_pose_s *want = &acc->poses[i];
+	ik_pose_s got = *want;
+	if (!fk_solve (geo, q, &got, NULL)) {
+	  acc->failures++;
+	  continue;
+	}
+	double dx = got.delta_x - want->delta_x;
+	double dy = got.delta_y - want->delta_y;
+	double dz = got.delta_z - want->delta_z;
+	double lin = sqrt (dx * dx + dy * dy + dz * dz);
+	double ang = fmax (fmax (fabs (got.phi - want->phi),
+				 fabs (got.theta - want->theta)),
+			   fabs (got.rho - want->rho));
+	out->lin = encode (lin, QF_LIN_SCALE);
+	out->ang = encode (ang, QF_ANG_SCALE);
+	acc->lin_hist[out->lin]++;
+	acc->ang_hist[out->ang]++;
+	acc->lin_sum += lin;
+	acc->ang_sum += ang;
+	if (lin > acc->worst) {
+	  acc->worst = lin;
+	  acc->worst_idx = begin + i;
+	}
+      }
+    });
+
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  double secs = (double)(end.tv_sec - start.tv_sec) +
+    1.0e-9 * (double)(end.tv_nsec - start.tv_nsec);
+
+  uint64_t reachable = 0, failures = 0;
+  double lin_sum = 0.0, ang_sum = 0.0, worst = -1.0;
+  uint64_t worst_idx = 0;
+  std::vector<uint64_t> lin_hist (QF_CODES, 0), ang_hist (QF_CODES, 0);
+  for (int t = 0; t < nthreads; t++) {
+    qf_accum_s *acc = &accum[t];
+    reachable += acc->reachable;
+    failures  += acc->failures;
+    lin_sum   += acc->lin_sum;
+    ang_sum   += acc->ang_sum;
+    if (acc->worst > worst) {
+      worst = acc->worst;
+      worst_idx = acc->worst_idx;
+    }
+    for (int c = 0; c < QF_CODES; c++) {
+      lin_hist[c] += acc->lin_hist[c];
+      ang_hist[c] += acc->ang_hist[c];
+    }
+  }
+
+  qf_header_s hdr;
+  memset (&hdr, 0, sizeof(hdr));
+  memcpy (hdr.magic, QF_MAGIC, 4);
+  hdr.version = QF_VERSION;
+  hdr.mode = spec->mode;
+  for (int a = 0; a < WS_AXES; a++) {
+    hdr.steps[a] = (spec->mode == WS_GRID) ? spec->steps[a] : 0;
+    hdr.min[a] = spec->min[a];
+    hdr.max[a] = spec->max[a];
+  }
+  hdr.samples = count;
+  hdr.reachable = reachable;
+  hdr.failures = failures;
+  hdr.resolution = step;
+  hdr.lin_scale = QF_LIN_SCALE;
+  hdr.ang_scale = QF_ANG_SCALE;
+  memcpy (hdr.base_x,   geo->base_x,   sizeof(hdr.base_x));
+  memcpy (hdr.base_z,   geo->base_z,   sizeof(hdr.base_z));
+  memcpy (hdr.anchor_x, geo->anchor_x, sizeof(hdr.anchor_x));
+  memcpy (hdr.anchor_y, geo->anchor_y, sizeof(hdr.anchor_y));
+  memcpy (hdr.anchor_z, geo->anchor_z, sizeof(hdr.anchor_z));
+  hdr.h0 = geo->h0;
+  hdr.arm_length = geo->arm_length;
+  hdr.leg_length = geo->leg_length;
+
+  FILE *fp = fopen (filename, "w");
+  if (!fp) {
+    perror (filename);
+    return -1;
+  }
+  if (fwrite (&hdr, sizeof(hdr), 1, fp) != 1 ||
+      fwrite (field.data (), sizeof(qf_sample_s), field.size (), fp) !=
+      field.size ()) {
+    perror (filename);
+    fclose (fp);
+    return -1;
+  }
+  if (fclose (fp) != 0) {
+    perror (filename);
+    return -1;
+  }
+
+  uint64_t solved = reachable - failures;
+  fprintf (stdout, "quantize:  %g deg servo steps, %s, %llu samples, "
+	   "%d threads\n", resolution,
+	   (spec->mode == WS_GRID) ? "grid" : "halton",
+	   (unsigned long long)count, nthreads);
+  fprintf (stdout, "reachable: %llu (%.3f%%), %llu of them not assembled "
+	   "when quantized\n", (unsigned long long)reachable,
+	   count ? 100.0 * (double)reachable / (double)count : 0.0,
+	   (unsigned long long)failures);
+  fprintf (stdout, "time:      %.3f sec, %.0f samples/sec\n",
+	   secs, (double)count / secs);
+  if (solved) {
+    fprintf (stdout, "\n%-14s %10s %10s %10s %10s %10s\n", "error",
+	     "mean", "p50", "p90", "p99", "max");
+    fprintf (stdout, "%-14s %10.4g %10.4g %10.4g %10.4g %10.4g\n",
+	     "position (cm)", lin_sum / (double)solved,
+	     percentile (lin_hist, solved, 0.5, QF_LIN_SCALE),
+	     percentile (lin_hist, solved, 0.9, QF_LIN_SCALE),
+	     percentile (lin_hist, solved, 0.99, QF_LIN_SCALE),
+	     percentile (lin_hist, solved, 1.0, QF_LIN_SCALE));
+    fprintf (stdout, "%-14s %10.4g %10.4g %10.4g %10.4g %10.4g\n",
+	     "angle (rad)", ang_sum / (double)solved,
+	     percentile (ang_hist, solved, 0.5, QF_ANG_SCALE),
+	     percentile (ang_hist, solved, 0.9, QF_ANG_SCALE),
+	     percentile (ang_hist, solved, 0.99, QF_ANG_SCALE),
+	     percentile (ang_hist, solved, 1.0, QF_ANG_SCALE));
+
+    ik_pose_s p;
+    ws_sample_pose (spec, worst_idx, &p);
+    fprintf (stdout, "\nworst:     %.4g cm at sample %llu, x %.3g y %.3g "
+	     "z %.3g roll %.3g pitch %.3g yaw %.3g\n", worst,
+	     (unsigned long long)worst_idx, p.delta_x, p.delta_y, p.delta_z,
+	     p.rho, p.theta, p.phi);
+  }
+  fprintf (stdout, "\nwritten to %s\n", filename);
+  return 0;
+}
@@ -0,0 +1,86 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef QUANTIZE_H
+#define QUANTIZE_H
+
+#include <stdint.h>
+
+#include "ikbatch.h"
+#include "workspace.h"
+
+/***
+
+    Servo quantization error field.  The boards write whole degrees
+    (Servo.write ()), so the platform only reaches the poses on a lattice.
+    For every sample of the workspace (--ws-spec, as for --workspace) the
+    exact servo angles from the IK are rounded to the servo resolution,
+    forward kinematics says where that actually puts the platform, and the
+    position and angle errors are recorded.  Samples run on all cores.
+
+    File layout, host byte order:
+
+	qf_header_s
+	qf_sample_s samples[samples]		in ws_sample_pose () order
+
+    Errors are stored as multiples of the header's scales and saturate at
+    QF_SATURATED; QF_UNREACHABLE marks a sample the IK cannot reach or
+    whose quantized angles the forward kinematics cannot assemble.
+
+ ***/
+
+#define QF_MAGIC	"STQF"
+#define QF_VERSION	1
+#define QF_LIN_SCALE	1.0e-4		// cm, a micron
+#define QF_ANG_SCALE	1.0e-5		// radians
+#define QF_SATURATED	0xfffe
+#define QF_UNREACHABLE	0xffff
+
+typedef struct {
+  uint16_t lin;			// |position error| / lin_scale
+  uint16_t ang;			// max |angle error| / ang_scale
+} qf_sample_s;
+
+typedef struct {
+  char     magic[4];
+  uint32_t version;
+  uint32_t mode;
+  uint32_t steps[WS_AXES];
+  uint64_t samples;
+  uint64_t reachable;
+  uint64_t failures;		// reachable, but quantized angles are not
+  double   resolution;		// radians, servo step
+  double   lin_scale;
+  double   ang_scale;
+  double   min[WS_AXES];
+  double   max[WS_AXES];
+  double   base_x[IK_SERVOS];
+  double   base_z[IK_SERVOS];
+  double   anchor_x[IK_SERVOS];
+  double   anchor_y[IK_SERVOS];
+  double   anchor_z[IK_SERVOS];
+  double   h0;
+  double   arm_length;
+  double   leg_length;
+} qf_header_s;
+
+// resolution is the servo step in degrees
+int qf_sweep (const ik_geometry_s *geo, const ws_spec_s *spec,
+	      double resolution, const char *filename);
+
+#endif // QUANTIZE_H
@@ -0,0 +1,155 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <GL/glew.h>
+
+#include "readback.h"
+
+static double
+seconds_since (const struct timespec *start)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (double)(now.tv_sec - start->tv_sec) +
+    1.0e-9 * (double)(now.tv_nsec - start->tv_nsec);
+}
+
+static void
+add_time (readback_time_s *t, double secs)
+{
+  t->total += secs;
+  if (secs > t->max) t->max = secs;
+}
+
+void
+readback_init (readback_s *rb, int width, int height)
+{
+  memset (rb, 0, sizeof(*rb));
+  rb->width = width;
+  rb->height = height;
+  rb->bytes = (GLsizeiptr)width * height * 4;
+}
+
+static void
+create_buffers (readback_s *rb)
+{
+  bool persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+  const GLbitfield flags =
+    GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+  glGenBuffers (READBACK_RING, rb->pbo);
+  for (int i = 0; i < READBACK_RING; i++) {
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, rb->pbo[i]);
+    if (persistent) {
+      glBufferStorage (GL_PIXEL_PACK_BUFFER, rb->bytes, NULL, flags);
+      rb->mapped[i] = glMapBufferRange (GL_PIXEL_PACK_BUFFER, 0, rb->bytes,
+					flags);
+    }
+    else
+      glBufferData (GL_PIXEL_PACK_BUFFER, rb->bytes, NULL, GL_STREAM_READ);
+  }
+  glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+}
+
+// the oldest queued frame, once the GPU has it, to the feeder
+static void
+write_oldest (readback_s *rb, feeder_s *out)
+{
+  int slot = (int)(rb->written % READBACK_RING);
+  struct timespec start;
+  const void *pixels;
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  if (rb->mapped[slot]) {
+    glClientWaitSync (rb->fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT,
+		      GL_TIMEOUT_IGNORED);
+    glDeleteSync (rb->fence[slot]);
+    rb->fence[slot] = 0;
+    pixels = rb->mapped[slot];
+  }
+  else {
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, rb->pbo[slot]);
+    pixels = glMapBufferRange (GL_PIXEL_PACK_BUFFER, 0, rb->bytes,
+			       GL_MAP_READ_BIT);
+  }
+  add_time (&rb->wait, seconds_since (&start));
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  if (pixels) feeder_put (out, pixels);
+  add_time (&rb->write, seconds_since (&start));
+
+  if (!rb->mapped[slot]) {
+    glUnmapBuffer (GL_PIXEL_PACK_BUFFER);
+    glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+  }
+  rb->written++;
+}
+
+void
+readback_frame (readback_s *rb, GLenum buffer, feeder_s *out)
+{
+  struct timespec start;
+
+  if (!rb->pbo[0]) create_buffers (rb);
+  else add_time (&rb->interval, seconds_since (&rb->last));
+  clock_gettime (CLOCK_MONOTONIC, &rb->last);
+
+  // the slot is free: its last frame went out READBACK_RING - 1 calls ago
+  int slot = (int)(rb->queued % READBACK_RING);
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  glReadBuffer (buffer);
+  glBindBuffer (GL_PIXEL_PACK_BUFFER, rb->pbo[slot]);
+  glReadPixels (0, 0, rb->width, rb->height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+  glBindBuffer (GL_PIXEL_PACK_BUFFER, 0);
+  if (rb->mapped[slot])
+    rb->fence[slot] = glFenceSync (GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  rb->queued++;
+  add_time (&rb->read, seconds_since (&start));
+
+  if (rb->queued - rb->written >= READBACK_RING) write_oldest (rb, out);
+}
+
+void
+readback_flush (readback_s *rb, feeder_s *out)
+{
+  while (rb->written < rb->queued) write_oldest (rb, out);
+}
+
+void
+readback_report (const readback_s *rb, FILE *fp)
+{
+  if (rb->written == 0) return;
+  double n = (double)rb->written;
+  double frames = (double)(rb->queued > 1 ? rb->queued - 1 : 1);
+  fprintf (fp, "record:    %ld frames %dx%d, %s readback\n", rb->written,
+	   rb->width, rb->height, rb->mapped[0] ? "persistent" : "mapped");
+  fprintf (fp, "  frame    %8.3f ms mean %8.3f ms max, %.1f frames/sec\n",
+	   1.0e3 * rb->interval.total / frames, 1.0e3 * rb->interval.max,
+	   rb->interval.total > 0.0 ? frames / rb->interval.total : 0.0);
+  fprintf (fp, "  read     %8.3f ms mean %8.3f ms max\n",
+	   1.0e3 * rb->read.total / (double)rb->queued, 1.0e3 * rb->read.max);
+  fprintf (fp, "  wait     %8.3f ms mean %8.3f ms max\n",
+	   1.0e3 * rb->wait.total / n, 1.0e3 * rb->wait.max);
+  fprintf (fp, "  hand-off %8.3f ms mean %8.3f ms max\n",
+	   1.0e3 * rb->write.total / n, 1.0e3 * rb->write.max);
+}
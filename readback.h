@@ -0,0 +1,78 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+
+#ifndef READBACK_H
+#define READBACK_H
+
+#include <stdio.h>
+
+#include <GL/glew.h>
+
+#include "feeder.h"
+
+/***
+
+    Asynchronous frame readback for --record.  glReadPixels into the
+    default framebuffer's memory waits for the GPU to finish the frame;
+    into a pixel buffer object it only queues a copy.  readback_frame ()
+    queues frame N into one of READBACK_RING buffers and hands frame
+    N - READBACK_RING + 1, which the GPU finished a couple of frames ago,
+    to the encoder feeder (feeder.h), so nothing waits.  readback_flush ()
+    hands over what is still queued.
+
+    With GL 4.4 or ARB_buffer_storage the buffers are mapped once,
+    persistent and coherent, and a fence per buffer says when its copy
+    has landed; otherwise each is mapped for reading when its turn comes.
+
+    Each stage is timed, the read queued, the wait for the copy, the
+    hand-off to the feeder, and the time between frames, for
+    readback_report.
+
+ ***/
+
+#define READBACK_RING	3
+
+typedef struct {
+  double total;			// seconds
+  double max;
+} readback_time_s;
+
+typedef struct {
+  int             width, height;
+  GLsizeiptr      bytes;		// a frame
+  GLuint          pbo[READBACK_RING];	// 0 until the first frame
+  GLsync          fence[READBACK_RING];
+  void           *mapped[READBACK_RING];	// persistent, or NULL
+  long            queued;		// frames read into a buffer
+  long            written;		// frames out to the pipe
+  readback_time_s read, wait, write, interval;
+  struct timespec last;		// previous readback_frame ()
+} readback_s;
+
+void readback_init (readback_s *rb, int width, int height);
+
+// the current read buffer into the ring, and the oldest frame out to out
+void readback_frame (readback_s *rb, GLenum buffer, feeder_s *out);
+
+// every frame still in the ring out to out, at the end of a recording
+void readback_flush (readback_s *rb, feeder_s *out);
+
+void readback_report (const readback_s *rb, FILE *fp);
+
+#endif // READBACK_H
@@ -0,0 +1,91 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <math.h>
+#include <stdint.h>
+
+/***
+
+    Small, fast random numbers for the batch modes, one generator per
+    worker or per trial instead of the shared drand48 () state.  xoshiro256**
+    seeded through splitmix64, so rng_seed (r, seed, stream) gives unrelated
+    sequences for neighbouring streams and the same sequence every run,
+    however the work is split between threads.
+
+ ***/
+
+typedef struct {
+  uint64_t s[4];
+} rng_s;
+
+static inline uint64_t
+rng_splitmix64 (uint64_t *x)
+{
+  uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static inline void
+rng_seed (rng_s *r, uint64_t seed, uint64_t stream)
+{
+  uint64_t x = seed ^ rng_splitmix64 (&stream);
+  for (int i = 0; i < 4; i++) r->s[i] = rng_splitmix64 (&x);
+}
+
+static inline uint64_t
+rng_next (rng_s *r)
+{
+  uint64_t *s = r->s;
+  uint64_t v = s[1] * 5;
+  uint64_t result = ((v << 7) | (v >> 57)) * 9;
+  uint64_t t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = (s[3] << 45) | (s[3] >> 19);
+  return result;
+}
+
+// [0, 1)
+static inline double
+rng_uniform (rng_s *r)
+{
+  return (double)(rng_next (r) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// standard normal, Marsaglia's polar method
+static inline double
+rng_normal (rng_s *r)
+{
+  double u, v, s;
+  do {
+    u = 2.0 * rng_uniform (r) - 1.0;
+    v = 2.0 * rng_uniform (r) - 1.0;
+    s = u * u + v * v;
+  } while (s >= 1.0 || s == 0.0);
+  return u * sqrt (-2.0 * log (s) / s);
+}
+
+#endif // RNG_H
@@ -0,0 +1,276 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#include "script.h"
+#include "parallel.h"
+
+#define SCRIPT_CHUNK		4096	// ticks per work item
+#define SCRIPT_SEED		1
+#define SCRIPT_REPORT_STEPS	20	// steps listed with unreachable ticks
+#define R2D(r)			((r) * 180.0 / M_PI)
+
+static bool
+parse_step (char *text, script_step_s *step)
+{
+  char *save = NULL;
+  bool first = true;
+
+  for (char *tok = strtok_r (text, ";", &save); tok;
+       tok = strtok_r (NULL, ";", &save), first = false) {
+    tok += strspn (tok, " \t");
+    char *eq = strchr (tok, '=');
+    if (!eq) {
+      if (!first) return false;
+      step->name = tok;
+      continue;
+    }
+    size_t klen = eq - tok;
+    char *end;
+    if (klen == 6 && !strncmp (tok, "script", 6)) step->name = eq + 1;
+    else if (klen == 6 && !strncmp (tok, "cycles", 6)) {
+      unsigned long n = strtoul (eq + 1, &end, 0);
+      if (end == eq + 1 || *end) return false;
+      step->cycles = (unsigned)n;
+    }
+    else if (klen == 4 && !strncmp (tok, "seed", 4)) {
+      unsigned long long n = strtoull (eq + 1, &end, 0);
+      if (end == eq + 1 || *end) return false;
+      step->reseed = true;
+      step->seed = n;
+    }
+    else if (!jitter_spec_parse (&step->spec, tok, ";")) return false;
+  }
+  return true;
+}
+
+bool
+script_load (const char *filename, script_s *script)
+{
+  std::vector<script_step_s> steps;
+  script_step_s step;
+  char line[1024];
+  int lineno = 0;
+  bool ok = true;
+
+  jitter_spec_default (&step.spec);
+  FILE *fp = fopen (filename, "r");
+  if (!fp) {
+    perror (filename);
+    return false;
+  }
+
+  while (ok && fgets (line, sizeof(line), fp)) {
+    lineno++;
+    char *hash = strchr (line, '#');
+    if (hash) *hash = 0;
+    line[strcspn (line, "\r\n")] = 0;
+    char *text = line + strspn (line, " \t");
+    if (!*text) continue;
+
+    step.line = lineno;
+    step.cycles = 1;
+    step.reseed = false;
+    if (!parse_step (text, &step)) {
+      fprintf (stderr, "%s:%d: bad script step\n", filename, lineno);
+      ok = false;
+    }
+    else steps.push_back (step);
+  }
+  fclose (fp);
+
+  if (ok && steps.empty ()) {
+    fprintf (stderr, "%s: no steps\n", filename);
+    ok = false;
+  }
+  if (ok) {
+    script->steps = steps;
+    script_build (script);
+  }
+  return ok;
+}
+
+void
+script_build (script_s *script)
+{
+  rng_s rng;
+  traj_point_s at;
+
+  rng_seed (&rng, SCRIPT_SEED, 0);
+  traj_clear (&script->traj);
+  script->start.clear ();
+  memset (&at, 0, sizeof(at));
+  memcpy (at.pos, script->steps[0].spec.pose, sizeof(at.pos));
+
+  for (size_t i = 0; i < script->steps.size (); i++) {
+    const script_step_s *step = &script->steps[i];
+    if (step->reseed) rng_seed (&rng, step->seed, 0);
+    script->start.push_back (traj_end (&script->traj));
+    for (unsigned c = 0; c < step->cycles; c++) {
+      traj_jitter_cycle (&script->traj, &at, &step->spec, &rng);
+      memcpy (at.pos, step->spec.pose, sizeof(at.pos));
+    }
+  }
+}
+
+int
+script_step_at (const script_s *script, double t)
+{
+  size_t i = std::upper_bound (script->start.begin (), script->start.end (),
+			       t) - script->start.begin ();
+  return (i > 0) ? (int)i - 1 : 0;
+}
+
+typedef struct {
+  uint64_t unreachable;
+  uint64_t first;			// tick, UINT64_MAX if none
+  double   speed[IK_SERVOS];		// rad/s, largest seen
+  std::vector<ik_pose_s>     poses;
+  std::vector<double>        alphas;
+  std::vector<unsigned char> valid;
+  std::vector<uint64_t>      per_step;	// unreachable ticks
+} script_accum_s;
+
+int
+script_check (const ik_geometry_s *geo, script_s *script, double rate,
+	      const char *filename)
+{
+  double dt = 1.0 / rate;
+  double duration = traj_end (&script->traj);
+  uint64_t ticks = (uint64_t)floor (duration * rate) + 1;
+  int nthreads = parallel_threads ();
+  std::vector<script_accum_s> accum (nthreads);
+  size_t nsteps = script->steps.size ();
+  struct timespec start, end;
+
+  for (int t = 0; t < nthreads; t++) {
+    script_accum_s *acc = &accum[t];
+    acc->unreachable = 0;
+    acc->first = UINT64_MAX;
+    for (int s = 0; s < IK_SERVOS; s++) acc->speed[s] = 0.0;
+    acc->poses.resize (SCRIPT_CHUNK + 1);
+    acc->alphas.resize ((SCRIPT_CHUNK + 1) * IK_SERVOS);
+    acc->valid.resize (SCRIPT_CHUNK + 1);
+    acc->per_step.assign (nsteps, 0);
+  }
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+
+  // each chunk also solves the tick before it, for the servo speeds
+  parallel_for (ticks, SCRIPT_CHUNK, [&](size_t begin, size_t end, int t) {
+      script_accum_s *acc = &accum[t];
+      size_t first = (begin > 0) ? begin - 1 : 0;
+      size_t n = end - first;
+      size_t cursor = (size_t)-1;
+      for (size_t i = 0; i < n; i++) {
+	traj_point_s p;
+	traj_eval_at (&script->traj, &cursor, (double)(first + i) * dt, &p);
+	ik_pose_s *pose = &acc->poses[i];
+	pose->delta_x = p.pos[WS_AXIS_X];
+	pose->delta_y = p.pos[WS_AXIS_Y];
+	pose->delta_z = p.pos[WS_AXIS_Z];
+	pose->rho     = p.pos[WS_AXIS_ROLL];
+	pose->theta   = p.pos[WS_AXIS_PITCH];
+	pose->phi     = p.pos[WS_AXIS_YAW];
+      }
+      ik_batch (geo, acc->poses.data (), acc->alphas.data (),
+		acc->valid.data (), n);
+
+      for (size_t i = first; i < end; i++) {
+	size_t k = i - first;
+	if (i >= begin && !acc->valid[k]) {
+	  acc->unreachable++;
+	  if (i < acc->first) acc->first = i;
+	  acc->per_step[script_step_at (script, (double)i * dt)]++;
+	}
+	if (k == 0 || !acc->valid[k] || !acc->valid[k - 1]) continue;
+	for (int s = 0; s < IK_SERVOS; s++) {
+	  double v = fabs (acc->alphas[k * IK_SERVOS + s] -
+			   acc->alphas[(k - 1) * IK_SERVOS + s]) * rate;
+	  if (v > acc->speed[s]) acc->speed[s] = v;
+	}
+      }
+    });
+
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  double secs = (double)(end.tv_sec - start.tv_sec) +
+    1.0e-9 * (double)(end.tv_nsec - start.tv_nsec);
+
+  uint64_t unreachable = 0, first = UINT64_MAX;
+  double speed[IK_SERVOS] = { 0.0 };
+  std::vector<uint64_t> per_step (nsteps, 0);
+  for (int t = 0; t < nthreads; t++) {
+    script_accum_s *acc = &accum[t];
+    unreachable += acc->unreachable;
+    first = std::min (first, acc->first);
+    for (int s = 0; s < IK_SERVOS; s++)
+      speed[s] = std::max (speed[s], acc->speed[s]);
+    for (size_t i = 0; i < nsteps; i++) per_step[i] += acc->per_step[i];
+  }
+
+  unsigned long long cycles = 0;
+  for (size_t i = 0; i < nsteps; i++) cycles += script->steps[i].cycles;
+  fprintf (stdout, "script:    %s, %zu steps, %llu cycles, %.0f sec of "
+	   "motion (%.2f h)\n", filename, nsteps, cycles, duration,
+	   duration / 3600.0);
+  fprintf (stdout, "time:      %.3f sec for %llu ticks at %g Hz, %.0f x "
+	   "real time, %d threads, %s kernel\n", secs,
+	   (unsigned long long)ticks, rate, duration / secs, nthreads,
+	   ik_batch_isa ());
+  fprintf (stdout, "servo:     fastest");
+  for (int s = 0; s < IK_SERVOS; s++)
+    fprintf (stdout, " %.0f", R2D (speed[s]));
+  fprintf (stdout, " deg/s\n");
+
+  if (unreachable == 0) {
+    fprintf (stdout, "reachable: every tick\n");
+    return 0;
+  }
+
+  traj_point_s p;
+  size_t cursor = (size_t)-1;
+  double tf = (double)first * dt;
+  const script_step_s *step = &script->steps[script_step_at (script, tf)];
+  traj_eval_at (&script->traj, &cursor, tf, &p);
+  fprintf (stdout, "reachable: %llu ticks (%.3f%%) out of reach\n",
+	   (unsigned long long)unreachable,
+	   100.0 * (double)unreachable / (double)ticks);
+  fprintf (stdout, "first:     %.3f sec, line %d (%s), x %.3g y %.3g z %.3g "
+	   "roll %.3g pitch %.3g yaw %.3g\n", tf, step->line,
+	   step->name.c_str (), p.pos[WS_AXIS_X], p.pos[WS_AXIS_Y],
+	   p.pos[WS_AXIS_Z], R2D (p.pos[WS_AXIS_ROLL]),
+	   R2D (p.pos[WS_AXIS_PITCH]), R2D (p.pos[WS_AXIS_YAW]));
+
+  fprintf (stdout, "\n%-6s %-20s %12s\n", "line", "step", "out of reach");
+  int listed = 0;
+  for (size_t i = 0; i < nsteps && listed < SCRIPT_REPORT_STEPS; i++) {
+    if (!per_step[i]) continue;
+    fprintf (stdout, "%-6d %-20s %12llu\n", script->steps[i].line,
+	     script->steps[i].name.c_str (),
+	     (unsigned long long)per_step[i]);
+    listed++;
+  }
+  return 1;
+}
@@ -0,0 +1,85 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "ikbatch.h"
+#include "trajectory.h"
+
+/***
+
+    hardware4 motion scripts.  The web page's Save button sends
+
+	script=name;pdx=..;pdy=..;pdz=..;proll=..;ppitch=..;pyaw=..;
+	jdx=..;jdy=..;jdz=..;jroll=..;jpitch=..;jyaw=..;
+	onset=..;relax=..;interval=..
+
+    (lbls.h names; cm, degrees, seconds).  A script file is those lines,
+    one step per line, with the "script=" optional, # to end of line a
+    comment, and two keys the board does not send:
+
+	cycles=n	jitter cycles this step runs, default 1
+	seed=n		restart the target generator with seed n
+
+    Keys left out, the name too, keep their values from the step before,
+    the way the web page's fields do.  The generator starts with seed 1,
+    so a script always makes the same motion.
+
+ ***/
+
+typedef struct {
+  std::string   name;
+  int           line;
+  jitter_spec_s spec;
+  unsigned      cycles;
+  bool          reseed;
+  uint64_t      seed;
+} script_step_s;
+
+typedef struct {
+  std::vector<script_step_s> steps;
+  std::vector<double>        start;	// seconds, per step, from build
+  traj_s                     traj;
+} script_s;
+
+// Leaves script untouched and reports to stderr if the file is bad.
+bool script_load (const char *filename, script_s *script);
+
+// the whole motion, from the first step's neutral pose at rest
+void script_build (script_s *script);
+
+// the step running at t seconds
+int  script_step_at (const script_s *script, double t);
+
+/***
+    Plays the whole script through the IK at rate ticks a second as fast
+    as the cpu allows, on all cores, and reports the ticks the platform
+    cannot reach, where they first happen, and the fastest servo moves.
+    Returns 0 if every tick was reachable, 1 if not, -1 on error.
+ ***/
+
+int  script_check (const ik_geometry_s *geo, script_s *script, double rate,
+		   const char *filename);
+
+#endif // SCRIPT_H
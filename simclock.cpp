@@ -0,0 +1,79 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#include "simclock.h"
+
+void
+sim_clock_init (sim_clock_s *clk, double rate)
+{
+  clk->dt = 1.0 / rate;
+  clk->accumulator = 0.0;
+  clk->max_lag = SIM_CLOCK_MAX_LAG;
+  clk->steps = 0;
+  clk->started = false;
+}
+
+int
+sim_clock_feed (sim_clock_s *clk, double seconds)
+{
+  if (seconds > clk->max_lag) seconds = clk->max_lag;
+  if (seconds > 0.0) clk->accumulator += seconds;
+
+  int n = (int)(clk->accumulator / clk->dt);
+  clk->accumulator -= (double)n * clk->dt;
+  if (clk->accumulator < 0.0) clk->accumulator = 0.0;	// rounding
+  clk->steps += n;
+  return n;
+}
+
+int
+sim_clock_tick (sim_clock_s *clk)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  if (!clk->started) {
+    clk->started = true;
+    clk->last = now;
+    return 0;
+  }
+  double secs = (double)(now.tv_sec - clk->last.tv_sec) +
+    1.0e-9 * (double)(now.tv_nsec - clk->last.tv_nsec);
+  clk->last = now;
+  return sim_clock_feed (clk, secs);
+}
+
+double
+sim_clock_blend (const sim_clock_s *clk)
+{
+  double b = clk->accumulator / clk->dt;
+  return (b < 1.0) ? b : 1.0;
+}
+
+double
+sim_clock_until_next (const sim_clock_s *clk)
+{
+  return clk->dt - clk->accumulator;
+}
+
+double
+sim_clock_now ()
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (double)now.tv_sec + 1.0e-9 * (double)now.tv_nsec;
+}
@@ -0,0 +1,71 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef SIMCLOCK_H
+#define SIMCLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+/***
+
+    Fixed timestep simulation clock.  Wall time from CLOCK_MONOTONIC is
+    added to an accumulator and handed out as whole steps of dt, so the
+    motion advances at the same rate whatever the frame rate is.  What is
+    left over, less than one step, is the blend factor for drawing a pose
+    between the last two steps.
+
+	int n = sim_clock_tick (&clk);
+	while (n--) { prev = curr; step (clk.dt); curr = state (); }
+	draw (lerp (prev, curr, sim_clock_blend (&clk)));
+
+    A frame that comes very late (a window drag, a debugger) catches up at
+    most max_lag seconds; the rest of the time is dropped rather than run
+    as a burst of steps.
+
+ ***/
+
+#define SIM_CLOCK_MAX_LAG	0.25	// seconds
+
+typedef struct {
+  double   dt;			// seconds per step
+  double   accumulator;		// seconds not yet stepped, < dt after a tick
+  double   max_lag;
+  uint64_t steps;		// total handed out
+  bool     started;
+  struct timespec last;
+} sim_clock_s;
+
+void   sim_clock_init (sim_clock_s *clk, double rate);	// steps per second
+
+// reads the clock; returns the number of steps now due
+int    sim_clock_tick (sim_clock_s *clk);
+
+// the same for a given amount of time, for runs not tied to the wall clock
+int    sim_clock_feed (sim_clock_s *clk, double seconds);
+
+// 0 .. 1, how far the present is past the last step
+double sim_clock_blend (const sim_clock_s *clk);
+
+// seconds from the last tick until the next step is due
+double sim_clock_until_next (const sim_clock_s *clk);
+
+// CLOCK_MONOTONIC as seconds
+double sim_clock_now ();
+
+#endif // SIMCLOCK_H
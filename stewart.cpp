@@ -21,11 +21,13 @@ Stewart. If not, see <https://www.gnu.org/licenses/>.
 #include <malloc.h>
 #include <math.h>
 #include <signal.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <sys/stat.h>
 
 #include <iostream>
 #include <fstream>
@@ -34,6 +36,8 @@ Stewart. If not, see <https://www.gnu.org/licenses/>.
 #include <map>
 #include <string>
 #include <cstdlib>
+#include <atomic>
+#include <thread>
 
 #include <GL/glew.h>
 #include <GL/freeglut.h>
@@ -64,56 +68,56 @@ Stewart. If not, see <https://www.gnu.org/licenses/>.
 #endif
 
 #include "popen2.h"
+#include "ikbatch.h"
+#include "parallel.h"
+#include "workspace.h"
+#include "fk.h"
+#include "geometry.h"
+#include "tolerance.h"
+#include "optimize.h"
+#include "quantize.h"
+#include "simclock.h"
+#include "lockfree.h"
+#include "trajectory.h"
+#include "script.h"
+#include "compile.h"
+#include "instance.h"
+#include "fleet.h"
+#include "inputlog.h"
+#include "mesh.h"
+#include "text.h"
+#include "offscreen.h"
+#include "readback.h"
+#include "feeder.h"
 
 #define D2R(d) ((d / 180.0) * M_PI)
 #define R2D(r) ((r / M_PI) * 180.0)
 
 /************* platform description ***************/
 
-
+// geometry.h has the default dimensions; --geometry loads others
 #define ARM_RADIUS	 0.2
-#define DEFAULT_ARM_LENGTH	 2.0
 #define SHAFT_DIAMETER	 0.5
 #define SHAFT_LENGTH	 1.0
-#define DEFAULT_LEG_LENGTH	 9.0		// fixme make adjustable
 double arm_length = DEFAULT_ARM_LENGTH;
 double leg_length = DEFAULT_LEG_LENGTH;
 
 #define PLATFORM_HEIGHT	 20.0
 
-#define B0_ANGLE  2.69159
-#define B1_ANGLE -2.69159
-#define B2_ANGLE -1.4972
-#define B3_ANGLE -0.597197
-#define B4_ANGLE  0.597197
-#define B5_ANGLE  1.4972
 #define B0_AI	  0.020
 #define B1_AI	  0.021
 #define B2_AI	  0.018
 #define B3_AI	  0.022
 #define B4_AI	  0.017
 #define B5_AI	  0.006
-#define DEFAULT_BASE_RADIUS	7.5
 double base_radius = DEFAULT_BASE_RADIUS;
-
-
-
-#define SA0	M_PI_2			// radians shaft angle
-#define SA1	M_PI_2
-#define SA2	(-M_PI / 6.0)
-#define SA3	(-M_PI / 6.0)
-#define SA4	(7.0 * M_PI / 6.0)
-#define SA5	(7.0 * M_PI / 6.0)
-
-#define P0_ANGLE  2.54
-#define P1_ANGLE -2.54
-#define P2_ANGLE -1.65
-#define P3_ANGLE -0.44
-#define P4_ANGLE  0.44
-#define P5_ANGLE  1.65
-#define DEFAULT_PLATFORM_RADIUS	1.75
 double platform_radius = DEFAULT_PLATFORM_RADIUS;
 
+geometry_s geometry;
+char* geometry_file = NULL;
+time_t geometry_mtime = 0;
+#define GEOMETRY_POLL_INTERVAL 0.5	// seconds between stat()s
+
 
 
 /**************** classes and typdefs  ****************/
@@ -141,13 +145,16 @@ public:
     pos.x = x;
     pos.y = y;
     rotation_angle = atan2 (y, x);
-    shaft_angle    = sa;
-    shaft_vector.x = cos (sa);
-    shaft_vector.y = sin (sa);
+    set_shaft (sa);
     alpha = aa;
     alpha_incr = ai;
     fake_angle = fk;
   }
+  void set_shaft (double sa) {
+    shaft_angle    = sa;
+    shaft_vector.x = cos (sa);
+    shaft_vector.y = sin (sa);
+  }
   position_s pos;
   double     rotation_angle;
   double     shaft_angle;
@@ -299,11 +306,20 @@ namespace sps {
 #define READOUT_VIEW_Y	-0.9f
 #define READOUT_PLATFORM_X	-0.9f
 #define READOUT_PLATFORM_Y	 0.9f
+#define READOUT_JACOBIAN_X	 0.2f
+#define READOUT_JACOBIAN_Y	 0.9f
+#define READOUT_TRIANGLES_X	 0.2f
+#define READOUT_TRIANGLES_Y	-0.9f
+#define READOUT_RECORD_X	-0.9f
+#define READOUT_RECORD_Y	-0.7f
+#define DEFAULT_FONT	"/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf"
+#define FONT_PIXELS	18
 
 #define DEFAULT_SCAD_BASE_NAME "stewart"
 
 int width  = DEFAULT_WIDTH;
 int height = DEFAULT_HEIGHT;
+int window_width, window_height;	// as reshaped, what the mouse spans
 int mouse_mod    = 0;
 int mouse_state  = 0;
 int mouse_button = 0;
@@ -314,6 +330,11 @@ pid_t ffmpeg_pid = -1;
 char* filename = NULL;
 char* scadbase = NULL;
 FILE* ffmpeg = NULL;
+readback_s readback;			// frames on their way to ffmpeg
+feeder_s feeder;			// and the thread that writes them
+feeder_policy_e record_policy = FEEDER_DUPLICATE;
+bool record_policy_given = false;	// else FEEDER_BLOCK when --headless
+int record_queue = FEEDER_DEFAULT_DEPTH;
 
 std::vector<servo *> servos;
 _platform *platform;
@@ -331,34 +352,209 @@ spherical centre   = spherical (DEFAULT_CENTRE_DISTANCE,
 				D2R (DEFAULT_CENTRE_THETA),
 				D2R (DEFAULT_CENTRE_PHI));
 
+/***
+    Motion and IK run on their own thread on a fixed timestep, sim_rate
+    steps a second, whatever the frame rate and however long a frame or
+    its video capture takes.  Once started, the sim thread owns the
+    platform pose, the servo angles, do_motion, ik_geo and everything
+    update_alpha () sets.  After each batch of steps it publishes a
+    sim_snapshot_s through snapshots; display () draws only the latest,
+    blended between its last two steps.  The GLUT callbacks change the
+    pose and the motion by posting sim_cmd_s on commands, and hand a new
+    geometry over in pending_geo, where a newer one replaces any the sim
+    thread has not yet taken, so a geometry is never dropped with a full
+    queue.  Neither side ever waits for the other.
+ ***/
+
+#define DEFAULT_SIM_RATE 1000.0
+#define AUTOMATION_PERIOD 0.01	// seconds per alpha_incr
+#define SIM_QUEUE_SIZE 256
+
+typedef struct {
+  ik_pose_s pose;
+  double    alpha[IK_SERVOS];
+} sim_frame_s;
+
+typedef struct {
+  sim_frame_s   prev;
+  sim_frame_s   curr;
+  double        t_curr;		// sim_clock_now () of curr
+  double        dt;
+  uint64_t      steps;
+  fk_jacobian_s jacobian;
+  double        jacobian_usecs;
+  bool          pose_held;
+} sim_snapshot_s;
+
+enum {
+  SIM_CMD_MOVE,			// axis += value
+  SIM_CMD_SET,			// axis = value
+  SIM_CMD_HOME,			// pose back to neutral
+  SIM_CMD_MOTION		// do_motion = (value != 0)
+};
+
+typedef struct {
+  int            op;
+  int            axis;		// WS_AXIS_*
+  double         value;
+} sim_cmd_s;
+
+double sim_rate = DEFAULT_SIM_RATE;
+sim_clock_s sim_clock;
+triple_buffer<sim_snapshot_s> snapshots;
+spsc_queue<sim_cmd_s, SIM_QUEUE_SIZE> commands;
+std::atomic<ik_geometry_s *> pending_geo (NULL);	// whoever takes it frees it
+std::thread sim_thread;
+bool sim_running = false;		// set and cleared by the GLUT thread
+std::atomic<bool> sim_quit (false);
+std::atomic<bool> sim_finished (false);	// one_shot has had its step
+const sim_snapshot_s *latest = NULL;	// what display () works from
+sim_frame_s view;
+
 bool one_shot  = false;
 bool do_motion = true;
 bool demo_mode = false;
 bool launch_os = false;
+#define DEFAULT_BENCH_COUNT 1000000
+long bench_count = 0;
+long bench_fk_count = 0;
+#define DEFAULT_WORKSPACE_NAME "workspace.bin"
+char* workspace_file = NULL;
+ws_spec_s workspace_spec;
+bool tolerance_run = false;
+tol_spec_s tolerance_spec;
+bool optimize_run = false;
+opt_spec_s optimize_spec;
+#define DEFAULT_QUANTIZE_NAME "quantize.bin"
+char* quantize_file = NULL;
+double quant_step = 1.0;		// degrees, Servo.write ()
+#define DEFAULT_COMPILE_NAME "motion.stm"
+char* compile_file = NULL;
+char* compile_out = NULL;
+unsigned compile_rate = MC_DEFAULT_RATE;
+uint64_t motion_seed;			// demo jitter, kept in input logs
+il_recorder_s input_rec = { NULL };
+char* input_record_file = NULL;
+char* input_replay_file = NULL;
+il_log_s input_log;
+int replay_width, replay_height;	// the logged window, for mouse x, y
+bool replay_started = false;
+struct timespec replay_start;
+bool headless = false;
+offscreen_s offscreen;			// --headless --record
+#define DEFAULT_FPS 60
+int fps = DEFAULT_FPS;			// of the video
+#define DEFAULT_HEADLESS_FRAMES 600
+long headless_frames = 0;		// 0: DEFAULT_HEADLESS_FRAMES, or the replay
+bool continuous = false;		// redraw on every idle callback
+#define DEFAULT_FLEET_TIME 60.0
+char* fleet_arg = NULL;
+double fleet_time = DEFAULT_FLEET_TIME;	// seconds of motion
 pid_t os_proc  = -1;
 
 double h0;				// base height based on geometry
+ik_geometry_s ik_geo;			// per-servo constants for update_alpha
+
+/***
+    Conditioning monitor, run by update_alpha () on every accepted pose in
+    the interactive modes.  A pose whose Jacobian condition number exceeds
+    max_condition is refused the same way an unreachable one is, so the
+    platform stops short of a singularity.  0 disables the limit.
+ ***/
+
+bool monitor_pose = false;
+fk_jacobian_s jacobian;
+double jacobian_usecs = 0.0;
+bool pose_held = false;			// last pose refused
+double max_condition = 0.0;
+bool show_jacobian = false;
+
+/***
+    The balls and rods of the mechanism, drawn with one call per level of
+    detail once the whole mechanism has been worked out (mesh.h).  The
+    level each gets depends on its size on screen; lod_pixels, set at the
+    top of display (), is what a unit length one unit away covers.
+ ***/
+
+mesh_lod_s balls;
+mesh_lod_s rods;
+double lod_pixels = 0.0;
+mesh_stats_s mesh_stats;		// the last frame's
+bool show_triangles = false;
+
+/***
+    The HUD.  Its strings are formatted, laid out and uploaded only when
+    one of the values in hud_values_s differs from the last frame's, and
+    then drawn in one call from the glyph atlas (text.h).  Without the
+    font they go through renderString () as before.
+ ***/
+
+typedef struct {
+  int          width, height;
+  double       location[3];
+  double       centre[3];
+  double       pose[6];
+  double       h0;
+  double       cond, sigma_min, sigma_max;
+  double       J[IK_SERVOS][IK_SERVOS];
+  long         tenth_usecs;		// as shown
+  bool         held, jacobian, triangles;
+  mesh_stats_s mesh;
+  bool         recording;
+  int          queued;			// the encoder feeder's
+  long         frames, dropped, duplicated;
+} hud_values_s;
+
+#define HUD_ITEMS	5
+#define HUD_TEXT	1024
+
+typedef struct {
+  float x, y;
+  char  text[HUD_TEXT];
+} hud_item_s;
+
+char *font_file = NULL;
+text_font_s hud_font;
+text_layout_s hud_layout;
+hud_values_s hud_values;
+hud_item_s hud[HUD_ITEMS];
+int hud_items = -1;			// none yet
 
 static void
-set_h0 ()
+fill_ik_geometry (ik_geometry_s *geo)
 {
-  h0 = 0.0;					// Eq 10
-  for (int i = 0; i < 6; i++) {
-    double xp = platform->anchors[i].x;		// anchor
-    double yp = platform->anchors[i].y;		// anchor
-    double xb = servos[i]->pos.x;		// servo
-    double yb = servos[i]->pos.y;		// servo
-    h0 += sqrt (pow (leg_length, 2.0) +
-		pow (arm_length, 2.0) -
-		(pow ((xp - xb), 2.0) +
-		pow ((yp - yb), 2.0)));
-
+  for (int i = 0; i < IK_SERVOS; i++) {
+    geo->base_x[i]   = servos[i]->pos.x;
+    geo->base_z[i]   = servos[i]->pos.y;
+    geo->anchor_x[i] = platform->anchors[i].x;
+    geo->anchor_y[i] = platform->anchors[i].y;
+    geo->anchor_z[i] = platform->anchors[i].z;
   }
-  h0 /= 6.0;
+  geo->h0         = h0;
+  geo->arm_length = arm_length;
+  geo->leg_length = leg_length;
+  ik_geometry_prepare (geo);
 }
 
+/***
+    Every change to the geometry ends up here, so this is also where the
+    loop-invariant table update_alpha () works from is rebuilt.
+ ***/
+
 static void
-set_colours (int i)
+set_h0 ()
+{
+  ik_geometry_s geo;
+  fill_ik_geometry (&geo);
+  h0 = geo.h0 = ikc_h0 (&geo);			// Eq 10
+  if (sim_running)
+    delete pending_geo.exchange (new ik_geometry_s (geo),
+				 std::memory_order_acq_rel);
+  else ik_geo = geo;
+}
+
+static void
+servo_colour (int i, float *rgb)
 {
   float red, green, blue;
   switch(i) {
@@ -381,7 +577,17 @@ set_colours (int i)
     red = 1.0; green = 0.0, blue = 1.0;		// magenta
     break;
   }
-  glColor3f (red, green, blue);
+  rgb[0] = red;
+  rgb[1] = green;
+  rgb[2] = blue;
+}
+
+static void
+set_colours (int i)
+{
+  float rgb[3];
+  servo_colour (i, rgb);
+  glColor3fv (rgb);
 }
 
 static void
@@ -438,9 +644,37 @@ showMatrix (const char *title, glm::mat4 & mx)
   }
 }
 
+static void stop_sim ();
+
+/***
+    Signals only note that they came.  Draining the recording takes
+    locks, joins a thread and waits on ffmpeg, none of which a handler
+    may do, so the loops that can be recording (spin () and the headless
+    render) poll quit_signal and call enditall () themselves.  Anything
+    else has nothing to drain and exits from the handler at once.
+ ***/
+
+volatile sig_atomic_t quit_signal = 0;
+volatile sig_atomic_t signal_polled = 0;	// a loop checks quit_signal
+
+static void
+on_signal (int sig)
+{
+  quit_signal = sig;
+  if (!signal_polled) _exit (128 + sig);
+}
+
 void
 enditall (int sig)
 {
+  stop_sim ();
+  il_record_close (&input_rec);
+  if (ffmpeg) {
+    readback_flush (&readback, &feeder);
+    feeder_stop (&feeder);
+    readback_report (&readback, stderr);
+    feeder_report (&feeder, stderr);
+  }
   if (ffmpeg && ffmpeg_pid >= 0) pclose2 (ffmpeg,  ffmpeg_pid);
   ffmpeg = NULL;
   if (os_proc > 0) {
@@ -453,83 +687,40 @@ enditall (int sig)
   exit (0);
 }
 
-enum {
-  JITTER_QUIET,
-  JITTER_ATTACK,
-  JITTER_ATTACK_CONTINUE,
-  JITTER_DECAY
-};
-
-int jitter_mode = JITTER_ATTACK;
-
-static unsigned int
-do_jitter ()
-{
-  unsigned int sleep_time = 10000;
-  static double target_x;
-  static double target_y;
-  static double target_z;
-  static double target_p;
-  static double target_t;
-  static double target_r;
-  static double attack_stage;
-  static double base_x;
-  static double base_y;
-  static double base_z;
-  static double base_p;
-  static double base_t;
-  static double base_r;
-  switch (jitter_mode) {
-  case JITTER_QUIET:		// do nothing
-    break;
-  case JITTER_ATTACK:
-    base_x = platform->delta_x;
-    base_y = platform->delta_y;
-    base_z = platform->delta_z;
-    base_p = platform->phi;
-    base_t = platform->theta;
-    base_r = platform->rho;
-	
-    target_x = 2.0 * (drand48 () - 0.5);
-    target_y = 2.0 * (drand48 () - 0.5);
-    target_z = 2.0 * (drand48 () - 0.5);
-    target_p= 0.2 * (drand48 () - 0.5);
-    target_t = 0.2 * (drand48 () - 0.5);
-    target_r   = 0.2 * (drand48 () - 0.5);
-    attack_stage = 0.0;
-    jitter_mode = JITTER_ATTACK_CONTINUE;
-    //break;					no break
-  case JITTER_ATTACK_CONTINUE:
-    if (attack_stage < 10.0) {
-      platform->delta_x = base_x + target_x * attack_stage / 10.0;
-      platform->delta_y = base_y + target_y * attack_stage / 10.0; 
-      platform->delta_z = base_z + target_z * attack_stage / 10.0; 
-      platform->phi     = base_p + target_p * attack_stage / 10.0;
-      platform->theta   = base_t + target_t * attack_stage / 10.0; 
-      platform->rho     = base_r + target_r * attack_stage / 10.0; 
-      attack_stage += 0.2;
-      sleep_time = 1000;
-    }
-    else jitter_mode = JITTER_DECAY;
-    break;
-  case JITTER_DECAY:
-    if (attack_stage > 0.0) {
-      platform->delta_x = target_x * attack_stage / 10.0;
-      platform->delta_y = target_y * attack_stage / 10.0; 
-      platform->delta_z = target_z * attack_stage / 10.0; 
-      platform->phi     = target_p * attack_stage / 10.0;
-      platform->theta   = target_t * attack_stage / 10.0; 
-      platform->rho     = target_r * attack_stage / 10.0; 
-      attack_stage -= 0.1;
-      sleep_time = 50000;
-    }
-    else {
-      jitter_mode = JITTER_ATTACK;
-      sleep_time = 3000000;
-    }
-    break;
+static double *
+pose_axis (int axis)
+{
+  switch (axis) {
+  case WS_AXIS_X:	return &platform->delta_x;
+  case WS_AXIS_Y:	return &platform->delta_y;
+  case WS_AXIS_Z:	return &platform->delta_z;
+  case WS_AXIS_ROLL:	return &platform->rho;
+  case WS_AXIS_PITCH:	return &platform->theta;
+  default:		return &platform->phi;
   }
-  return sleep_time;
+}
+
+/***
+    Demo motion: the jitter cycles of hardware4's web page (trajectory.h),
+    onset out to a random target, relax back, rest for interval, with
+    jitter_spec set by --jitter, or with --script a whole script played
+    once.  The motion_s (instance.h) keeps the state; this just moves the
+    one platform the renderer draws.
+ ***/
+
+jitter_spec_s jitter_spec;
+motion_s motion;
+script_s script;
+char *script_file = NULL;
+bool script_check_run = false;
+
+static void
+do_jitter (double dt)
+{
+  double pos[WS_AXES];
+  for (int a = 0; a < WS_AXES; a++) pos[a] = *pose_axis (a);
+  motion_step (&motion, dt, pos);
+  for (int a = 0; a < WS_AXES; a++) *pose_axis (a) = pos[a];
 }
 
 static void
@@ -540,69 +731,332 @@ update_alpha ()
       Based on the paper "The Mathematics of the Stewart Platform" from
 https://content.instructables.com/ORIG/FFI/8ZXW/I55MMY14/FFI8ZXWI55MMY14.pdf
 
+      The equations themselves are in ikcore.h, shared with the sketches.
+      The geometry-only terms (servo and anchor positions, cos/sin beta,
+      s^2 - a^2) live in ik_geo and are only recomputed by set_h0 (), so
+      all that is left per frame is the pose-dependent part of Eq 1 - 9.
+
   ***/
-  
-  // Eq 1
-  glm::mat4 xrot =	// pitch
-    glm::rotate ((float)platform->theta, glm::vec3 (1.0f, 0.0f, 0.0f));
-  glm::mat4 yrot =	// roll
-    glm::rotate ((float)platform->rho, glm::vec3 (0.0f, 1.0f, 0.0f));
-  glm::mat4 zrot =	// yaw
-    glm::rotate ((float)platform->phi, glm::vec3 (0.0f, 0.0f, 1.0f));
-  glm::mat4 compositeRotation = xrot * yrot * zrot;
 
-  double alpha_stage[6];
-  bool is_valid = true;
-  
-  for (int i = 0; i < servos.size (); i++) {
-    // Eq 3
-    glm::vec4 P =
-      glm::vec4 ((float)platform->delta_x,
-		 (float)(platform->delta_y + h0),
-		 (float)platform->delta_z, 1.0f) +
-      (compositeRotation *
-       glm::vec4 ((float)platform->anchors[i].x,
-		  (float)platform->anchors[i].y,
-		  (float)platform->anchors[i].z, 1.0f));
-
-    glm::vec3 B = glm::vec3 (servos[i]->pos.x, 0.0, servos[i]->pos.y);
-
-    glm::vec3 deltaPB = glm::vec3 (P) - B;
-
-    // Eq 9
-    double beta = (i & 1) ? (M_PI/6.0) : (-M_PI/6.0);
-    double l = (double)glm::length (deltaPB);
-    double L  =
-      pow (l, 2.0) - (pow (leg_length, 2.0) - pow (arm_length, 2.0));
-    double M  = 2.0 * arm_length * deltaPB.y;
-    double N  = 2.0 * arm_length *
-      (deltaPB.x * cos (beta) + deltaPB.z * sin (beta));
-    N = -fabs (N);
-    double arg = L / sqrt (pow (M, 2.0) + pow (N, 2.0));
-    double alpha = asin (arg) - atan2 (N, M);
-    if (isnan (alpha)) {
-      is_valid = false;
-      break;
-    }
-    else alpha_stage[i] = (i&1) ? -alpha : alpha;
+  ik_pose_s pose;
+  pose.delta_x = platform->delta_x;
+  pose.delta_y = platform->delta_y;
+  pose.delta_z = platform->delta_z;
+  pose.phi     = platform->phi;
+  pose.theta   = platform->theta;
+  pose.rho     = platform->rho;
+
+  double alpha_stage[IK_SERVOS];
+  pose_held = !ikc_solve (&ik_geo, &pose, alpha_stage);
+
+  if (!pose_held && monitor_pose) {
+    fk_jacobian_s stage;
+    struct timespec start, now;
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    fk_jacobian (&ik_geo, alpha_stage, &pose, &stage);
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    jacobian_usecs = 1.0e6 * (double)(now.tv_sec - start.tv_sec) +
+      1.0e-3 * (double)(now.tv_nsec - start.tv_nsec);
+    if (max_condition > 0.0 && stage.cond > max_condition) pose_held = true;
+    else jacobian = stage;
   }
-  if (is_valid) {
+
+  if (!pose_held) {
     for (int i = 0; i < servos.size (); i++)
       servos[i]->alpha = alpha_stage[i];
   }
 }
 
+static double
+elapsed (struct timespec *start)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (double)(now.tv_sec - start->tv_sec) +
+    1.0e-9 * (double)(now.tv_nsec - start->tv_nsec);
+}
+
 static void
-update_positions ()
+bench_ik (long count)
+{
+  typedef size_t (*batch_fn)(const ik_geometry_s *, const ik_pose_s *,
+			     double *, unsigned char *, size_t);
+  struct {
+    const char *name;
+    batch_fn    fn;
+    bool        have;
+  } kernels[] = {
+    { "scalar", ik_batch_scalar, true },
+    { "sse2",   ik_batch_sse2,   ik_batch_have_sse2 () },
+    { "avx2",   ik_batch_avx2,   ik_batch_have_avx2 () },
+  };
+  ik_geometry_s geo;
+  struct timespec start;
+  std::vector<ik_pose_s> poses (count);
+  std::vector<double> alphas (count * IK_SERVOS);
+  std::vector<double> ref (count * IK_SERVOS);
+  std::vector<unsigned char> valid (count);
+
+  fill_ik_geometry (&geo);
+
+  // the same envelope do_jitter () wanders through, doubled
+  for (long i = 0; i < count; i++) {
+    poses[i].delta_x = 4.0 * (drand48 () - 0.5);
+    poses[i].delta_y = 4.0 * (drand48 () - 0.5);
+    poses[i].delta_z = 4.0 * (drand48 () - 0.5);
+    poses[i].phi     = 0.4 * (drand48 () - 0.5);
+    poses[i].theta   = 0.4 * (drand48 () - 0.5);
+    poses[i].rho     = 0.4 * (drand48 () - 0.5);
+  }
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (long i = 0; i < count; i++) {
+    platform->delta_x = poses[i].delta_x;
+    platform->delta_y = poses[i].delta_y;
+    platform->delta_z = poses[i].delta_z;
+    platform->phi     = poses[i].phi;
+    platform->theta   = poses[i].theta;
+    platform->rho     = poses[i].rho;
+    update_alpha ();
+    for (int j = 0; j < IK_SERVOS; j++)
+      ref[i * IK_SERVOS + j] = servos[j]->alpha;
+  }
+  double secs = elapsed (&start);
+  fprintf (stdout, "%-14s %12.0f poses/sec\n", "update_alpha",
+	   (double)count / secs);
+
+  for (int k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+    if (!kernels[k].have) continue;
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    size_t nvalid = (*kernels[k].fn)(&geo, poses.data (), alphas.data (),
+				     valid.data (), count);
+    double ksecs = elapsed (&start);
+
+    double maxerr = 0.0;
+    for (long i = 0; i < count; i++) {
+      if (!valid[i]) continue;
+      for (int j = 0; j < IK_SERVOS; j++) {
+	double err = fabs (alphas[i * IK_SERVOS + j] - ref[i * IK_SERVOS + j]);
+	if (err > maxerr) maxerr = err;
+      }
+    }
+    fprintf (stdout, "%-14s %12.0f poses/sec  x%-6.1f %zu/%ld valid  \
+max diff %g rad\n",
+	     kernels[k].name, (double)count / ksecs, secs / ksecs,
+	     nvalid, count, maxerr);
+  }
+}
+
+static int
+compare_doubles (const void *a, const void *b)
+{
+  double da = *(const double *)a;
+  double db = *(const double *)b;
+  return (da < db) ? -1 : ((da > db) ? 1 : 0);
+}
+
+static double
+pose_error (const ik_pose_s *a, const ik_pose_s *b, double *lin, double *ang)
+{
+  double dl = hypot (hypot (a->delta_x - b->delta_x, a->delta_y - b->delta_y),
+		     a->delta_z - b->delta_z);
+  double da = fmax (fmax (fabs (a->phi - b->phi), fabs (a->theta - b->theta)),
+		    fabs (a->rho - b->rho));
+  if (lin && dl > *lin) *lin = dl;
+  if (ang && da > *ang) *ang = da;
+  return fmax (dl, da);
+}
+
+#define FK_BRANCH_JUMP 1.0e-3		// cm or radians
+#define FK_BRANCH_ALPHA 1.0e-6		// radians
+
+/***
+    A solve that converged more than FK_BRANCH_JUMP from the truth is a
+    branch jump only if the pose it found is another assembly for the same
+    angles, so IK on it gives them back.  If not, it simply converged
+    badly, and that counts against the accuracy.
+ ***/
+
+static bool
+other_branch (const ik_geometry_s *geo, const ik_pose_s *pose,
+	      const double *alpha)
+{
+  double back[IK_SERVOS];
+  if (!ik_batch_scalar (geo, pose, back, NULL, 1)) return false;
+  for (int j = 0; j < IK_SERVOS; j++)
+    if (fabs (back[j] - alpha[j]) > FK_BRANCH_ALPHA) return false;
+  return true;
+}
+
+static void
+bench_fk (long count)
+{
+  ik_geometry_s geo;
+  std::vector<ik_pose_s> truth (count);
+  std::vector<double> usecs;
+  std::vector<double> errs;
+  ik_pose_s guess;
+  ik_pose_s neutral;
+  double alpha[IK_SERVOS];
+  long solves = 0, iterations = 0, failures = 0, jumps = 0, jumps_d = 0;
+  long off = 0, off_d = 0, failures_d = 0;	// off: badly converged
+  long cold_iterations = 0, cold_converged = 0;
+  double lin_err = 0.0, ang_err = 0.0;		// vs update_alpha ()
+  double lin_err_d = 0.0, ang_err_d = 0.0;	// vs ik_batch_scalar ()
+  double lin_all = 0.0, ang_all = 0.0;		// jumps too
+  struct timespec start;
+
+  fill_ik_geometry (&geo);
+  memset (&neutral, 0, sizeof(neutral));
+  usecs.reserve (count);
+
+  // a smooth wander sampled at 1 kHz, the rate we want to close loops at
+  for (long i = 0; i < count; i++) {
+    double t = (double)i * 0.001;
+    truth[i].delta_x = 1.0 * sin (2.0 * M_PI * 0.31 * t);
+    truth[i].delta_y = 0.8 * sin (2.0 * M_PI * 0.17 * t + 1.0);
+    truth[i].delta_z = 1.0 * sin (2.0 * M_PI * 0.23 * t + 2.0);
+    truth[i].phi     = 0.1 * sin (2.0 * M_PI * 0.37 * t + 3.0);
+    truth[i].theta   = 0.1 * sin (2.0 * M_PI * 0.29 * t + 4.0);
+    truth[i].rho     = 0.1 * sin (2.0 * M_PI * 0.41 * t + 5.0);
+  }
+
+  /***
+      Near a singularity two assemblies share (almost) the same angles and
+      a warm start can land on the wrong one.  Those are counted as jumps
+      and the guess reseeded, rather than folded into the accuracy figure;
+      other_branch () tells them from a solve that is just off, which is
+      kept in.  The max over every converged solve is reported as well.
+   ***/
+
+  guess = truth[0];
+  for (long i = 0; i < count; i++) {
+    // update_alpha () keeps the old angles for a pose it cannot reach
+    if (!ik_batch_scalar (&geo, &truth[i], alpha, NULL, 1)) continue;
+
+    platform->delta_x = truth[i].delta_x;
+    platform->delta_y = truth[i].delta_y;
+    platform->delta_z = truth[i].delta_z;
+    platform->phi     = truth[i].phi;
+    platform->theta   = truth[i].theta;
+    platform->rho     = truth[i].rho;
+    update_alpha ();
+    for (int j = 0; j < IK_SERVOS; j++) alpha[j] = servos[j]->alpha;
+
+    fk_result_s res;
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    bool ok = fk_solve (&geo, alpha, &guess, &res);
+    usecs.push_back (1.0e6 * elapsed (&start));
+    solves++;
+    iterations += res.iterations;
+    if (!ok) failures++;
+    else if (pose_error (&guess, &truth[i], &lin_all, &ang_all) >
+	     FK_BRANCH_JUMP && other_branch (&geo, &guess, alpha))
+      jumps++;
+    else {
+      double e = pose_error (&guess, &truth[i], &lin_err, &ang_err);
+      errs.push_back (e);
+
+      ik_pose_s cold = neutral;
+      if (fk_solve (&geo, alpha, &cold, &res) &&
+	  pose_error (&cold, &truth[i], NULL, NULL) <= FK_BRANCH_JUMP) {
+	cold_converged++;
+	cold_iterations += res.iterations;
+      }
+      if (e <= FK_BRANCH_JUMP) continue;
+      off++;
+    }
+    guess = truth[i];
+  }
+
+  // round trip through the double precision kernel, no float in the loop
+  guess = truth[0];
+  for (long i = 0; i < count; i++) {
+    if (!ik_batch_scalar (&geo, &truth[i], alpha, NULL, 1)) continue;
+    if (!fk_solve (&geo, alpha, &guess, NULL)) failures_d++;
+    else if (pose_error (&guess, &truth[i], &lin_all, &ang_all) >
+	     FK_BRANCH_JUMP && other_branch (&geo, &guess, alpha))
+      jumps_d++;
+    else {
+      if (pose_error (&guess, &truth[i], &lin_err_d, &ang_err_d) <=
+	  FK_BRANCH_JUMP)
+	continue;
+      off_d++;
+    }
+    guess = truth[i];
+  }
+
+  if (solves == 0) {
+    fprintf (stdout, "fk_solve, no reachable poses\n");
+    return;
+  }
+  long good = solves - failures - jumps;	// off ones too
+  qsort (usecs.data (), solves, sizeof(double), compare_doubles);
+  fprintf (stdout, "fk_solve, %ld warm-started solves\n", solves);
+  fprintf (stdout, "latency      p50 %.2f us  p99 %.2f us  max %.2f us\n",
+	   usecs[solves / 2], usecs[(solves * 99) / 100], usecs[solves - 1]);
+  fprintf (stdout, "iterations   %.2f warm, %ld not converged, \
+%ld branch jumps\n",
+	   (double)iterations / (double)solves, failures, jumps);
+  fprintf (stdout, "from neutral %.2f iterations, %.1f%% reach the same pose\n",
+	   cold_converged ? (double)cold_iterations / (double)cold_converged
+	   : 0.0, good ? 100.0 * (double)cold_converged / (double)good : 0.0);
+  fprintf (stdout, "round trip   update_alpha   %.3g cm  %.3g rad max, \
+%ld off by over %g\n",
+	   lin_err, ang_err, off, FK_BRANCH_JUMP);
+  if (!errs.empty ()) {
+    qsort (errs.data (), errs.size (), sizeof(double), compare_doubles);
+    fprintf (stdout, "                            p50 %.3g  p99 %.3g\n",
+	     errs[errs.size () / 2], errs[(errs.size () * 99) / 100]);
+  }
+  fprintf (stdout, "round trip   double kernel  %.3g cm  %.3g rad max, \
+%ld off by over %g\n",
+	   lin_err_d, ang_err_d, off_d, FK_BRANCH_JUMP);
+  fprintf (stdout, "                            %ld not converged, \
+%ld branch jumps\n",
+	   failures_d, jumps_d);
+  fprintf (stdout, "every converged solve, jumps too, %.3g cm  %.3g rad max\n",
+	   lin_all, ang_all);
+}
+
+static void
+capture_frame (sim_frame_s *f)
+{
+  f->pose.delta_x = platform->delta_x;
+  f->pose.delta_y = platform->delta_y;
+  f->pose.delta_z = platform->delta_z;
+  f->pose.phi     = platform->phi;
+  f->pose.theta   = platform->theta;
+  f->pose.rho     = platform->rho;
+  for (int i = 0; i < IK_SERVOS; i++) f->alpha[i] = servos[i]->alpha;
+}
+
+static void
+blend_frames (const sim_frame_s *a, const sim_frame_s *b, double t,
+	      sim_frame_s *out)
+{
+#define BLEND(f) out->f = a->f + t * (b->f - a->f)
+  BLEND (pose.delta_x);
+  BLEND (pose.delta_y);
+  BLEND (pose.delta_z);
+  BLEND (pose.phi);
+  BLEND (pose.theta);
+  BLEND (pose.rho);
+  for (int i = 0; i < IK_SERVOS; i++) BLEND (alpha[i]);
+#undef BLEND
+}
+
+// one fixed step of the motion, dt seconds
+static void
+sim_step (double dt)
 {
-  unsigned int sleep_time = 10000;
   if (do_motion) {
     if (demo_mode) {
-      sleep_time = do_jitter ();
+      do_jitter (dt);
     }
     else {		// simple automation
       for (int i = 0; i < servos.size (); i++) {
-	servos[i]->alpha += servos[i]->alpha_incr;
+	servos[i]->alpha += servos[i]->alpha_incr * dt / AUTOMATION_PERIOD;
 	if (servos[i]->alpha >  3.0 * M_PI_2 ||
 	    servos[i]->alpha <  M_PI_2)
 	  servos[i]->alpha_incr = -servos[i]->alpha_incr;
@@ -611,17 +1065,220 @@ update_positions ()
 
     update_alpha ();
     
-    if (one_shot) enditall (0);
+    if (one_shot) sim_finished = true;
   }
-  usleep (sleep_time);
 }
 
+// on the sim thread, or on the GLUT thread before it starts
 static void
-init(void)
+apply_command (const sim_cmd_s *c)
 {
-  set_h0 ();
+  switch (c->op) {
+  case SIM_CMD_MOVE:
+    *pose_axis (c->axis) += c->value;
+    break;
+  case SIM_CMD_SET:
+    *pose_axis (c->axis) = c->value;
+    break;
+  case SIM_CMD_HOME:
+    for (int a = 0; a < WS_AXES; a++) *pose_axis (a) = 0.0;
+    break;
+  case SIM_CMD_MOTION:
+    do_motion = (c->value != 0.0);
+    break;
+  }
+}
+
+static void
+post_command (int op, int axis = 0, double value = 0.0)
+{
+  sim_cmd_s c = { op, axis, value };
+  if (!sim_running) apply_command (&c);
+  else if (!commands.push (c))
+    fprintf (stderr, "simulation queue full, input dropped\n");
+}
+
+// the latest geometry set_h0 () handed over, if the sim thread has not had it
+static bool
+take_geometry ()
+{
+  ik_geometry_s *geo = pending_geo.exchange (NULL, std::memory_order_acq_rel);
+  if (!geo) return false;
+  ik_geo = *geo;
+  delete geo;
   update_alpha ();
-	     
+  return true;
+}
+
+static void
+publish_snapshot (const sim_frame_s *prev, const sim_frame_s *curr)
+{
+  sim_snapshot_s *s = snapshots.write_buffer ();
+  s->prev = *prev;
+  s->curr = *curr;
+  s->t_curr = (double)sim_clock.last.tv_sec +
+    1.0e-9 * (double)sim_clock.last.tv_nsec - sim_clock.accumulator;
+  s->dt = sim_clock.dt;
+  s->steps = sim_clock.steps;
+  s->jacobian = jacobian;
+  s->jacobian_usecs = jacobian_usecs;
+  s->pose_held = pose_held;
+  snapshots.publish ();
+}
+
+/***
+    The sim thread: commands, then whatever steps are due, then a snapshot,
+    then sleep until the next step.  Sleeping is fine here, nothing else
+    runs on this thread.
+ ***/
+
+static void
+sim_loop ()
+{
+  sim_frame_s prev, curr;
+  capture_frame (&curr);
+  prev = curr;
+
+  while (!sim_quit.load (std::memory_order_relaxed)) {
+    sim_cmd_s c;
+    bool changed = take_geometry ();
+    while (commands.pop (&c)) {
+      apply_command (&c);
+      changed = true;
+    }
+
+    int n = sim_clock_tick (&sim_clock);
+    for (int i = 0; i < n && !sim_finished; i++) {
+      prev = curr;
+      sim_step (sim_clock.dt);
+      capture_frame (&curr);
+    }
+    // with the motion off, poses set from the keyboard or mouse show at once
+    if (!do_motion && (changed || n > 0)) {
+      capture_frame (&curr);
+      prev = curr;
+    }
+    if (changed || n > 0) publish_snapshot (&prev, &curr);
+    if (sim_finished) break;
+
+    double wait = sim_clock_until_next (&sim_clock);
+    struct timespec ts;
+    ts.tv_sec = (time_t)wait;
+    ts.tv_nsec = (long)(1.0e9 * (wait - (double)ts.tv_sec));
+    nanosleep (&ts, NULL);
+  }
+}
+
+static void
+start_sim ()
+{
+  sim_snapshot_s first;
+  sim_clock_init (&sim_clock, sim_rate);
+  sim_clock_tick (&sim_clock);
+  capture_frame (&first.curr);
+  first.prev = first.curr;
+  first.t_curr = sim_clock_now ();
+  first.dt = sim_clock.dt;
+  first.steps = 0;
+  first.jacobian = jacobian;
+  first.jacobian_usecs = jacobian_usecs;
+  first.pose_held = pose_held;
+  snapshots.reset (first);
+  latest = snapshots.read ();
+  blend_frames (&first.prev, &first.curr, 0.0, &view);
+
+  sim_running = true;
+  sim_thread = std::thread (sim_loop);
+}
+
+static void
+stop_sim ()
+{
+  if (!sim_running) return;
+  sim_quit = true;
+  if (sim_thread.get_id () != std::this_thread::get_id ()) sim_thread.join ();
+  else sim_thread.detach ();
+  sim_running = false;
+  take_geometry ();
+}
+
+// the GLUT thread's side: the latest snapshot, blended to now
+static void
+update_positions ()
+{
+  latest = snapshots.read ();
+  double t = (sim_clock_now () - latest->t_curr) / latest->dt;
+  if (t < 0.0) t = 0.0;
+  if (t > 1.0) t = 1.0;
+  blend_frames (&latest->prev, &latest->curr, t, &view);
+}
+
+/***
+    Redraw only when there is something new to show.  display () keeps
+    what it drew in drawn; spin () compares the blended pose and the
+    camera with it, and the input handlers, reshape and a geometry reload
+    call request_redraw () for everything else (the toggles, the window).
+    Video capture wants every frame, so with --record, or --continuous,
+    every idle callback redraws as before.  Otherwise, once spin () finds
+    nothing to draw it takes itself off the idle callback, which keeps an
+    idle simulator off the CPU, and idle_poll () looks every IDLE_POLL_MS
+    at the replay log, the geometry file and any fresh snapshot instead.
+    request_redraw () and a pose that has moved put spin () back.  Nothing
+    sleeps, so input and reshape events are handled as they come.
+ ***/
+
+#define IDLE_POLL_MS 10
+
+typedef struct {
+  sim_frame_s view;
+  double      location[3];
+  double      centre[3];
+  int         up;
+  bool        held;
+} redraw_state_s;
+
+redraw_state_s drawn;
+bool redraw_needed = true;
+bool idle_polling = false;		// spin () is off, idle_poll () is on
+int idle_gen = 0;			// the idle_poll () timer that counts
+
+static void spin (void);
+
+static void
+wake_idle ()
+{
+  if (!idle_polling) return;
+  idle_polling = false;
+  idle_gen++;
+  glutIdleFunc (spin);
+}
+
+static void
+request_redraw ()
+{
+  redraw_needed = true;
+  wake_idle ();
+}
+
+static void
+capture_redraw_state (redraw_state_s *r)
+{
+  memset (r, 0, sizeof(*r));		// padding too, for the memcmp
+  r->view = view;
+  r->location[0] = location.x;
+  r->location[1] = location.y;
+  r->location[2] = location.z;
+  r->centre[0] = centre.x;
+  r->centre[1] = centre.y;
+  r->centre[2] = centre.z;
+  r->up = (int)upi;
+  r->held = latest->pose_held;
+}
+
+// false if it fell back to GLUT drawing, which needs glutInit ()
+static bool
+init_gl (void)
+{
   GLfloat white[]       = { 1.0, 1.0, 1.0, 1.0 };
   GLfloat black[]       = { 0.0, 0.0, 0.0, 1.0 };
   GLfloat direction0[]   = { 15.0, 15.0, -15.0, 0.0 };
@@ -641,27 +1298,169 @@ init(void)
   glLightfv(GL_LIGHT2, GL_DIFFUSE, white);
   glLightfv(GL_LIGHT2, GL_POSITION, direction2);
 
-  glLightfv(GL_LIGHT3, GL_AMBIENT, black);
-  glLightfv(GL_LIGHT3, GL_DIFFUSE, white);
-  glLightfv(GL_LIGHT3, GL_POSITION, direction3);
+  glLightfv(GL_LIGHT3, GL_AMBIENT, black);
+  glLightfv(GL_LIGHT3, GL_DIFFUSE, white);
+  glLightfv(GL_LIGHT3, GL_POSITION, direction3);
+
+  glClearColor (0.0, 0.0, 0.0, 0.0);
+  glEnable (GL_LIGHTING);
+  glEnable (GL_LIGHT0);
+  glEnable (GL_LIGHT1);
+  glEnable (GL_LIGHT2);
+  glEnable (GL_LIGHT3);
+  glEnable(GL_COLOR_MATERIAL);
+
+  bool own = true;
+  if (!mesh_init ()) {
+    fprintf (stderr, "no instanced drawing, using glutSolid*\n");
+    own = false;
+  }
+  mesh_lod_build (&balls, MESH_SPHERE);
+  mesh_lod_build (&rods, MESH_CYLINDER);
+  if (!text_init (&hud_font, font_file ? font_file : DEFAULT_FONT,
+		  FONT_PIXELS)) {
+    fprintf (stderr, "no font, using glutBitmapString\n");
+    own = false;
+  }
+  return own;
+}
+
+static void
+init(void)
+{
+  set_h0 ();
+  update_alpha ();
+  start_sim ();
+  init_gl ();
+}
+
+static void
+place_servos ()
+{
+  for (int i = 0; i < servos.size (); i++) {
+    servos[i]->pos.x = base_radius * cos (geometry.base_angle[i]);
+    servos[i]->pos.y = base_radius * sin (geometry.base_angle[i]);
+    servos[i]->rotation_angle = geometry.base_angle[i];
+  }
+}
+
+static void
+place_anchors ()
+{
+  for (int i = 0; i < platform->anchors.size (); i++) {
+    platform->anchors[i].x = platform_radius * cos (geometry.platform_angle[i]);
+    platform->anchors[i].z = platform_radius * sin (geometry.platform_angle[i]);
+  }
+}
+
+static void
+set_base_radius ()
+{
+  place_servos ();
+  set_h0 ();
+}
+
+static void
+set_platform_radius ()
+{
+  place_anchors ();
+  set_h0 ();
+}
+
+static void
+apply_geometry ()
+{
+  base_radius     = geometry.base_radius;
+  platform_radius = geometry.platform_radius;
+  arm_length      = geometry.arm_length;
+  leg_length      = geometry.leg_length;
+  for (int i = 0; i < servos.size (); i++)
+    servos[i]->set_shaft (geometry.shaft_angle[i]);
+  for (int i = 0; i < platform->anchors.size (); i++)
+    platform->anchors[i].y = 0.0;
+  // both radii before set_h0 (), so the sim thread never sees one alone
+  place_anchors ();
+  place_servos ();
+  set_h0 ();
+  if (!sim_running) update_alpha ();	// else the new geometry does it
+}
+
+static time_t
+file_mtime (const char *fn)
+{
+  struct stat sb;
+  return (stat (fn, &sb) == 0) ? sb.st_mtime : 0;
+}
+
+/***
+    Called from the idle loop.  Polls the geometry file's mtime and, if it
+    has changed, reloads it over the defaults, so a key taken out of the
+    file goes back to its default; a file that fails to parse leaves the
+    current geometry in place.
+ ***/
 
-  glClearColor (0.0, 0.0, 0.0, 0.0);
-  glEnable (GL_LIGHTING);
-  glEnable (GL_LIGHT0);
-  glEnable (GL_LIGHT1);
-  glEnable (GL_LIGHT2);
-  glEnable (GL_LIGHT3);
-  glEnable(GL_COLOR_MATERIAL);
+static void
+check_geometry_file ()
+{
+  static struct timespec last;
+  struct timespec now;
+
+  if (!geometry_file) return;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  if ((double)(now.tv_sec - last.tv_sec) +
+      1.0e-9 * (double)(now.tv_nsec - last.tv_nsec) < GEOMETRY_POLL_INTERVAL)
+    return;
+  last = now;
+
+  time_t mtime = file_mtime (geometry_file);
+  if (mtime == 0 || mtime == geometry_mtime) return;
+  geometry_mtime = mtime;
+  geometry_s fresh;
+  geometry_default (&fresh);
+  if (geometry_load (geometry_file, &fresh)) {
+    geometry = fresh;
+    apply_geometry ();
+    request_redraw ();
+    fprintf (stderr, "geometry reloaded from %s\n", geometry_file);
+  }
+}
 
+static void replay_input ();
 
+static void
+idle_poll (int gen)
+{
+  if (gen != idle_gen || !idle_polling) return;	// spin () is back
+  if (sim_finished || quit_signal) enditall (0);
+  if (input_replay_file) replay_input ();
+  check_geometry_file ();
+  if (idle_polling && snapshots.fresh ()) {
+    redraw_state_s now;
+    update_positions ();
+    capture_redraw_state (&now);
+    if (memcmp (&now, &drawn, sizeof(now))) wake_idle ();
+  }
+  if (idle_polling) glutTimerFunc (IDLE_POLL_MS, idle_poll, gen);
 }
 
 static void
 spin (void)
 {
- 
+  if (sim_finished || quit_signal) enditall (0);
+  if (input_replay_file) replay_input ();
+  check_geometry_file ();
   update_positions ();
-  glutPostRedisplay();
+
+  redraw_state_s now;
+  capture_redraw_state (&now);
+  if (redraw_needed || continuous || ffmpeg ||
+      memcmp (&now, &drawn, sizeof(now))) {
+    glutPostRedisplay();
+    return;
+  }
+  idle_polling = true;
+  glutIdleFunc (NULL);
+  glutTimerFunc (IDLE_POLL_MS, idle_poll, idle_gen);
 }
 
 static void
@@ -751,21 +1550,40 @@ renderString(float x, float y, void *font, const unsigned char* string,
   glPopMatrix();
 }
 
+// balls and rods are collected as they are worked out, then drawn at once
+static void
+add_ball (const glm::mat4 &mv, double radius, int colour)
+{
+  float rgb[3];
+  servo_colour (colour, rgb);
+  mesh_lod_add (&balls, glm::value_ptr (mv), radius, radius, radius, rgb,
+		lod_pixels);
+}
+
+static void
+add_rod (const glm::mat4 &mv, double radius, double length, int colour)
+{
+  float rgb[3];
+  servo_colour (colour, rgb);
+  mesh_lod_add (&rods, glm::value_ptr (mv), radius, radius, length, rgb,
+		lod_pixels);
+}
+
 static void
 show_platform (glm::mat4 &baseXform)
 {
-  glm::vec3 transVec = glm::vec3 ((float)platform->delta_x,
-				  (float)(h0 + platform->delta_y),
-				  (float)platform->delta_z);
+  glm::vec3 transVec = glm::vec3 ((float)view.pose.delta_x,
+				  (float)(h0 + view.pose.delta_y),
+				  (float)view.pose.delta_z);
 
   glm::mat4 transMatrix = glm::translate (glm::mat4(1.0f), transVec);
 
   glm::mat4 xrot =	// pitch
-    glm::rotate ((float)platform->theta, glm::vec3 (1.0f, 0.0f, 0.0f));
+    glm::rotate ((float)view.pose.theta, glm::vec3 (1.0f, 0.0f, 0.0f));
   glm::mat4 yrot =	// roll
-    glm::rotate ((float)platform->rho, glm::vec3 (0.0f, 1.0f, 0.0f));
+    glm::rotate ((float)view.pose.rho, glm::vec3 (0.0f, 1.0f, 0.0f));
   glm::mat4 zrot =	// yaw
-    glm::rotate ((float)platform->phi, glm::vec3 (0.0f, 0.0f, 1.0f));
+    glm::rotate ((float)view.pose.phi, glm::vec3 (0.0f, 0.0f, 1.0f));
   glm::mat4 compositeRotation = xrot * yrot * zrot;
       
   glm::mat4 compositeMatrix = transMatrix * compositeRotation;
@@ -776,7 +1594,6 @@ show_platform (glm::mat4 &baseXform)
 
     draw_platform ();
   
-    glFlush ();
     glPopMatrix();
   }
 
@@ -785,17 +1602,8 @@ show_platform (glm::mat4 &baseXform)
     glm::mat4 anchorMatrix = glm::translate (glm::mat4(1.0f), pos);
     glm::mat4 localAnchorMatrix = compositeRotation * anchorMatrix;
     glm::mat4 compositeAnchorMatrix = transMatrix * localAnchorMatrix;
-    {
-      glPushMatrix();
-      glLoadMatrixf (glm::value_ptr (baseXform * compositeAnchorMatrix));
-      platform->anchor_mtx[i]  = compositeAnchorMatrix;
-      
-      set_colours (i);
-      glutSolidSphere (0.4, 32, 32);
-  
-      glFlush ();
-      glPopMatrix();
-    }
+    platform->anchor_mtx[i]  = compositeAnchorMatrix;
+    add_ball (baseXform * compositeAnchorMatrix, 0.4, i);
   }
 }
 
@@ -803,49 +1611,30 @@ static void
 show_servos (glm::mat4 &baseXform)
 {
   for (int i = 0; i < servos.size (); i++) {    // servos
-    set_colours (i);
-
-    glPushMatrix();
-
     glm::vec3 transVec = glm::vec3 (servos[i]->pos.x, 0.0, servos[i]->pos.y);
     glm::mat4 transMatrix = glm::translate (glm::mat4(1.0f), transVec);
-    glLoadMatrixf (glm::value_ptr (baseXform * transMatrix));
-    
-    glutSolidSphere (0.3, 32, 32);		  // shaft dot
-
-    {
-      glPushMatrix();  // shaft and actuator arm		
-      glm::mat4 arm_angle =
-	glm::rotate ((float)servos[i]->shaft_angle, glm::vec3 (0.0, 1.0, 0.0));
-      glm::mat4 currentMtx = transMatrix * arm_angle;
-      glLoadMatrixf (glm::value_ptr (baseXform *currentMtx));
-      glutSolidCylinder(SHAFT_DIAMETER / 2.0, -SHAFT_LENGTH,  32,   32); //683
-      glFlush ();
-      {
-	glm::mat4 interMatrix =
-	  glm::translate (currentMtx, glm::vec3 (0.0f, 0.0f, -1.0f));  // 687
-	glm::mat4 x90Mtx   =
-	  glm::rotate ((float)M_PI_2, glm::vec3 (1.0f, 0.0f, 0.0f));
-	double adjAlpha = (i&1) ? -M_PI_2 : M_PI_2;
-	glm::mat4 alphaMtx = 
-	  glm::rotate ((float)(servos[i]->alpha +adjAlpha),
-		       glm::vec3 (0.0f, 1.0f, 0.0f));
-	glPushMatrix();
-	glm::mat4 fMtx = interMatrix * x90Mtx * alphaMtx;
-	glLoadMatrixf (glm::value_ptr (baseXform * fMtx));
-	glutSolidCylinder(ARM_RADIUS, arm_length,  32,   32);
-	glutSolidSphere (0.3, 32, 32);  // shaft dot
-        glFlush ();
-        glPopMatrix();
-	interMatrix =
-	  glm::translate (fMtx, glm::vec3 (0.0f, 0.0f, arm_length));  // 687
-	servos[i]->servo_mtx = interMatrix;
-      }
-      glFlush ();
-      glPopMatrix();
-    }
-    glFlush ();
-    glPopMatrix();
+    add_ball (baseXform * transMatrix, 0.3, i);		  // shaft dot
+
+    // shaft and actuator arm
+    glm::mat4 arm_angle =
+      glm::rotate ((float)servos[i]->shaft_angle, glm::vec3 (0.0, 1.0, 0.0));
+    glm::mat4 currentMtx = transMatrix * arm_angle;
+    add_rod (baseXform * currentMtx, SHAFT_DIAMETER / 2.0, -SHAFT_LENGTH, i);
+
+    glm::mat4 interMatrix =
+      glm::translate (currentMtx, glm::vec3 (0.0f, 0.0f, -1.0f));  // 687
+    glm::mat4 x90Mtx   =
+      glm::rotate ((float)M_PI_2, glm::vec3 (1.0f, 0.0f, 0.0f));
+    double adjAlpha = (i&1) ? -M_PI_2 : M_PI_2;
+    glm::mat4 alphaMtx = 
+      glm::rotate ((float)(view.alpha[i] +adjAlpha),
+		   glm::vec3 (0.0f, 1.0f, 0.0f));
+    glm::mat4 fMtx = interMatrix * x90Mtx * alphaMtx;
+    add_rod (baseXform * fMtx, ARM_RADIUS, arm_length, i);
+    add_ball (baseXform * fMtx, 0.3, i);		  // shaft dot
+    interMatrix =
+      glm::translate (fMtx, glm::vec3 (0.0f, 0.0f, arm_length));  // 687
+    servos[i]->servo_mtx = interMatrix;
   }
 }
 
@@ -853,7 +1642,6 @@ static void
 show_links (glm::mat4 &baseXform)
 {
   for (int i = 0; i < servos.size (); i++) {    // servos
-    set_colours (i);
     glm::vec4 anc_loc =
       platform->anchor_mtx[i] *
       glm::vec4 (0.0f, 0.0f, 0.0f, 1.0f);
@@ -867,24 +1655,10 @@ show_links (glm::mat4 &baseXform)
     float ang = (float)(acos (dotprod / glm::length (delta)));
     glm::vec3 rotAxis =
       glm::normalize (glm::cross (delta, glm::vec3 (0.0f, 0.0f, 1.0f)));
-    {
-      glm::mat4 rotMtx = glm::rotate (-ang, rotAxis);
-      glPushMatrix();
-      glm::mat4 tx = glm::translate (glm::mat4 (1.0f), glm::vec3 (svo_loc));
-      glLoadMatrixf (glm::value_ptr ( baseXform * tx * rotMtx));
-      glutSolidCylinder(ARM_RADIUS/2.0f, glm::length (delta),  32,   32);
-      glFlush ();
-      glPopMatrix();
-    }
-    
-    
-    {					// servo ball
-      glPushMatrix();
-      glLoadMatrixf (glm::value_ptr (baseXform * servos[i]->servo_mtx));
-      glutSolidSphere (0.3, 32, 32);
-      glFlush ();
-      glPopMatrix();
-    }
+    glm::mat4 rotMtx = glm::rotate (-ang, rotAxis);
+    glm::mat4 tx = glm::translate (glm::mat4 (1.0f), glm::vec3 (svo_loc));
+    add_rod (baseXform * tx * rotMtx, ARM_RADIUS/2.0f, glm::length (delta), i);
+    add_ball (baseXform * servos[i]->servo_mtx, 0.3, i);	// servo ball
 
 #if 0			// anchor balls just for test
     {
@@ -892,16 +1666,138 @@ show_links (glm::mat4 &baseXform)
       glLoadMatrixf (glm::value_ptr ( baseXform * platform->anchor_mtx[i]));
       glutSolidSphere (0.6, 32, 32);
       glutSolidCylinder(ARM_RADIUS, arm_length,  32,   32);
-      glFlush ();
       glPopMatrix();
     }
 #endif
   }
 }
 
+// appends to the item at x, y, starting one if there is none there yet
+static void
+hud_add (float x, float y, int *at, const char *fmt, ...)
+{
+  if (*at < 0) {
+    if (hud_items >= HUD_ITEMS) return;
+    *at = hud_items++;
+    hud[*at].x = x;
+    hud[*at].y = y;
+    hud[*at].text[0] = 0;
+  }
+  char *text = hud[*at].text;
+  size_t used = strlen (text);
+  va_list ap;
+  va_start (ap, fmt);
+  vsnprintf (text + used, HUD_TEXT - used, fmt, ap);
+  va_end (ap);
+}
 
 static void
-display(void)
+show_hud (int w, int h)
+{
+  hud_values_s now;
+  memset (&now, 0, sizeof(now));	// padding too, for the memcmp
+  now.width = w;
+  now.height = h;
+  now.location[0] = location.x;
+  now.location[1] = location.y;
+  now.location[2] = location.z;
+  now.centre[0] = centre.x;
+  now.centre[1] = centre.y;
+  now.centre[2] = centre.z;
+  now.pose[0] = view.pose.rho;
+  now.pose[1] = view.pose.theta;
+  now.pose[2] = view.pose.phi;
+  now.pose[3] = view.pose.delta_x;
+  now.pose[4] = view.pose.delta_y;
+  now.pose[5] = view.pose.delta_z;
+  now.h0 = h0;
+  now.cond = latest->jacobian.cond;
+  now.sigma_min = latest->jacobian.sigma_min;
+  now.sigma_max = latest->jacobian.sigma_max;
+  if (show_jacobian)
+    memcpy (now.J, latest->jacobian.J, sizeof(now.J));
+  now.tenth_usecs = lrint (latest->jacobian_usecs * 10.0);
+  now.held = latest->pose_held;
+  now.jacobian = show_jacobian;
+  now.triangles = show_triangles;
+  if (show_triangles) now.mesh = mesh_stats;
+  if (ffmpeg) {
+    now.recording = true;
+    now.queued = feeder.count.depth;
+    now.frames = feeder.count.frames;
+    now.dropped = feeder.count.dropped;
+    now.duplicated = feeder.count.duplicated;
+  }
+
+  if (hud_items < 0 || memcmp (&now, &hud_values, sizeof(now))) {
+    hud_values = now;
+    hud_items = 0;
+
+    int at = -1;
+    hud_add (READOUT_VIEW_X, READOUT_VIEW_Y, &at,
+	     "location %#0.3g\t%#0.3g\t%#g\nlookat %#0.3g\t%#0.3g\t%#g\n",
+	     location.x, location.y, location.y,
+	     centre.x, centre.y, centre.z);
+    at = -1;
+    hud_add (READOUT_PLATFORM_X, READOUT_PLATFORM_Y, &at,
+	     "platform\nroll %#0.3g\tpitch %#0.3g\tyaw %#g\n\
+offset %#0.3g\t%#0.3g\t%#g\n",
+	     view.pose.rho, view.pose.theta, view.pose.phi,
+	     view.pose.delta_x, h0 + view.pose.delta_y, view.pose.delta_z);
+    at = -1;
+    hud_add (READOUT_JACOBIAN_X, READOUT_JACOBIAN_Y, &at,
+	     "cond %#0.4g%s\tsigma %#0.3g .. %#0.3g\t(%0.1f us)\n",
+	     latest->jacobian.cond, latest->pose_held ? " HELD" : "",
+	     latest->jacobian.sigma_min, latest->jacobian.sigma_max,
+	     latest->jacobian_usecs);
+    if (show_jacobian) {
+      static const char *rows[IK_SERVOS] =
+	{ "vx", "vy", "vz", "wx", "wy", "wz" };
+      for (int r = 0; r < IK_SERVOS; r++)
+	hud_add (READOUT_JACOBIAN_X, READOUT_JACOBIAN_Y, &at,
+		 "%s % 7.3f % 7.3f % 7.3f % 7.3f % 7.3f % 7.3f\n", rows[r],
+		 latest->jacobian.J[r][0], latest->jacobian.J[r][1],
+		 latest->jacobian.J[r][2], latest->jacobian.J[r][3],
+		 latest->jacobian.J[r][4], latest->jacobian.J[r][5]);
+    }
+    if (show_triangles) {
+      at = -1;
+      hud_add (READOUT_TRIANGLES_X, READOUT_TRIANGLES_Y, &at,
+	       "triangles %zu\tdraws %d\tlod", mesh_stats.triangles,
+	       mesh_stats.draws);
+      for (int l = 0; l < MESH_LODS; l++)
+	hud_add (READOUT_TRIANGLES_X, READOUT_TRIANGLES_Y, &at, "  %d:%d",
+		 mesh_lod_slices (l), mesh_stats.instances[l]);
+    }
+
+    if (now.recording) {
+      at = -1;
+      hud_add (READOUT_RECORD_X, READOUT_RECORD_Y, &at,
+	       "rec %ld\tqueue %d/%d\tdropped %ld\tduplicated %ld",
+	       now.frames, now.queued, record_queue, now.dropped,
+	       now.duplicated);
+    }
+
+    if (hud_font.texture) {
+      static const float yellow[3] = { 1.0f, 1.0f, 0.0f };
+      text_clear (&hud_layout);
+      for (int i = 0; i < hud_items; i++)
+	text_add (&hud_layout, &hud_font, hud[i].x, hud[i].y, w, h,
+		  hud[i].text, yellow);
+    }
+  }
+
+  if (hud_font.texture)
+    text_draw (&hud_font, &hud_layout, w, h);
+  else if (!headless)			// glut bitmaps need glutInit
+    for (int i = 0; i < hud_items; i++)
+      renderString (hud[i].x, hud[i].y, GLUT_BITMAP_HELVETICA_18,
+		    (const unsigned char*)hud[i].text, 1.0f, 1.0f, 0.0f);
+}
+
+// the scene and the HUD into the current framebuffer, and to ffmpeg
+static void
+draw_scene (void)
 {
   glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -921,28 +1817,19 @@ display(void)
 	     centre.x, centre.y, centre.z,             // ctr
              ux, uy, uz);               // up
 
-  char *string;
-  asprintf (&string, "location %#0.3g\t%#0.3g\t%#g\nlookat %#0.3g\t%#0.3g\t%#g\n",
-	    location.x, location.y, location.y,
-	    centre.x, centre.y, centre.z);
-  renderString (READOUT_VIEW_X, READOUT_VIEW_Y, GLUT_BITMAP_HELVETICA_18,
-	       (const unsigned char*)string,
-	       1.0f, 1.0f, 0.0f);
-  free (string);
-  asprintf (&string, "platform\nroll %#0.3g\tpitch %#0.3g\tyaw %#g\noffset %#0.3g\t%#0.3g\t%#g\n",
-	    platform->rho, platform->theta, platform->phi,
-	    platform->delta_x, h0 + platform->delta_y, platform->delta_z);
-  renderString (READOUT_PLATFORM_X, READOUT_PLATFORM_Y,
-		GLUT_BITMAP_HELVETICA_18,
-	       (const unsigned char*)string,
-	       1.0f, 1.0f, 0.0f);
-
   glm::mat4 baseXform;
   {
     float m[16];
     glGetFloatv (GL_MODELVIEW_MATRIX, m);
     baseXform = glm::make_mat4(m);
   }
+  GLint vp[4];
+  {
+    float proj[16];
+    glGetIntegerv (GL_VIEWPORT, vp);
+    glGetFloatv (GL_PROJECTION_MATRIX, proj);
+    lod_pixels = 0.5 * vp[3] * proj[5];
+  }
 
   show_platform (baseXform);
 
@@ -950,20 +1837,36 @@ display(void)
 
   show_links (baseXform);
 
+  memset (&mesh_stats, 0, sizeof(mesh_stats));
+  mesh_lod_draw (&balls, &mesh_stats);
+  mesh_lod_draw (&rods, &mesh_stats);
+  show_hud (vp[2], vp[3]);
 
-  if (ffmpeg) {
-    void *buffer = malloc (sizeof(int) * width * height);
-    glReadBuffer (GL_BACK);
-    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, buffer);
-    fwrite(buffer, sizeof(int) * width * height, 1, ffmpeg);
-    free (buffer);
-  }
+  // the platform's front face is drawn in whatever colour the last
+  // servo left current
+  set_colours (servos.size () - 1);
+
+
+  if (ffmpeg)
+    readback_frame (&readback, headless ? GL_COLOR_ATTACHMENT0 : GL_BACK,
+		    &feeder);
+}
+
+static void
+display(void)
+{
+  draw_scene ();
   glutSwapBuffers();
+  capture_redraw_state (&drawn);
+  redraw_needed = false;
 }
 
 static void
 reshape (int w, int h)
 {	
+  request_redraw ();
+  window_width = w;
+  window_height = h;
   glViewport (0, 0, (GLsizei) w, (GLsizei) h);
   glMatrixMode (GL_PROJECTION);
   glLoadIdentity ();
@@ -972,46 +1875,10 @@ reshape (int w, int h)
 }
 
 static void
-set_base_radius ()
-{
-  servos[0]->pos.x = base_radius * cos (B0_ANGLE);
-  servos[0]->pos.y = base_radius * sin (B0_ANGLE);
-  servos[1]->pos.x = base_radius * cos (B1_ANGLE);
-  servos[1]->pos.y = base_radius * sin (B1_ANGLE);
-  servos[2]->pos.x = base_radius * cos (B2_ANGLE);
-  servos[2]->pos.y = base_radius * sin (B2_ANGLE);
-  servos[3]->pos.x = base_radius * cos (B3_ANGLE);
-  servos[3]->pos.y = base_radius * sin (B3_ANGLE);
-  servos[4]->pos.x = base_radius * cos (B4_ANGLE);
-  servos[4]->pos.y = base_radius * sin (B4_ANGLE);
-  servos[5]->pos.x = base_radius * cos (B5_ANGLE);
-  servos[5]->pos.y = base_radius * sin (B5_ANGLE);;
-  set_h0 ();
-}
-
-static void
-set_platform_radius ()
-{
-  platform->anchors[0].x = platform_radius * cos (P0_ANGLE);
-  platform->anchors[0].z = platform_radius * sin (P0_ANGLE);
-  platform->anchors[1].x = platform_radius * cos (P1_ANGLE);
-  platform->anchors[1].z = platform_radius * sin (P1_ANGLE);
-  platform->anchors[2].x = platform_radius * cos (P2_ANGLE);
-  platform->anchors[2].z = platform_radius * sin (P2_ANGLE);
-  platform->anchors[3].x = platform_radius * cos (P3_ANGLE);
-  platform->anchors[3].z = platform_radius * sin (P3_ANGLE);
-  platform->anchors[4].x = platform_radius * cos (P4_ANGLE);
-  platform->anchors[4].z = platform_radius * sin (P4_ANGLE);
-  platform->anchors[5].x = platform_radius * cos (P5_ANGLE);
-  platform->anchors[5].z = platform_radius * sin (P5_ANGLE);;
-  set_h0 ();
-}
-
-static void
-specialkeys (int key, int x, int y)
+do_specialkeys (int key, int x, int y, int mod)
 {
+  request_redraw ();
   // https://www.opengl.org/resources/libraries/glut/spec3/node54.html#SECTION00089000000000000000
-  int mod = glutGetModifiers ();
   if ((mod & ~GLUT_ACTIVE_SHIFT) == GLUT_ACTIVE_CTRL) {	// move camera
     bool showeye  = false;
     bool showlook = false;
@@ -1050,24 +1917,19 @@ specialkeys (int key, int x, int y)
   else {	// move platform un-ctrled, un-alted
     switch (key) {
     case GLUT_KEY_LEFT:
-      platform->delta_x -= 0.2;
+      post_command (SIM_CMD_MOVE, WS_AXIS_X, -0.2);
       break;
     case GLUT_KEY_RIGHT:
-      platform->delta_x += 0.2;
+      post_command (SIM_CMD_MOVE, WS_AXIS_X, 0.2);
       break;
     case GLUT_KEY_DOWN:
-      platform->delta_z += 0.2;
+      post_command (SIM_CMD_MOVE, WS_AXIS_Z, 0.2);
       break;
     case GLUT_KEY_UP:
-      platform->delta_z -= 0.2;
+      post_command (SIM_CMD_MOVE, WS_AXIS_Z, -0.2);
       break;
     case GLUT_KEY_HOME:
-      platform->rho   = 0.0;
-      platform->phi   = 0.0;
-      platform->theta = 0.0;
-      platform->delta_x = 0.0;
-      platform->delta_y = 0.0;
-      platform->delta_z = 0.0;
+      post_command (SIM_CMD_HOME);
       break;
     }
   }
@@ -1092,6 +1954,8 @@ show_help ()
   fprintf (stdout, "\tu	platform raise\n");
   fprintf (stdout, "\tm	pause motion\n");
   fprintf (stdout, "\tM	resume motion\n");
+  fprintf (stdout, "\tj	show/hide the velocity Jacobian\n");
+  fprintf (stdout, "\tt	show/hide triangle counts and detail levels\n");
 
   fprintf (stdout, "\nControl Keys:\n");
   fprintf (stdout, "\tctrl-d	zoom in\n");
@@ -1251,8 +2115,9 @@ dump_scad ()
 }
 
 static void
-keyboard (unsigned char key, int x, int y)
+do_keyboard (unsigned char key, int x, int y, int mod)
 {
+  request_redraw ();
   if (key == 27 || key == 'q') {
 #if 1
     enditall (0);
@@ -1264,7 +2129,6 @@ keyboard (unsigned char key, int x, int y)
 #endif
   }
   
-  int mod = glutGetModifiers ();
   if ((mod & ~GLUT_ACTIVE_SHIFT) == GLUT_ACTIVE_CTRL) {	// move camera
     bool showeye  = false;
     bool showlook = false;
@@ -1377,28 +2241,28 @@ keyboard (unsigned char key, int x, int y)
   else {	// move platform un-ctrled, un-alted
     switch (key) {
     case 'r':				// roll
-      platform->phi -= 0.02;
+      post_command (SIM_CMD_MOVE, WS_AXIS_YAW, -0.02);
       break;
     case 'R':
-      platform->phi += 0.02;
+      post_command (SIM_CMD_MOVE, WS_AXIS_YAW, 0.02);
       break;
     case 'p':				// pitch
-      platform->theta -= 0.02;
+      post_command (SIM_CMD_MOVE, WS_AXIS_PITCH, -0.02);
       break;
     case 'P':
-      platform->theta += 0.02;
+      post_command (SIM_CMD_MOVE, WS_AXIS_PITCH, 0.02);
       break;
     case 'y':				// yaw
-      platform->rho -= 0.02;
+      post_command (SIM_CMD_MOVE, WS_AXIS_ROLL, -0.02);
       break;
     case 'Y':
-      platform->rho += 0.02;
+      post_command (SIM_CMD_MOVE, WS_AXIS_ROLL, 0.02);
       break;
     case 'd':				// down
-      platform->delta_y -= 0.2;
+      post_command (SIM_CMD_MOVE, WS_AXIS_Y, -0.2);
       break;
     case 'u':				// up
-      platform->delta_y += 0.2;
+      post_command (SIM_CMD_MOVE, WS_AXIS_Y, 0.2);
       break;
     case '?':
       fprintf (stderr, "y/Y - platform yaw\n");
@@ -1408,10 +2272,16 @@ keyboard (unsigned char key, int x, int y)
       fprintf (stderr, "m   - motion on/off\n");
       break;
     case 'm':
-      do_motion = false;
+      post_command (SIM_CMD_MOTION, 0, 0.0);
       break;
     case 'M':
-      do_motion = true;
+      post_command (SIM_CMD_MOTION, 0, 1.0);
+      break;
+    case 'j':
+      show_jacobian = !show_jacobian;
+      break;
+    case 't':
+      show_triangles = !show_triangles;
       break;
     case 'h':
     case 'H':
@@ -1430,6 +2300,7 @@ enum {
 static void
 main_menu (int item)
 {
+  request_redraw ();
   switch(item) {
   case MENU_RESET_CAMERA:
     location.setDistance (DEFAULT_LOCATION_DISTANCE);
@@ -1441,12 +2312,7 @@ main_menu (int item)
     location.setLatitude  (D2R (DEFAULT_CENTRE_PHI));
     break;
   case MENU_RESET_PLATFORM:
-    platform->rho   = 0.0;
-    platform->phi   = 0.0;
-    platform->theta = 0.0;
-    platform->delta_x = 0.0;
-    platform->delta_y = 0.0;
-    platform->delta_z = 0.0;
+    post_command (SIM_CMD_HOME);
     break;
   }
 }
@@ -1464,11 +2330,12 @@ sub_sub_menu (int item)
 }
 
 static void
-mouse_motion(int x, int y)
+do_mouse_motion (int x, int y)
 {
+  request_redraw ();
   if (mouse_state == GLUT_DOWN) {
-    double dx = ((double)(x - mouse_x)) / (double)width;
-    double dy = ((double)(mouse_y - y)) / (double)height;
+    double dx = ((double)(x - mouse_x)) / (double)window_width;
+    double dy = ((double)(mouse_y - y)) / (double)window_height;
     if ((mouse_mod & ~GLUT_ACTIVE_SHIFT) == GLUT_ACTIVE_CTRL) {
       if (mouse_mod & GLUT_ACTIVE_SHIFT) {
 	centre.x =  dx * 20.0;
@@ -1485,12 +2352,12 @@ mouse_motion(int x, int y)
     else {
       // move platform
       if (mouse_mod & GLUT_ACTIVE_SHIFT) {
-	platform->delta_z = dx * 20.0;
-	platform->delta_x = dy * 20.0;
+	post_command (SIM_CMD_SET, WS_AXIS_Z, dx * 20.0);
+	post_command (SIM_CMD_SET, WS_AXIS_X, dy * 20.0);
       }
       else {
-	platform->phi = D2R (dx * 80.0);
-	platform->rho = D2R (-dy * 80.0);
+	post_command (SIM_CMD_SET, WS_AXIS_YAW, D2R (dx * 80.0));
+	post_command (SIM_CMD_SET, WS_AXIS_ROLL, D2R (-dy * 80.0));
       }
     }
   }
@@ -1505,13 +2372,14 @@ mouse_passive_motion(int x, int y)
 #endif
 
 static void
-mouse_func (int button, int state, int x, int y)
+do_mouse_func (int button, int state, int x, int y, int mod)
 {
+  request_redraw ();
   // shift = 1 = GLUT_ACTIVE_SHIFT
   // ctrl  = 2 = GLUT_ACTIVE_ALT
   // alt   = 4 = GLUT_ACTIVE_CTRL
   
-  mouse_mod = glutGetModifiers ();
+  mouse_mod = mod;
 
   // 0 = left    = GLUT_LEFT_BUTTON
   // 1 = middle  = GLUT_MIDDLE_BUTTON
@@ -1556,21 +2424,320 @@ mouse_func (int button, int state, int x, int y)
     }
     else {
       if (mouse_mod & GLUT_ACTIVE_SHIFT) {
-	platform->delta_y += ((double)wheel_dir) * 0.08;
+	post_command (SIM_CMD_MOVE, WS_AXIS_Y, ((double)wheel_dir) * 0.08);
       }
       else {	// platform pitch
-	platform->theta += ((double)wheel_dir) * 0.08;
+	post_command (SIM_CMD_MOVE, WS_AXIS_PITCH,
+		      ((double)wheel_dir) * 0.08);
+      }
+    }
+  }
+}
+
+/***
+    The GLUT callbacks: log the event if --input-record is on, then act on
+    it.  Replay calls the do_ functions directly, with the logged
+    modifiers, so a replayed event is never logged again.
+ ***/
+
+static void
+window_reshape (int w, int h)
+{
+  il_record (&input_rec, IL_RESHAPE, 0, 0, 0, w, h);
+  reshape (w, h);
+}
+
+static void
+keyboard (unsigned char key, int x, int y)
+{
+  int mod = glutGetModifiers ();
+  il_record (&input_rec, IL_KEYBOARD, mod, 0, key, x, y);
+  do_keyboard (key, x, y, mod);
+}
+
+static void
+specialkeys (int key, int x, int y)
+{
+  int mod = glutGetModifiers ();
+  il_record (&input_rec, IL_SPECIAL, mod, 0, key, x, y);
+  do_specialkeys (key, x, y, mod);
+}
+
+static void
+mouse_func (int button, int state, int x, int y)
+{
+  int mod = glutGetModifiers ();
+  il_record (&input_rec, IL_MOUSE, mod, state, button, x, y);
+  do_mouse_func (button, state, x, y, mod);
+}
+
+static void
+mouse_motion (int x, int y)
+{
+  il_record (&input_rec, IL_MOTION, 0, 0, 0, x, y);
+  do_mouse_motion (x, y);
+}
+
+static bool
+is_quit (const il_event_s *ev)
+{
+  return ev->type == IL_KEYBOARD && (ev->code == 27 || ev->code == 'q');
+}
+
+/***
+    Mouse x, y go from the logged window, as last reshaped, into this one,
+    so drags move as far.  A logged reshape only changes that scale; the
+    window here keeps its own size.
+ ***/
+
+static void
+dispatch_input (const il_event_s *ev)
+{
+  int x = (int)((long)ev->x * window_width / replay_width);
+  int y = (int)((long)ev->y * window_height / replay_height);
+
+  switch (ev->type) {
+  case IL_KEYBOARD:
+    do_keyboard ((unsigned char)ev->code, x, y, ev->mod);
+    break;
+  case IL_SPECIAL:
+    do_specialkeys (ev->code, x, y, ev->mod);
+    break;
+  case IL_MOUSE:
+    do_mouse_func (ev->code, ev->state, x, y, ev->mod);
+    break;
+  case IL_MOTION:
+    do_mouse_motion (x, y);
+    break;
+  case IL_RESHAPE:
+    if (ev->x > 0 && ev->y > 0) {
+      replay_width = ev->x;
+      replay_height = ev->y;
+    }
+    break;
+  }
+}
+
+// from spin (), every event that is due by now
+static void
+replay_input ()
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  if (!replay_started) {
+    replay_start = now;
+    replay_started = true;
+  }
+  double t = (double)(now.tv_sec - replay_start.tv_sec) +
+    1.0e-9 * (double)(now.tv_nsec - replay_start.tv_nsec);
+  size_t n = input_log.events.size ();
+  while (input_log.next < n && input_log.t[input_log.next] <= t) {
+    const il_event_s *ev = &input_log.events[input_log.next++];
+    dispatch_input (ev);
+    if (input_log.next == n)
+      fprintf (stderr, "input replay done, %zu events\n", n);
+  }
+}
+
+/***
+    --headless replay: no window and no sim thread.  The simulation steps
+    at exactly 1 / sim_rate and each event goes in before the first step
+    at or after its time, so the same log and options give the same
+    motion every run; the digest over every step's servo angles says so.
+ ***/
+
+static int replay_headless ();
+
+/***
+    --headless --record: no window, no X display and no sim thread.  The
+    frames are drawn into an offscreen framebuffer (offscreen.h) of
+    --width by --height and piped to ffmpeg one after another as fast as
+    they render, each showing the motion exactly 1 / fps seconds on from
+    the one before, blended between the fixed steps either side as the
+    windowed display does.  With an --input-replay the logged events go
+    in at their times and the clip ends with the log, otherwise after
+    --frames frames.
+ ***/
+
+static int
+render_headless ()
+{
+  sim_clock_s clk;
+  sim_snapshot_s snap;
+  size_t n = input_replay_file ? input_log.events.size () : 0;
+  long frames = headless_frames;
+  if (frames <= 0) frames = input_replay_file ? -1 : DEFAULT_HEADLESS_FRAMES;
+
+  if (!offscreen_open (&offscreen, width, height)) {
+    feeder_stop (&feeder);
+    return 1;
+  }
+  monitor_pose = true;
+  set_h0 ();
+  update_alpha ();
+  if (!init_gl ()) {
+    // there is no glutInit () here for the glutSolid* fallbacks
+    fprintf (stderr, "--headless needs GL 3.3 instancing and a font\n");
+    feeder_stop (&feeder);
+    offscreen_close (&offscreen);
+    return 1;
+  }
+  reshape (width, height);
+
+  sim_clock_init (&clk, sim_rate);
+  // a frame's worth of motion is never lag, however low the frame rate
+  if (1.0 / fps > clk.max_lag) clk.max_lag = 1.0 / fps;
+  capture_frame (&snap.curr);
+  snap.prev = snap.curr;
+  snap.dt = clk.dt;
+  latest = &snap;
+
+  struct timespec start;
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  long frame;
+  signal_polled = 1;
+  for (frame = 0;
+       (frames < 0 || frame < frames) && !quit_signal && !feeder.failed;
+       frame++) {
+    double t = (double)frame / (double)fps;
+    if (input_replay_file) {
+      while (input_log.next < n && input_log.t[input_log.next] <= t) {
+	const il_event_s *ev = &input_log.events[input_log.next];
+	if (is_quit (ev)) {
+	  n = input_log.next;
+	  break;
+	}
+	dispatch_input (ev);
+	input_log.next++;
+      }
+      if (input_log.next >= n && frames < 0) break;
+    }
+
+    // poses set from the keyboard with the motion off show at once
+    if (!do_motion) capture_frame (&snap.curr);
+    int steps = (frame == 0) ? 0 : sim_clock_feed (&clk, 1.0 / fps);
+    for (int i = 0; i < steps && !sim_finished; i++) {
+      snap.prev = snap.curr;
+      sim_step (clk.dt);
+      capture_frame (&snap.curr);
+    }
+    if (!do_motion) snap.prev = snap.curr;
+    snap.steps = clk.steps;
+    snap.jacobian = jacobian;
+    snap.jacobian_usecs = jacobian_usecs;
+    snap.pose_held = pose_held;
+    blend_frames (&snap.prev, &snap.curr, sim_clock_blend (&clk), &view);
+
+    draw_scene ();
+    if (sim_finished) {
+      frame++;
+      break;
+    }
+  }
+  readback_flush (&readback, &feeder);
+  feeder_stop (&feeder);
+  double secs = elapsed (&start);
+
+  fprintf (stdout, "headless:  %ld frames %dx%d, %.3f sec of motion at "
+	   "%d fps\n", frame, width, height, (double)frame / fps, fps);
+  fprintf (stdout, "time:      %.3f sec, %.1f frames/sec\n", secs,
+	   secs > 0.0 ? (double)frame / secs : 0.0);
+  readback_report (&readback, stdout);
+  feeder_report (&feeder, stdout);
+  offscreen_close (&offscreen);
+  return feeder.failed ? 1 : 0;
+}
+
+static int
+replay_headless ()
+{
+  double dt = 1.0 / sim_rate;
+  uint64_t steps = 0, held = 0;
+  uint64_t digest = 0xcbf29ce484222325ULL;	// FNV-1a
+  size_t n = input_log.events.size ();
+  struct timespec start;
+
+  set_h0 ();
+  update_alpha ();
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  while (input_log.next < n && !sim_finished) {
+    while (input_log.next < n &&
+	   input_log.t[input_log.next] <= (double)steps * dt) {
+      const il_event_s *ev = &input_log.events[input_log.next];
+      if (is_quit (ev)) {
+	n = input_log.next;
+	break;
       }
+      dispatch_input (ev);
+      input_log.next++;
+    }
+    if (input_log.next >= n) break;
+    sim_step (dt);
+    steps++;
+    if (pose_held) held++;
+    for (int i = 0; i < IK_SERVOS; i++) {
+      const unsigned char *b = (const unsigned char *)&servos[i]->alpha;
+      for (size_t k = 0; k < sizeof(double); k++)
+	digest = (digest ^ b[k]) * 0x100000001b3ULL;
     }
   }
+  double secs = elapsed (&start);
+
+  fprintf (stdout, "replay:    %s, %zu of %zu events, %.3f sec at %g Hz\n",
+	   input_replay_file, input_log.next, input_log.events.size (),
+	   (double)steps * dt, sim_rate);
+  fprintf (stdout, "time:      %.3f sec, %llu steps, %.0f steps/sec, "
+	   "%llu held\n", secs, (unsigned long long)steps,
+	   secs > 0.0 ? (double)steps / secs : 0.0,
+	   (unsigned long long)held);
+  fprintf (stdout, "pose:      x %.4f y %.4f z %.4f roll %.4f pitch %.4f "
+	   "yaw %.4f\n", platform->delta_x, platform->delta_y,
+	   platform->delta_z, R2D (platform->rho), R2D (platform->theta),
+	   R2D (platform->phi));
+  fprintf (stdout, "digest:    %016llx\n", (unsigned long long)digest);
+  return 0;
 }
 
 int
 main(int argc, char **argv)
 {
   scadbase = strdup (DEFAULT_SCAD_BASE_NAME);
+  ws_spec_default (&workspace_spec);
+  tol_spec_default (&tolerance_spec);
+  opt_spec_default (&optimize_spec);
+  jitter_spec_default (&jitter_spec);
+  geometry_default (&geometry);
   {
 #define GET_HELP  1000
+#define BENCH_IK  1001
+#define WORKSPACE 1002
+#define WS_SPEC   1003
+#define THREADS   1004
+#define BENCH_FK  1005
+#define GEOMETRY  1006
+#define MAX_COND  1007
+#define TOLERANCE 1008
+#define OPTIMIZE  1009
+#define QUANTIZE  1010
+#define QUANT_STEP 1011
+#define SIM_RATE  1012
+#define JITTER    1013
+#define SCRIPT    1014
+#define SCRIPT_CHECK 1015
+#define COMPILE   1016
+#define COMPILE_OUT 1017
+#define COMPILE_RATE 1018
+#define FLEET     1019
+#define FLEET_TIME 1020
+#define INPUT_RECORD 1021
+#define INPUT_REPLAY 1022
+#define HEADLESS  1023
+#define FONT      1024
+#define CONTINUOUS 1025
+#define FRAMES    1026
+#define FPS       1027
+#define RECORD_POLICY 1028
+#define RECORD_QUEUE 1029
     static struct option long_options[] = {
       {"width",		required_argument, 0,  'w' },
       {"height",	required_argument, 0,  'h' },
@@ -1580,6 +2747,35 @@ main(int argc, char **argv)
       {"motion",	no_argument, 	   0,  'm' },
       {"scad",		optional_argument, 0,  's' },
       {"view",		no_argument,       0,  'v' },
+      {"geometry",	required_argument, 0,   GEOMETRY },
+      {"bench-ik",	optional_argument, 0,   BENCH_IK },
+      {"bench-fk",	optional_argument, 0,   BENCH_FK },
+      {"workspace",	optional_argument, 0,   WORKSPACE },
+      {"ws-spec",	required_argument, 0,   WS_SPEC },
+      {"threads",	required_argument, 0,   THREADS },
+      {"max-cond",	required_argument, 0,   MAX_COND },
+      {"tolerance",	optional_argument, 0,   TOLERANCE },
+      {"optimize",	optional_argument, 0,   OPTIMIZE },
+      {"quantize",	optional_argument, 0,   QUANTIZE },
+      {"quant-step",	required_argument, 0,   QUANT_STEP },
+      {"sim-rate",	required_argument, 0,   SIM_RATE },
+      {"jitter",	required_argument, 0,   JITTER },
+      {"script",	required_argument, 0,   SCRIPT },
+      {"script-check",	no_argument,       0,   SCRIPT_CHECK },
+      {"compile",	required_argument, 0,   COMPILE },
+      {"compile-out",	required_argument, 0,   COMPILE_OUT },
+      {"compile-rate",	required_argument, 0,   COMPILE_RATE },
+      {"fleet",		required_argument, 0,   FLEET },
+      {"fleet-time",	required_argument, 0,   FLEET_TIME },
+      {"input-record",	required_argument, 0,   INPUT_RECORD },
+      {"input-replay",	required_argument, 0,   INPUT_REPLAY },
+      {"headless",	no_argument,       0,   HEADLESS },
+      {"font",		required_argument, 0,   FONT },
+      {"continuous",	no_argument,       0,   CONTINUOUS },
+      {"frames",	required_argument, 0,   FRAMES },
+      {"fps",		required_argument, 0,   FPS },
+      {"record-policy",	required_argument, 0,   RECORD_POLICY },
+      {"record-queue",	required_argument, 0,   RECORD_QUEUE },
       {"help",		no_argument, 	   0,   GET_HELP },
       {0, 0, 0, 0 }
     };
@@ -1617,6 +2813,154 @@ main(int argc, char **argv)
       case 'v':
 	launch_os = true;
 	break;
+      case GEOMETRY:
+	if (geometry_file) free (geometry_file);
+	geometry_file = strdup (optarg);
+	if (!geometry_load (geometry_file, &geometry)) return 1;
+	geometry_mtime = file_mtime (geometry_file);
+	break;
+      case BENCH_IK:
+	bench_count = optarg ? atol (optarg) : DEFAULT_BENCH_COUNT;
+	break;
+      case BENCH_FK:
+	bench_fk_count = optarg ? atol (optarg) : DEFAULT_BENCH_COUNT;
+	break;
+      case WORKSPACE:
+	if (workspace_file) free (workspace_file);
+	workspace_file = strdup (optarg ?: DEFAULT_WORKSPACE_NAME);
+	break;
+      case WS_SPEC:
+	if (!ws_spec_parse (&workspace_spec, optarg)) {
+	  fprintf (stderr, "bad workspace spec: %s\n", optarg);
+	  return 1;
+	}
+	break;
+      case THREADS:
+	set_parallel_threads (atoi (optarg));
+	break;
+      case MAX_COND:
+	max_condition = atof (optarg);
+	break;
+      case TOLERANCE:
+	tolerance_run = true;
+	if (optarg && !tol_spec_parse (&tolerance_spec, optarg)) {
+	  fprintf (stderr, "bad tolerance spec: %s\n", optarg);
+	  return 1;
+	}
+	break;
+      case OPTIMIZE:
+	optimize_run = true;
+	if (optarg && !opt_spec_parse (&optimize_spec, optarg)) {
+	  fprintf (stderr, "bad optimize spec: %s\n", optarg);
+	  return 1;
+	}
+	break;
+      case QUANTIZE:
+	if (quantize_file) free (quantize_file);
+	quantize_file = strdup (optarg ?: DEFAULT_QUANTIZE_NAME);
+	break;
+      case JITTER:
+	if (!jitter_spec_parse (&jitter_spec, optarg, ",;")) {
+	  fprintf (stderr, "bad jitter spec: %s\n", optarg);
+	  return 1;
+	}
+	break;
+      case SCRIPT:
+	if (!script_load (optarg, &script)) return 1;
+	if (script_file) free (script_file);
+	script_file = strdup (optarg);
+	demo_mode = true;
+	do_motion = true;
+	break;
+      case SCRIPT_CHECK:
+	script_check_run = true;
+	break;
+      case COMPILE:
+	if (compile_file) free (compile_file);
+	compile_file = strdup (optarg);
+	break;
+      case COMPILE_OUT:
+	if (compile_out) free (compile_out);
+	compile_out = strdup (optarg);
+	break;
+      case COMPILE_RATE:
+	compile_rate = atoi (optarg);
+	if (compile_rate == 0) {
+	  fprintf (stderr, "bad compile rate: %s\n", optarg);
+	  return 1;
+	}
+	break;
+      case FLEET:
+	if (fleet_arg) free (fleet_arg);
+	fleet_arg = strdup (optarg);
+	break;
+      case FLEET_TIME:
+	fleet_time = atof (optarg);
+	if (fleet_time <= 0.0) {
+	  fprintf (stderr, "bad fleet time: %s\n", optarg);
+	  return 1;
+	}
+	break;
+      case INPUT_RECORD:
+	if (input_record_file) free (input_record_file);
+	input_record_file = strdup (optarg);
+	break;
+      case INPUT_REPLAY:
+	if (input_replay_file) free (input_replay_file);
+	input_replay_file = strdup (optarg);
+	break;
+      case HEADLESS:
+	headless = true;
+	break;
+      case FRAMES:
+	headless_frames = atol (optarg);
+	if (headless_frames <= 0) {
+	  fprintf (stderr, "bad frame count: %s\n", optarg);
+	  return 1;
+	}
+	break;
+      case FPS:
+	fps = atoi (optarg);
+	if (fps <= 0) {
+	  fprintf (stderr, "bad frame rate: %s\n", optarg);
+	  return 1;
+	}
+	break;
+      case RECORD_POLICY:
+	if (!feeder_policy_parse (optarg, &record_policy)) {
+	  fprintf (stderr, "bad record policy: %s\n", optarg);
+	  return 1;
+	}
+	record_policy_given = true;
+	break;
+      case RECORD_QUEUE:
+	record_queue = atoi (optarg);
+	if (record_queue < 2) {
+	  fprintf (stderr, "bad record queue: %s\n", optarg);
+	  return 1;
+	}
+	break;
+      case CONTINUOUS:
+	continuous = true;
+	break;
+      case FONT:
+	if (font_file) free (font_file);
+	font_file = strdup (optarg);
+	break;
+      case SIM_RATE:
+	sim_rate = atof (optarg);
+	if (sim_rate <= 0.0) {
+	  fprintf (stderr, "bad simulation rate: %s\n", optarg);
+	  return 1;
+	}
+	break;
+      case QUANT_STEP:
+	quant_step = atof (optarg);
+	if (quant_step <= 0.0) {
+	  fprintf (stderr, "bad servo step: %s\n", optarg);
+	  return 1;
+	}
+	break;
       case GET_HELP:
 	fprintf (stderr, "\t-w v\n");
 	fprintf (stderr, "\t--width=v\tset window width\n");
@@ -1636,6 +2980,97 @@ filename\n");
 	
 	fprintf (stderr, "\t-d\n");
 	fprintf (stderr, "\t--demo\tstart in demo mode\n");
+
+	fprintf (stderr, "\t--geometry=s\tload platform geometry from s, \
+reloaded when it changes\n");
+
+	fprintf (stderr, "\t--bench-ik=[n]\ttime n poses through \
+update_alpha and the batch kernels\n");
+
+	fprintf (stderr, "\t--bench-fk=[n]\ttime n warm-started forward \
+kinematics solves\n");
+
+	fprintf (stderr, "\t--workspace=[s]\tsweep the reachable workspace \
+into file s and exit\n");
+
+	fprintf (stderr, "\t--ws-spec=s\tworkspace sampling: grid,n or \
+halton,n or axis,min,max[,steps]\n");
+	fprintf (stderr, "\t\t\taxis is one of x y z roll pitch yaw\n");
+
+	fprintf (stderr, "\t--threads=n\tworker threads for batch modes\n");
+
+	fprintf (stderr, "\t--max-cond=v\trefuse poses whose Jacobian \
+condition number exceeds v\n");
+
+	fprintf (stderr, "\t--tolerance=[s]\tMonte Carlo build tolerance \
+analysis over the workspace box and exit\n");
+	fprintf (stderr, "\t\t\ts is key=value,... with keys base anchor \
+arm leg (cm)\n");
+	fprintf (stderr, "\t\t\thorn shaft (deg) trials poses seed, and \
+normal or uniform\n");
+
+	fprintf (stderr, "\t--optimize=[s]\tsearch for the geometry that \
+reaches most of the workspace box,\n");
+	fprintf (stderr, "\t\t\twrite it and its scad model and exit; s is \
+volume or dexterity\n");
+	fprintf (stderr, "\t\t\tand key=value,... with keys base platform \
+arm leg (lo:hi cm),\n");
+	fprintf (stderr, "\t\t\tspan gap (deg) population generations \
+samples seed out\n");
+
+	fprintf (stderr, "\t--quantize=[s]\tmap the pose error from \
+quantized servo angles over the\n");
+	fprintf (stderr, "\t\t\tworkspace into file s and exit\n");
+	fprintf (stderr, "\t--quant-step=d\tservo resolution in degrees, \
+default 1\n");
+	fprintf (stderr, "\t--sim-rate=n\tsimulation and IK steps per \
+second, default %g\n", DEFAULT_SIM_RATE);
+	fprintf (stderr, "\t--jitter=s\tdemo motion as hardware4's \
+key=value,... pdx .. pyaw jdx .. jyaw\n");
+	fprintf (stderr, "\t\t\t(cm, deg) onset relax interval (sec)\n");
+	fprintf (stderr, "\t--script=s\tplay the hardware4 motion script \
+in file s\n");
+	fprintf (stderr, "\t--script-check\trun the --script through the \
+IK at --sim-rate as fast as\n");
+	fprintf (stderr, "\t\t\tpossible, report unreachable ticks and \
+exit\n");
+	fprintf (stderr, "\t--compile=s\tcompile the keyframes or .csv \
+samples in s to a servo\n");
+	fprintf (stderr, "\t\t\tcommand stream and exit\n");
+	fprintf (stderr, "\t--compile-out=s\tcompiled stream file, default \
+%s\n", DEFAULT_COMPILE_NAME);
+	fprintf (stderr, "\t--compile-rate=n\tcompiled ticks per second, \
+default %d\n", MC_DEFAULT_RATE);
+	fprintf (stderr, "\t--fleet=s\tsimulate every platform in fleet \
+file s, or s copies of this\n");
+	fprintf (stderr, "\t\t\tone, on all cores and exit\n");
+	fprintf (stderr, "\t--fleet-time=v\tseconds of motion per fleet \
+platform, default %g\n", DEFAULT_FLEET_TIME);
+	fprintf (stderr, "\t--input-record=s\tlog keyboard and mouse \
+input with its timing to s\n");
+	fprintf (stderr, "\t--input-replay=s\tfeed the input logged in s \
+back at the same times\n");
+	fprintf (stderr, "\t--headless\tno window: replay the \
+--input-replay log on the fixed\n");
+	fprintf (stderr, "\t\t\tsimulation step as fast as possible and \
+exit; with --record,\n");
+	fprintf (stderr, "\t\t\trender the video offscreen instead\n");
+	fprintf (stderr, "\t--frames=n\tframes --headless --record \
+renders, default %d\n", DEFAULT_HEADLESS_FRAMES);
+	fprintf (stderr, "\t\t\tor to the end of the --input-replay\n");
+	fprintf (stderr, "\t--fps=n\t\tframe rate of the recording, \
+default %d\n", DEFAULT_FPS);
+	fprintf (stderr, "\t--record-policy=s\twhen ffmpeg falls behind: \
+block, drop or\n");
+	fprintf (stderr, "\t\t\tduplicate, default duplicate, block with \
+--headless\n");
+	fprintf (stderr, "\t--record-queue=n\tframes queued for ffmpeg, \
+default %d\n", FEEDER_DEFAULT_DEPTH);
+	fprintf (stderr, "\t--font=s\tTrueType font for the readouts, \
+default\n");
+	fprintf (stderr, "\t\t\t%s\n", DEFAULT_FONT);
+	fprintf (stderr, "\t--continuous\tredraw on every idle callback, \
+not only on change\n");
 	
 	return 1;
 	break;
@@ -1643,13 +3078,29 @@ filename\n");
     }
   }
 
-  signal (SIGINT,  enditall);
-  signal (SIGHUP,  enditall);
-  signal (SIGKILL, enditall);
-  signal (SIGQUIT, enditall);
-  signal (SIGSTOP, enditall);
-  signal (SIGTERM, enditall);
+  signal (SIGINT,  on_signal);
+  signal (SIGHUP,  on_signal);
+  signal (SIGKILL, on_signal);
+  signal (SIGQUIT, on_signal);
+  signal (SIGSTOP, on_signal);
+  signal (SIGTERM, on_signal);
   srand48 (time (NULL));
+  motion_seed = (uint64_t)time (NULL);
+  window_width = width;			// until reshape () says otherwise
+  window_height = height;
+  if (input_replay_file) {
+    if (!il_load (input_replay_file, &input_log)) return 1;
+    motion_seed = input_log.header.seed;
+    replay_width = input_log.header.width;
+    replay_height = input_log.header.height;
+    if (replay_width <= 0 || replay_height <= 0) {
+      fprintf (stderr, "%s: bad window size %dx%d\n", input_replay_file,
+	       replay_width, replay_height);
+      return 1;
+    }
+  }
+  if (script_file) motion_script (&motion, &script);
+  else motion_jitter (&motion, &jitter_spec, motion_seed);
 
   // https://computergraphics.stackexchange.com/questions/5606/opengl-animation-turn-into-mp4-movie
 
@@ -1658,33 +3109,36 @@ filename\n");
     "-threads 0 -preset fast -y -pix_fmt yuv420p -crf 21 -vf vflip output.mp4";
 #endif
 
-#define FFMPEF_CMD "ffmpeg -r 60 -f rawvideo -pix_fmt rgba -s %dx%d -i - \
-    -threads 0 -preset fast -y -pix_fmt yuv420p -crf 21 -vf vflip %s"
+// the feeder sends I420 the right way up (yuv.h)
+#define FFMPEF_CMD "ffmpeg -r %d -f rawvideo -pix_fmt yuv420p -s %dx%d -i - \
+    -threads 0 -preset fast -y -pix_fmt yuv420p -crf 21 %s"
 
   if (filename) {
     char* ffmpeg_cmd;
-    asprintf (&ffmpeg_cmd,  FFMPEF_CMD, width, height, filename);
+    if ((width & 1) || (height & 1)) {
+      fprintf (stderr, "recording needs an even width and height\n");
+      return 1;
+    }
+    asprintf (&ffmpeg_cmd,  FFMPEF_CMD, fps, width, height, filename);
 
+    // if ffmpeg dies the feeder sees EPIPE and stops, the rest carries on
+    signal (SIGPIPE, SIG_IGN);
     ffmpeg = popen2 (ffmpeg_cmd, "w", &ffmpeg_pid);
     if (errno != 0)
       perror ("Opening mpeg");
     free (ffmpeg_cmd);
+    readback_init (&readback, width, height);
+    if (headless && !record_policy_given) record_policy = FEEDER_BLOCK;
+    if (ffmpeg)
+      feeder_start (&feeder, ffmpeg, width, height, record_queue,
+		    record_policy);
   }
 
  
   platform = new _platform ();
-  platform->set_anchor (platform_radius * cos (P0_ANGLE),
-			platform_radius * sin (P0_ANGLE));
-  platform->set_anchor (platform_radius * cos (P1_ANGLE),
-			platform_radius * sin (P1_ANGLE));
-  platform->set_anchor (platform_radius * cos (P2_ANGLE),
-			platform_radius * sin (P2_ANGLE));
-  platform->set_anchor (platform_radius * cos (P3_ANGLE),
-			platform_radius * sin (P3_ANGLE));
-  platform->set_anchor (platform_radius * cos (P4_ANGLE),
-			platform_radius * sin (P4_ANGLE));
-  platform->set_anchor (platform_radius * cos (P5_ANGLE),
-			platform_radius * sin (P5_ANGLE));
+  for (int i = 0; i < GEOMETRY_SERVOS; i++)
+    platform->set_anchor (platform_radius * cos (geometry.platform_angle[i]),
+			  platform_radius * sin (geometry.platform_angle[i]));
 #if 0
   {
     double srad = 0.0;
@@ -1701,24 +3155,16 @@ filename\n");
 #endif
 
 #define M_270 (3.0 * M_PI_2)
-  servos.push_back (new servo (base_radius * cos (B0_ANGLE),
-			       base_radius * sin (B0_ANGLE),
-			       SA0, M_PI_2, B0_AI, 25.0));
-  servos.push_back (new servo (base_radius * cos (B1_ANGLE),
-			       base_radius * sin (B1_ANGLE),
-			       SA1, M_PI_2, B1_AI, -25.0));
-  servos.push_back (new servo (base_radius * cos (B2_ANGLE),
-			       base_radius * sin (B2_ANGLE),
-			       SA2, M_PI_2, B2_AI, 25.0));
-  servos.push_back (new servo (base_radius * cos (B3_ANGLE),
-			       base_radius * sin (B3_ANGLE),
-			       SA3, M_PI_2, B3_AI, -25.0));
-  servos.push_back (new servo (base_radius * cos (B4_ANGLE),
-			       base_radius * sin (B4_ANGLE),
-			       SA4, M_PI_2, B4_AI, 25.0));
-  servos.push_back (new servo (base_radius * cos (B5_ANGLE),
-			       base_radius * sin (B5_ANGLE),
-			       SA5, M_PI_2, B5_AI, -25.0));
+  {
+    static const double incr[GEOMETRY_SERVOS] =
+      { B0_AI, B1_AI, B2_AI, B3_AI, B4_AI, B5_AI };
+    for (int i = 0; i < GEOMETRY_SERVOS; i++)
+      servos.push_back (new servo (base_radius * cos (geometry.base_angle[i]),
+				   base_radius * sin (geometry.base_angle[i]),
+				   geometry.shaft_angle[i], M_PI_2, incr[i],
+				   (i & 1) ? -25.0 : 25.0));
+  }
+  apply_geometry ();
 #if 0
   for (int i = 0; i < servos.size (); i++) {
     fprintf (stderr, "\n%d %g %g rad %g ang %g\n",
@@ -1727,16 +3173,110 @@ filename\n");
 	     atan2 (servos[i]->pos.y, servos[i]->pos.x));
   }
 #endif
+
+  if (bench_count > 0) {
+    set_h0 ();
+    bench_ik (bench_count);
+    return 0;
+  }
+
+  if (bench_fk_count > 0) {
+    set_h0 ();
+    bench_fk (bench_fk_count);
+    return 0;
+  }
+
+  if (workspace_file) {
+    ik_geometry_s geo;
+    set_h0 ();
+    fill_ik_geometry (&geo);
+    return (ws_sweep (&geo, &workspace_spec, workspace_file) == 0) ? 0 : 1;
+  }
+
+  if (tolerance_run) {
+    ik_geometry_s geo;
+    set_h0 ();
+    fill_ik_geometry (&geo);
+    return (tol_run (&geo, &workspace_spec, &tolerance_spec) == 0) ? 0 : 1;
+  }
+
+  if (script_check_run) {
+    ik_geometry_s geo;
+    if (!script_file) {
+      fprintf (stderr, "--script-check needs a --script\n");
+      return 1;
+    }
+    set_h0 ();
+    fill_ik_geometry (&geo);
+    return (script_check (&geo, &script, sim_rate, script_file) == 0) ? 0 : 1;
+  }
+
+  if (fleet_arg) {
+    ik_geometry_s geo;
+    fleet_s fleet;
+    set_h0 ();
+    fill_ik_geometry (&geo);
+    if (!fleet_load (fleet_arg, &geo, &jitter_spec, &fleet)) return 1;
+    int rc = fleet_run (&fleet, sim_rate, fleet_time);
+    fleet_free (&fleet);
+    return (rc == 0) ? 0 : 1;
+  }
+
+  if (compile_file) {
+    ik_geometry_s geo;
+    set_h0 ();
+    fill_ik_geometry (&geo);
+    return (mc_compile (&geo, compile_file,
+			compile_out ?: DEFAULT_COMPILE_NAME,
+			compile_rate) == 0) ? 0 : 1;
+  }
+
+  if (quantize_file) {
+    ik_geometry_s geo;
+    set_h0 ();
+    fill_ik_geometry (&geo);
+    return (qf_sweep (&geo, &workspace_spec, quant_step,
+		      quantize_file) == 0) ? 0 : 1;
+  }
+
+  if (optimize_run) {
+    if (opt_run (&geometry, &workspace_spec, &optimize_spec) != 0) return 1;
+    apply_geometry ();
+    dump_scad ();
+    fprintf (stdout, "scad model in %s.scad\n", scadbase);
+    return 0;
+  }
+
+  if (headless) {
+    if (ffmpeg) {
+      int rc = render_headless ();
+      pclose2 (ffmpeg, ffmpeg_pid);	// enditall () would want glut
+      ffmpeg = NULL;
+      return rc;
+    }
+    if (!input_replay_file) {
+      fprintf (stderr, "--headless needs an --input-replay or a --record\n");
+      return 1;
+    }
+    return replay_headless ();
+  }
+
+  monitor_pose = true;
   
   glutInit(&argc, argv);
 
   glutInitDisplayMode (GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
   glutInitWindowSize (width, height);
   glutCreateWindow ("Stewart");
+  {
+    GLenum err = glewInit ();
+    if (err != GLEW_OK)
+      fprintf (stderr, "glew: %s\n", glewGetErrorString (err));
+  }
 
   init ();
   glutDisplayFunc (display);
-  glutReshapeFunc (reshape);
+  glutReshapeFunc (window_reshape);
   glutKeyboardFunc (keyboard);
   glutSpecialFunc (specialkeys);
   glutIdleFunc (spin);
@@ -1784,6 +3324,11 @@ filename\n");
 	      << set_color() << std::endl;
   }
   
+  if (input_record_file &&
+      !il_record_open (&input_rec, input_record_file, width, height,
+		       motion_seed))
+    return 1;
+  signal_polled = 1;
   glutMainLoop ();
 
   return 0;
@@ -0,0 +1,226 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <GL/glew.h>
+
+#include "text.h"
+
+#define ATLAS_WIDTH	256		// glyphs are packed in rows across this
+
+bool
+text_init (text_font_s *font, const char *path, int pixels)
+{
+  FT_Library ft;
+  FT_Face face;
+
+  memset (font, 0, sizeof(*font));
+  if (FT_Init_FreeType (&ft)) {
+    fprintf (stderr, "text: no FreeType\n");
+    return false;
+  }
+  if (FT_New_Face (ft, path, 0, &face)) {
+    fprintf (stderr, "text: cannot load font %s\n", path);
+    FT_Done_FreeType (ft);
+    return false;
+  }
+  FT_Set_Pixel_Sizes (face, 0, pixels);
+  font->line = (int)(face->size->metrics.height >> 6);
+
+  // render every glyph, then pack them into rows
+  std::vector<unsigned char> bits[TEXT_LAST - TEXT_FIRST + 1];
+  int x = 1, y = 1, row = 0;
+  for (int c = TEXT_FIRST; c <= TEXT_LAST; c++) {
+    text_glyph_s *g = &font->glyph[c - TEXT_FIRST];
+    if (FT_Load_Char (face, c, FT_LOAD_RENDER)) continue;
+    FT_GlyphSlot slot = face->glyph;
+    g->left    = slot->bitmap_left;
+    g->top     = slot->bitmap_top;
+    g->width   = slot->bitmap.width;
+    g->rows    = slot->bitmap.rows;
+    g->advance = (int)(slot->advance.x >> 6);
+    for (int r = 0; r < g->rows; r++) {
+      const unsigned char *src = slot->bitmap.buffer + r * slot->bitmap.pitch;
+      bits[c - TEXT_FIRST].insert (bits[c - TEXT_FIRST].end (), src,
+				   src + g->width);
+    }
+    if (x + g->width + 1 > ATLAS_WIDTH) {
+      x = 1;
+      y += row + 1;
+      row = 0;
+    }
+    // pixel positions for now, texture coordinates once the height is known
+    g->u0 = x;
+    g->v0 = y;
+    x += g->width + 1;
+    if (g->rows > row) row = g->rows;
+  }
+  FT_Done_Face (face);
+  FT_Done_FreeType (ft);
+
+  int height = 1;
+  while (height < y + row + 1) height *= 2;
+  std::vector<unsigned char> atlas (ATLAS_WIDTH * height, 0);
+  for (int c = TEXT_FIRST; c <= TEXT_LAST; c++) {
+    text_glyph_s *g = &font->glyph[c - TEXT_FIRST];
+    int gx = (int)g->u0, gy = (int)g->v0;
+    for (int r = 0; r < g->rows; r++)
+      memcpy (&atlas[(gy + r) * ATLAS_WIDTH + gx],
+	      &bits[c - TEXT_FIRST][r * g->width], g->width);
+    g->u0 = (float)gx / (float)ATLAS_WIDTH;
+    g->v0 = (float)gy / (float)height;
+    g->u1 = (float)(gx + g->width) / (float)ATLAS_WIDTH;
+    g->v1 = (float)(gy + g->rows) / (float)height;
+  }
+
+  glGenTextures (1, &font->texture);
+  glBindTexture (GL_TEXTURE_2D, font->texture);
+  glPixelStorei (GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D (GL_TEXTURE_2D, 0, GL_ALPHA, ATLAS_WIDTH, height, 0,
+		GL_ALPHA, GL_UNSIGNED_BYTE, atlas.data ());
+  glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
+  // quads land on whole pixels, so texels map one to one
+  glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture (GL_TEXTURE_2D, 0);
+  return true;
+}
+
+void
+text_clear (text_layout_s *layout)
+{
+  layout->vert.clear ();
+  layout->changed = true;
+}
+
+static void
+corner (text_layout_s *layout, float x, float y, float u, float v,
+	const GLubyte *rgba)
+{
+  text_vertex_s vert = { x, y, u, v, { rgba[0], rgba[1], rgba[2], rgba[3] } };
+  layout->vert.push_back (vert);
+}
+
+void
+text_add (text_layout_s *layout, const text_font_s *font,
+	  float x, float y, int width, int height, const char *string,
+	  const float *rgb)
+{
+  GLubyte rgba[4] = { (GLubyte)(rgb[0] * 255.0f + 0.5f),
+		      (GLubyte)(rgb[1] * 255.0f + 0.5f),
+		      (GLubyte)(rgb[2] * 255.0f + 0.5f), 255 };
+  int left = (int)((x + 1.0f) * 0.5f * (float)width);
+  int pen_x = left;
+  int pen_y = (int)((y + 1.0f) * 0.5f * (float)height);
+  int tab = TEXT_TAB * font->glyph[' ' - TEXT_FIRST].advance;
+
+  layout->changed = true;
+  for (const char *c = string; *c; c++) {
+    if (*c == '\n') {
+      pen_x = left;
+      pen_y -= font->line;
+      continue;
+    }
+    if (*c == '\t') {
+      if (tab > 0) pen_x = left + ((pen_x - left) / tab + 1) * tab;
+      continue;
+    }
+    if (*c < TEXT_FIRST || *c > TEXT_LAST) continue;
+    const text_glyph_s *g = &font->glyph[*c - TEXT_FIRST];
+    if (g->width > 0 && g->rows > 0) {
+      float x0 = (float)(pen_x + g->left), x1 = x0 + (float)g->width;
+      float y1 = (float)(pen_y + g->top),  y0 = y1 - (float)g->rows;
+      // the atlas rows run down the glyph, window y runs up
+      corner (layout, x0, y1, g->u0, g->v0, rgba);
+      corner (layout, x0, y0, g->u0, g->v1, rgba);
+      corner (layout, x1, y0, g->u1, g->v1, rgba);
+      corner (layout, x0, y1, g->u0, g->v0, rgba);
+      corner (layout, x1, y0, g->u1, g->v1, rgba);
+      corner (layout, x1, y1, g->u1, g->v0, rgba);
+    }
+    pen_x += g->advance;
+  }
+}
+
+void
+text_draw (const text_font_s *font, text_layout_s *layout,
+	   int width, int height)
+{
+  if (!font->texture || layout->vert.empty ()) return;
+
+  if (!layout->vbo) glGenBuffers (1, &layout->vbo);
+  glBindBuffer (GL_ARRAY_BUFFER, layout->vbo);
+  if (layout->changed) {
+    GLsizeiptr bytes = layout->vert.size () * sizeof(text_vertex_s);
+    if (bytes > layout->size) {
+      glBufferData (GL_ARRAY_BUFFER, bytes, layout->vert.data (),
+		    GL_DYNAMIC_DRAW);
+      layout->size = bytes;
+    }
+    else
+      glBufferSubData (GL_ARRAY_BUFFER, 0, bytes, layout->vert.data ());
+    layout->changed = false;
+  }
+
+  glPushAttrib (GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT |
+		GL_CURRENT_BIT);
+  glPushClientAttrib (GL_CLIENT_VERTEX_ARRAY_BIT);
+  glMatrixMode (GL_PROJECTION);
+  glPushMatrix ();
+  glLoadIdentity ();
+  glOrtho (0.0, (double)width, 0.0, (double)height, -1.0, 1.0);
+  glMatrixMode (GL_MODELVIEW);
+  glPushMatrix ();
+  glLoadIdentity ();
+
+  glDisable (GL_LIGHTING);
+  glDisable (GL_DEPTH_TEST);
+  glEnable (GL_TEXTURE_2D);
+  glEnable (GL_BLEND);
+  glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glBindTexture (GL_TEXTURE_2D, font->texture);
+  glTexEnvi (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+  glEnableClientState (GL_VERTEX_ARRAY);
+  glEnableClientState (GL_TEXTURE_COORD_ARRAY);
+  glEnableClientState (GL_COLOR_ARRAY);
+  glVertexPointer (2, GL_FLOAT, sizeof(text_vertex_s),
+		   (const void *)offsetof (text_vertex_s, x));
+  glTexCoordPointer (2, GL_FLOAT, sizeof(text_vertex_s),
+		     (const void *)offsetof (text_vertex_s, u));
+  glColorPointer (4, GL_UNSIGNED_BYTE, sizeof(text_vertex_s),
+		  (const void *)offsetof (text_vertex_s, rgba));
+  glDrawArrays (GL_TRIANGLES, 0, (GLsizei)layout->vert.size ());
+
+  glBindBuffer (GL_ARRAY_BUFFER, 0);
+  glPopMatrix ();
+  glMatrixMode (GL_PROJECTION);
+  glPopMatrix ();
+  glMatrixMode (GL_MODELVIEW);
+  glPopClientAttrib ();
+  glPopAttrib ();
+}
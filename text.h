@@ -0,0 +1,86 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+
+#ifndef TEXT_H
+#define TEXT_H
+
+#include <vector>
+
+#include <GL/glew.h>
+
+/***
+
+    HUD text from a glyph atlas.  text_init () has FreeType render the
+    printable ASCII glyphs of a font once into a single alpha texture.
+    text_add () lays a string out into a list of textured quads, and
+    text_draw () uploads the list to a buffer object the first time it is
+    drawn after a change and puts every string of the layout on screen
+    with one draw call.  The caller decides when the layout is stale;
+    between changes a frame's text costs one glDrawArrays.
+
+    Positions are the normalised device coordinates glRasterPos took at
+    identity matrices, at the baseline of the first line.  '\n' starts a
+    new line below the first, '\t' moves to the next TEXT_TAB spaces.
+
+ ***/
+
+#define TEXT_FIRST	32		// ' '
+#define TEXT_LAST	126		// '~'
+#define TEXT_TAB	4
+
+typedef struct {
+  int   left, top;		// bitmap offset from the pen, pixels
+  int   width, rows;
+  int   advance;
+  float u0, v0, u1, v1;		// in the atlas
+} text_glyph_s;
+
+typedef struct {
+  GLuint       texture;		// 0 if there is no font
+  int          line;		// baseline to baseline, pixels
+  text_glyph_s glyph[TEXT_LAST - TEXT_FIRST + 1];
+} text_font_s;
+
+typedef struct {
+  GLfloat x, y;			// window pixels
+  GLfloat u, v;
+  GLubyte rgba[4];
+} text_vertex_s;
+
+typedef struct {
+  std::vector<text_vertex_s> vert;
+  GLuint                     vbo;	// 0 until first draw
+  GLsizeiptr                 size;	// of vbo, bytes
+  bool                       changed;	// vert not yet in vbo
+} text_layout_s;
+
+// once there is a GL context; false, and no texture, if the font will not load
+bool text_init (text_font_s *font, const char *path, int pixels);
+
+void text_clear (text_layout_s *layout);
+
+// width and height are the window's
+void text_add (text_layout_s *layout, const text_font_s *font,
+	       float x, float y, int width, int height, const char *string,
+	       const float *rgb);
+
+void text_draw (const text_font_s *font, text_layout_s *layout,
+		int width, int height);
+
+#endif // TEXT_H
@@ -0,0 +1,375 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+#include "tolerance.h"
+#include "fk.h"
+#include "parallel.h"
+#include "rng.h"
+
+#define TOL_CHUNK	4		// trials per work item
+#define TOL_BINS	65536
+#define TOL_LOG_MIN	(-8.0)		// log10 of the first bin's top
+#define TOL_LOG_MAX	4.0		// and of the last one's bottom
+#define D2R(d)		((d) * M_PI / 180.0)
+
+void
+tol_spec_default (tol_spec_s *spec)
+{
+  spec->dist   = TOL_NORMAL;
+  spec->base   = 0.1;		// a millimetre
+  spec->anchor = 0.1;
+  spec->arm    = 0.02;
+  spec->leg    = 0.05;
+  spec->horn   = 1.0;
+  spec->shaft  = 0.5;
+  spec->trials = 1000;
+  spec->poses  = 10000;
+  spec->seed   = 1;
+}
+
+bool
+tol_spec_parse (tol_spec_s *spec, const char *arg)
+{
+  static const struct {
+    const char *key;
+    double tol_spec_s::*field;
+  } keys[] = {
+    { "base",   &tol_spec_s::base },
+    { "anchor", &tol_spec_s::anchor },
+    { "arm",    &tol_spec_s::arm },
+    { "leg",    &tol_spec_s::leg },
+    { "horn",   &tol_spec_s::horn },
+    { "shaft",  &tol_spec_s::shaft },
+  };
+  tol_spec_s lcl = *spec;
+  char *copy = strdup (arg);
+  bool ok = true;
+
+  for (char *tok = strtok (copy, ","); ok && tok; tok = strtok (NULL, ",")) {
+    char *eq = strchr (tok, '=');
+    if (!eq) {
+      if (!strcmp (tok, "normal"))       lcl.dist = TOL_NORMAL;
+      else if (!strcmp (tok, "uniform")) lcl.dist = TOL_UNIFORM;
+      else ok = false;
+      continue;
+    }
+    *eq++ = 0;
+    char *end;
+    if (!strcmp (tok, "trials") || !strcmp (tok, "poses") ||
+	!strcmp (tok, "seed")) {
+      unsigned long long n = strtoull (eq, &end, 0);
+      if (end == eq || *end) ok = false;
+      else if (!strcmp (tok, "trials")) lcl.trials = n;
+      else if (!strcmp (tok, "poses"))  lcl.poses = n;
+      else lcl.seed = n;
+      continue;
+    }
+    int k;
+    for (k = 0; k < (int)(sizeof(keys) / sizeof(keys[0])); k++)
+      if (!strcmp (tok, keys[k].key)) break;
+    if (k == (int)(sizeof(keys) / sizeof(keys[0]))) ok = false;
+    else {
+      double v = strtod (eq, &end);
+      if (end == eq || *end || v < 0.0) ok = false;
+      else lcl.*keys[k].field = v;
+    }
+  }
+  free (copy);
+
+  if (ok && (lcl.trials == 0 || lcl.poses == 0)) ok = false;
+  if (ok) *spec = lcl;
+  return ok;
+}
+
+static double
+draw (rng_s *r, tol_dist_e dist, double tol)
+{
+  if (tol == 0.0) return 0.0;
+  return (dist == TOL_NORMAL) ? tol * rng_normal (r)
+    : tol * (2.0 * rng_uniform (r) - 1.0);
+}
+
+/***
+    One as-built platform.  The pose frame, h0, stays the nominal one: the
+    controller commands poses relative to where it thinks neutral is.
+ ***/
+
+static void
+perturb (const ik_geometry_s *nominal, const tol_spec_s *spec, uint64_t trial,
+	 ik_geometry_s *geo, double *horn)
+{
+  rng_s r;
+  rng_seed (&r, spec->seed, trial);
+
+  *geo = *nominal;
+  for (int i = 0; i < IK_SERVOS; i++) {
+    geo->base_x[i]   += draw (&r, spec->dist, spec->base);
+    geo->base_z[i]   += draw (&r, spec->dist, spec->base);
+    geo->anchor_x[i] += draw (&r, spec->dist, spec->anchor);
+    geo->anchor_z[i] += draw (&r, spec->dist, spec->anchor);
+  }
+  geo->arm_length += draw (&r, spec->dist, spec->arm);
+  geo->leg_length += draw (&r, spec->dist, spec->leg);
+  ik_geometry_prepare (geo);
+  for (int i = 0; i < IK_SERVOS; i++) {
+    double beta = ((i & 1) ? (M_PI / 6.0) : (-M_PI / 6.0)) +
+      D2R (draw (&r, spec->dist, spec->shaft));
+    geo->cos_beta[i] = cos (beta);
+    geo->sin_beta[i] = sin (beta);
+    horn[i] = D2R (draw (&r, spec->dist, spec->horn));
+  }
+}
+
+/***
+    Errors go into fixed, logarithmically spaced bins, so memory does not
+    grow with trials x poses and every magnitude from 1e-8 to 1e4 gets the
+    same relative resolution, about 0.04%, whether cm or radians.  The
+    first and last bins take everything beyond.  Mean and max are kept
+    exactly; percentiles are read to the bin.
+ ***/
+
+#define TOL_PER_DECADE	((double)(TOL_BINS - 2) / (TOL_LOG_MAX - TOL_LOG_MIN))
+
+typedef struct {
+  uint64_t              count;
+  double                sum;
+  double                max;
+  std::vector<uint64_t> bins;
+} tol_hist_s;
+
+static void
+hist_init (tol_hist_s *h)
+{
+  h->count = 0;
+  h->sum = 0.0;
+  h->max = 0.0;
+  h->bins.assign (TOL_BINS, 0);
+}
+
+static void
+hist_add (tol_hist_s *h, double v)
+{
+  double c = 0.0;
+  if (v > 0.0)
+    c = fmax (0.0, ceil ((log10 (v) - TOL_LOG_MIN) * TOL_PER_DECADE));
+  h->bins[(c >= (double)(TOL_BINS - 1)) ? TOL_BINS - 1 : (int)c]++;
+  h->count++;
+  h->sum += v;
+  if (v > h->max) h->max = v;
+}
+
+static void
+hist_merge (tol_hist_s *into, const tol_hist_s *from)
+{
+  for (int c = 0; c < TOL_BINS; c++) into->bins[c] += from->bins[c];
+  into->count += from->count;
+  into->sum += from->sum;
+  if (from->max > into->max) into->max = from->max;
+}
+
+// the top of the smallest bin with at least frac of the count at or below it
+static double
+hist_percentile (const tol_hist_s *h, double frac)
+{
+  uint64_t want = (uint64_t)ceil (frac * (double)h->count);
+  uint64_t seen = 0;
+  for (int c = 0; c < TOL_BINS - 1; c++) {
+    seen += h->bins[c];
+    if (seen >= want && seen > 0)
+      return fmin (pow (10.0, TOL_LOG_MIN + c / TOL_PER_DECADE), h->max);
+  }
+  return h->max;
+}
+
+typedef struct {
+  uint64_t   failures;
+  double     worst;		// position error, cm
+  uint64_t   worst_trial;
+  size_t     worst_pose;
+  tol_hist_s lin, ang;		// every evaluation that assembled
+  tol_hist_s trial_lin, trial_ang;	// each trial's worst
+} tol_accum_s;
+
+static void
+percentiles (const char *what, const tol_hist_s *h)
+{
+  if (h->count == 0) return;
+  fprintf (stdout, "%-22s %10.4g %10.4g %10.4g %10.4g %10.4g\n", what,
+	   h->sum / (double)h->count, hist_percentile (h, 0.5),
+	   hist_percentile (h, 0.9), hist_percentile (h, 0.99), h->max);
+}
+
+int
+tol_run (const ik_geometry_s *geo, const ws_spec_s *box,
+	 const tol_spec_s *spec)
+{
+  struct timespec start, end;
+  clock_gettime (CLOCK_MONOTONIC, &start);
+
+  // the commanded poses, and the nominal servo angles for them
+  ws_spec_s halton = *box;
+  halton.mode = WS_HALTON;
+  halton.samples = spec->poses;
+  std::vector<ik_pose_s> all (spec->poses);
+  std::vector<double> all_alpha (spec->poses * IK_SERVOS);
+  std::vector<unsigned char> valid (spec->poses);
+  for (uint64_t i = 0; i < spec->poses; i++)
+    ws_sample_pose (&halton, i, &all[i]);
+  ik_batch (geo, all.data (), all_alpha.data (), valid.data (), spec->poses);
+
+  std::vector<ik_pose_s> poses;
+  std::vector<double> alphas;
+  for (uint64_t i = 0; i < spec->poses; i++) {
+    if (!valid[i]) continue;
+    poses.push_back (all[i]);
+    alphas.insert (alphas.end (), &all_alpha[i * IK_SERVOS],
+		   &all_alpha[(i + 1) * IK_SERVOS]);
+  }
+  size_t np = poses.size ();
+  if (np == 0) {
+    fprintf (stderr, "tolerance: no reachable poses in the workspace box\n");
+    return -1;
+  }
+
+  size_t evals = (size_t)spec->trials * np;
+  int nthreads = parallel_threads ();
+  std::vector<tol_accum_s> accum (nthreads);
+  for (int t = 0; t < nthreads; t++) {
+    accum[t].failures = 0;
+    accum[t].worst = -1.0;
+    hist_init (&accum[t].lin);
+    hist_init (&accum[t].ang);
+    hist_init (&accum[t].trial_lin);
+    hist_init (&accum[t].trial_ang);
+  }
+
+  parallel_for (spec->trials, TOL_CHUNK, [&](size_t begin, size_t end, int t) {
+      tol_accum_s *acc = &accum[t];
+      for (size_t trial = begin; trial < end; trial++) {
+	ik_geometry_s built;
+	double horn[IK_SERVOS];
+	perturb (geo, spec, trial, &built, horn);
+
+	double tl = 0.0, ta = 0.0;
+	for (size_t p = 0; p < np; p++) {
+	  double alpha[IK_SERVOS];
+	  for (int s = 0; s < IK_SERVOS; s++)
+	    alpha[s] = alphas[p * IK_SERVOS + s] + horn[s];
+	  ik_pose_s actual = poses[p];
+	  if (!fk_solve (&built, alpha, &actual, NULL)) {
+	    acc->failures++;
+	    continue;
+	  }
+	  const ik_pose_s *want = &poses[p];
+	  double dl = sqrt ((actual.delta_x - want->delta_x) *
+			    (actual.delta_x - want->delta_x) +
+			    (actual.delta_y - want->delta_y) *
+			    (actual.delta_y - want->delta_y) +
+			    (actual.delta_z - want->delta_z) *
+			    (actual.delta_z - want->delta_z));
+	  double da = fmax (fmax (fabs (actual.phi - want->phi),
+				  fabs (actual.theta - want->theta)),
+			    fabs (actual.rho - want->rho));
+	  hist_add (&acc->lin, dl);
+	  hist_add (&acc->ang, da);
+	  if (dl > tl) tl = dl;
+	  if (da > ta) ta = da;
+	  if (dl > acc->worst) {
+	    acc->worst = dl;
+	    acc->worst_trial = trial;
+	    acc->worst_pose = p;
+	  }
+	}
+	hist_add (&acc->trial_lin, tl);
+	hist_add (&acc->trial_ang, ta);
+      }
+    });
+
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  double secs = (double)(end.tv_sec - start.tv_sec) +
+    1.0e-9 * (double)(end.tv_nsec - start.tv_nsec);
+
+  uint64_t failures = accum[0].failures;
+  tol_accum_s *worst = &accum[0];
+  for (int t = 1; t < nthreads; t++) {
+    failures += accum[t].failures;
+    if (accum[t].worst > worst->worst) worst = &accum[t];
+    hist_merge (&accum[0].lin, &accum[t].lin);
+    hist_merge (&accum[0].ang, &accum[t].ang);
+    hist_merge (&accum[0].trial_lin, &accum[t].trial_lin);
+    hist_merge (&accum[0].trial_ang, &accum[t].trial_ang);
+  }
+
+  fprintf (stdout, "tolerance: %llu trials x %zu reachable poses "
+	   "(%llu sampled), %s, %d threads\n",
+	   (unsigned long long)spec->trials, np,
+	   (unsigned long long)spec->poses,
+	   (spec->dist == TOL_NORMAL) ? "normal, sigma" : "uniform, +-",
+	   nthreads);
+  fprintf (stdout, "           base %g cm  anchor %g cm  arm %g cm  "
+	   "leg %g cm  horn %g deg  shaft %g deg\n",
+	   spec->base, spec->anchor, spec->arm, spec->leg, spec->horn,
+	   spec->shaft);
+  fprintf (stdout, "time:      %.3f sec, %.0f evaluations/sec\n",
+	   secs, (double)evals / secs);
+  fprintf (stdout, "failures:  %llu (%.3f%%) could not assemble\n",
+	   (unsigned long long)failures,
+	   100.0 * (double)failures / (double)evals);
+  fprintf (stdout, "\n%-22s %10s %10s %10s %10s %10s\n", "error",
+	   "mean", "p50", "p90", "p99", "max");
+  percentiles ("position (cm)", &accum[0].lin);
+  percentiles ("angle (rad)", &accum[0].ang);
+  percentiles ("trial worst pos (cm)", &accum[0].trial_lin);
+  percentiles ("trial worst ang (rad)", &accum[0].trial_ang);
+
+  if (worst->worst >= 0.0) {
+    ik_geometry_s built;
+    double horn[IK_SERVOS];
+    const ik_pose_s *p = &poses[worst->worst_pose];
+    perturb (geo, spec, worst->worst_trial, &built, horn);
+    fprintf (stdout, "\nworst case: %.4g cm, trial %llu, pose "
+	     "x %.3g y %.3g z %.3g roll %.3g pitch %.3g yaw %.3g\n",
+	     worst->worst, (unsigned long long)worst->worst_trial,
+	     p->delta_x, p->delta_y, p->delta_z, p->rho, p->theta, p->phi);
+    fprintf (stdout, "%-6s %10s %10s %10s %10s %10s %10s\n", "servo",
+	     "base dx", "base dz", "anchor dx", "anchor dz", "shaft deg",
+	     "horn deg");
+    for (int s = 0; s < IK_SERVOS; s++) {
+      double dbeta = atan2 (built.sin_beta[s], built.cos_beta[s]) -
+	((s & 1) ? (M_PI / 6.0) : (-M_PI / 6.0));
+      fprintf (stdout, "%-6d %10.4g %10.4g %10.4g %10.4g %10.4g %10.4g\n", s,
+	       built.base_x[s] - geo->base_x[s],
+	       built.base_z[s] - geo->base_z[s],
+	       built.anchor_x[s] - geo->anchor_x[s],
+	       built.anchor_z[s] - geo->anchor_z[s],
+	       dbeta * 180.0 / M_PI, horn[s] * 180.0 / M_PI);
+    }
+    fprintf (stdout, "arm %+.4g cm, leg %+.4g cm\n",
+	     built.arm_length - geo->arm_length,
+	     built.leg_length - geo->leg_length);
+  }
+  return 0;
+}
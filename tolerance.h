@@ -0,0 +1,77 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef TOLERANCE_H
+#define TOLERANCE_H
+
+#include <stdint.h>
+
+#include "ikbatch.h"
+#include "workspace.h"
+
+/***
+
+    Monte Carlo manufacturing tolerance analysis.
+
+    The controller computes servo angles from the nominal geometry, but
+    the platform it drives was built with the servos, anchors and horns a
+    little off.  Each trial draws one such as-built platform; each sample
+    pose is run through the nominal IK, the trial's horn errors are added
+    to the angles, and forward kinematics on the as-built geometry says
+    where the platform really went.  The difference from the commanded
+    pose is the error.
+
+    Poses are Halton samples of the workspace box (--ws-spec) that the
+    nominal geometry can reach; the same set is used for every trial.
+    Trials run on all cores, each with its own generator seeded from the
+    trial number, so results do not depend on the thread count.
+
+ ***/
+
+typedef enum {
+  TOL_NORMAL,			// values are standard deviations
+  TOL_UNIFORM			// values are half-widths
+} tol_dist_e;
+
+typedef struct {
+  tol_dist_e dist;
+  double   base;		// cm, servo position, each of x and z
+  double   anchor;		// cm, platform anchor, each of x and z
+  double   arm;			// cm
+  double   leg;			// cm
+  double   horn;		// degrees, servo zero
+  double   shaft;		// degrees, servo shaft direction
+  uint64_t trials;
+  uint64_t poses;		// sampled, before the reachability cut
+  uint64_t seed;
+} tol_spec_s;
+
+void tol_spec_default (tol_spec_s *spec);
+
+/***
+    A comma separated list of key=value, keys as in tol_spec_s, plus the
+    bare words normal and uniform, e.g. "base=0.05,horn=2,uniform".
+ ***/
+
+bool tol_spec_parse (tol_spec_s *spec, const char *arg);
+
+// prints the report to stdout; returns 0, or -1 if nothing is reachable
+int  tol_run (const ik_geometry_s *geo, const ws_spec_s *box,
+	      const tol_spec_s *spec);
+
+#endif // TOLERANCE_H
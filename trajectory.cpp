@@ -0,0 +1,214 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trajectory.h"
+
+#define D2R(d)	((d) * M_PI / 180.0)
+
+void
+traj_clear (traj_s *traj)
+{
+  traj->seg.clear ();
+  traj->cursor = 0;
+}
+
+double
+traj_end (const traj_s *traj)
+{
+  if (traj->seg.empty ()) return 0.0;
+  const traj_segment_s *last = &traj->seg.back ();
+  return last->t0 + last->duration;
+}
+
+void
+traj_add (traj_s *traj, const traj_point_s *from, const traj_point_s *to,
+	  double duration)
+{
+  traj_segment_s s;
+  s.t0 = traj_end (traj);
+  s.duration = (duration > 0.0) ? duration : 0.0;
+  double T = s.duration;
+
+  for (int a = 0; a < WS_AXES; a++) {
+    double *c = s.c[a];
+    if (T == 0.0) {
+      c[0] = to->pos[a];
+      c[1] = c[2] = c[3] = c[4] = c[5] = 0.0;
+      continue;
+    }
+    double d  = to->pos[a] - from->pos[a];
+    double v0 = from->vel[a], v1 = to->vel[a];
+    double a0 = from->acc[a], a1 = to->acc[a];
+    double T2 = T * T, T3 = T2 * T;
+    c[0] = from->pos[a];
+    c[1] = v0;
+    c[2] = 0.5 * a0;
+    c[3] = (20.0 * d - (8.0 * v1 + 12.0 * v0) * T - (3.0 * a0 - a1) * T2) /
+      (2.0 * T3);
+    c[4] = (-30.0 * d + (14.0 * v1 + 16.0 * v0) * T +
+	    (3.0 * a0 - 2.0 * a1) * T2) / (2.0 * T3 * T);
+    c[5] = (12.0 * d - 6.0 * (v1 + v0) * T + (a1 - a0) * T2) /
+      (2.0 * T3 * T2);
+  }
+  traj->seg.push_back (s);
+}
+
+void
+traj_hold (traj_s *traj, const double *pos, double duration)
+{
+  traj_point_s p;
+  memset (&p, 0, sizeof(p));
+  memcpy (p.pos, pos, sizeof(p.pos));
+  traj_add (traj, &p, &p, duration);
+}
+
+bool
+traj_eval (traj_s *traj, double t, traj_point_s *out)
+{
+  return traj_eval_at (traj, &traj->cursor, t, out);
+}
+
+bool
+traj_eval_at (const traj_s *traj, size_t *cursor, double t,
+	      traj_point_s *out)
+{
+  size_t n = traj->seg.size ();
+  if (n == 0) return false;
+
+  // going backwards, or starting cold, is a binary search
+  if (*cursor >= n || t < traj->seg[*cursor].t0) {
+    size_t lo = 0, hi = n;
+    while (hi - lo > 1) {
+      size_t mid = (lo + hi) / 2;
+      if (traj->seg[mid].t0 <= t) lo = mid;
+      else hi = mid;
+    }
+    *cursor = lo;
+  }
+  while (*cursor + 1 < n && t >= traj->seg[*cursor + 1].t0) (*cursor)++;
+
+  const traj_segment_s *s = &traj->seg[*cursor];
+  double tau = t - s->t0;
+  bool inside = true;
+  if (tau < 0.0) {
+    tau = 0.0;
+    inside = false;
+  }
+  if (tau > s->duration) {
+    tau = s->duration;
+    inside = false;
+  }
+
+  for (int a = 0; a < WS_AXES; a++) {
+    const double *c = s->c[a];
+    out->pos[a] = c[0] + tau * (c[1] + tau * (c[2] + tau * (c[3] +
+		  tau * (c[4] + tau * c[5]))));
+    out->vel[a] = c[1] + tau * (2.0 * c[2] + tau * (3.0 * c[3] +
+		  tau * (4.0 * c[4] + tau * 5.0 * c[5])));
+    out->acc[a] = 2.0 * c[2] + tau * (6.0 * c[3] + tau * (12.0 * c[4] +
+		  tau * 20.0 * c[5]));
+  }
+  return inside;
+}
+
+void
+jitter_spec_default (jitter_spec_s *spec)
+{
+  for (int a = 0; a < WS_AXES; a++) {
+    spec->pose[a] = 0.0;
+    spec->jitter[a] = (a < WS_AXIS_ROLL) ? 1.0 : 0.1;	// cm, radians
+  }
+  spec->onset    = 0.5;
+  spec->relax    = 5.0;
+  spec->interval = 3.0;
+}
+
+bool
+jitter_spec_parse (jitter_spec_s *spec, const char *arg, const char *sep)
+{
+  // lbls.h order within each group is WS_AXIS_* order
+  static const char *pose_keys[WS_AXES] =
+    { "pdx", "pdy", "pdz", "proll", "ppitch", "pyaw" };
+  static const char *jitter_keys[WS_AXES] =
+    { "jdx", "jdy", "jdz", "jroll", "jpitch", "jyaw" };
+  jitter_spec_s lcl = *spec;
+  char *copy = strdup (arg);
+  char *save = NULL;
+  bool ok = true;
+
+  for (char *tok = strtok_r (copy, sep, &save); ok && tok;
+       tok = strtok_r (NULL, sep, &save)) {
+    char *eq = strchr (tok, '=');
+    if (!eq) {
+      ok = false;
+      break;
+    }
+    *eq++ = 0;
+    char *end;
+    double v = strtod (eq, &end);
+    if (end == eq || *end || !isfinite (v)) {
+      ok = false;
+      break;
+    }
+
+    bool found = false;
+    for (int a = 0; a < WS_AXES && !found; a++) {
+      double scaled = (a < WS_AXIS_ROLL) ? v : D2R (v);
+      if (!strcmp (tok, pose_keys[a])) {
+	lcl.pose[a] = scaled;
+	found = true;
+      }
+      else if (!strcmp (tok, jitter_keys[a])) {
+	lcl.jitter[a] = fabs (scaled);
+	found = true;
+      }
+    }
+    if (!found) {
+      if (v < 0.0) ok = false;
+      else if (!strcmp (tok, "onset"))    lcl.onset = v;
+      else if (!strcmp (tok, "relax"))    lcl.relax = v;
+      else if (!strcmp (tok, "interval")) lcl.interval = v;
+      else ok = false;
+    }
+  }
+  free (copy);
+
+  if (ok) *spec = lcl;
+  return ok;
+}
+
+void
+traj_jitter_cycle (traj_s *traj, const traj_point_s *from,
+		   const jitter_spec_s *spec, rng_s *rng)
+{
+  traj_point_s target, home;
+  memset (&target, 0, sizeof(target));
+  memset (&home, 0, sizeof(home));
+  for (int a = 0; a < WS_AXES; a++) {
+    target.pos[a] = spec->pose[a] +
+      spec->jitter[a] * (2.0 * rng_uniform (rng) - 1.0);
+    home.pos[a] = spec->pose[a];
+  }
+  traj_add (traj, from, &target, spec->onset);
+  traj_add (traj, &target, &home, spec->relax);
+  traj_hold (traj, home.pos, spec->interval);
+}
@@ -0,0 +1,116 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "rng.h"
+#include "workspace.h"
+
+/***
+
+    Trajectories as a chain of quintic segments, one polynomial per pose
+    axis (WS_AXIS_* order: x y z cm, roll pitch yaw radians).  Each segment
+    matches position, velocity and acceleration at both ends, so the
+    acceleration is continuous; between two rests it is the minimum jerk
+    profile
+
+	x (s) = x0 + (x1 - x0) (10 s^3 - 15 s^4 + 6 s^5),  s = t / T
+
+    Coefficients are worked out once, when a segment is added, for time in
+    seconds from the segment's start.  traj_eval () is then six Horner
+    evaluations; the segment is found from a cursor that only moves
+    forward, so a player stepping through time does O(1) work per tick.
+
+ ***/
+
+typedef struct {
+  double pos[WS_AXES];
+  double vel[WS_AXES];		// per second
+  double acc[WS_AXES];		// per second^2
+} traj_point_s;
+
+typedef struct {
+  double t0;			// seconds from the trajectory start
+  double duration;
+  double c[WS_AXES][6];		// x (tau) = c0 + c1 tau + ... + c5 tau^5
+} traj_segment_s;
+
+typedef struct {
+  std::vector<traj_segment_s> seg;
+  size_t cursor;
+} traj_s;
+
+void   traj_clear (traj_s *traj);
+double traj_end (const traj_s *traj);
+
+// appends a segment from the end of the last one; a zero duration is a jump
+void   traj_add (traj_s *traj, const traj_point_s *from,
+		 const traj_point_s *to, double duration);
+
+// a rest at pos for duration
+void   traj_hold (traj_s *traj, const double *pos, double duration);
+
+/***
+    Position, velocity and acceleration at t seconds.  Before the start or
+    past the end it holds the first or last point and returns false.
+    Stepping t backwards is allowed, it just costs a search.
+ ***/
+
+bool   traj_eval (traj_s *traj, double t, traj_point_s *out);
+
+// the same with the caller's cursor, for several readers of one trajectory
+bool   traj_eval_at (const traj_s *traj, size_t *cursor, double t,
+		     traj_point_s *out);
+
+/***
+    The jitter of hardware4's web page: from the neutral pose, out to a
+    random point within +-jitter of it in onset seconds, back in relax
+    seconds, then a rest of interval seconds before the next one.  Lengths
+    in cm, angles in radians, times in seconds.
+ ***/
+
+typedef struct {
+  double pose[WS_AXES];		// neutral, pdx .. pyaw
+  double jitter[WS_AXES];	// amplitude, jdx .. jyaw
+  double onset;
+  double relax;
+  double interval;
+} jitter_spec_s;
+
+void jitter_spec_default (jitter_spec_s *spec);
+
+/***
+    hardware4's parameter names and units, pdx pdy pdz proll ppitch pyaw
+    jdx jdy jdz jroll jpitch jyaw (cm and degrees) and onset relax interval
+    (seconds), as key=value separated by any of sep, e.g.
+	"jdx=0.5;jroll=3;onset=0.4;relax=2"
+    Keys that are left out keep their values.  Anything else is an error.
+ ***/
+
+bool jitter_spec_parse (jitter_spec_s *spec, const char *arg, const char *sep);
+
+// appends one onset, relax, interval cycle starting at from
+void traj_jitter_cycle (traj_s *traj, const traj_point_s *from,
+			const jitter_spec_s *spec, rng_s *rng);
+
+#endif // TRAJECTORY_H
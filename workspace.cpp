@@ -0,0 +1,347 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+#include "workspace.h"
+#include "parallel.h"
+
+const char *ws_axis_names[WS_AXES] = {
+  "x", "y", "z", "roll", "pitch", "yaw"
+};
+
+#define WS_CHUNK	4096		// multiple of 64, one bitset word
+#define WS_LINE_STEPS	2001
+
+static const unsigned halton_bases[WS_AXES] = { 2, 3, 5, 7, 11, 13 };
+
+void
+ws_spec_default (ws_spec_s *spec)
+{
+  spec->mode = WS_GRID;
+  for (int a = 0; a < WS_AXES; a++) {
+    bool linear = a < WS_AXIS_ROLL;
+    spec->min[a]   = linear ? -4.0 : -0.6;	// cm, radians
+    spec->max[a]   = linear ?  4.0 :  0.6;
+    spec->steps[a] = 21;
+  }
+  spec->samples = 10000000;
+}
+
+/***
+    One of
+	grid,n			n steps on every axis
+	halton,n		n Halton samples
+	axis,min,max[,steps]	axis is x, y, z, roll, pitch or yaw
+ ***/
+
+// the sample count, checked for overflow against WS_MAX_SAMPLES on the way
+static bool
+ws_spec_fits (const ws_spec_s *spec)
+{
+  if (spec->mode == WS_HALTON) return spec->samples <= WS_MAX_SAMPLES;
+  uint64_t n = 1;
+  for (int a = 0; a < WS_AXES; a++) {
+    n *= spec->steps[a];
+    if (n > WS_MAX_SAMPLES) return false;
+  }
+  return true;
+}
+
+bool
+ws_spec_parse (ws_spec_s *spec, const char *arg)
+{
+  ws_spec_s lcl = *spec;
+  char name[16];
+  double lo, hi;
+  unsigned long n;
+  int len;
+  bool ok = false;
+
+  const char *comma = strchr (arg, ',');
+  if (!comma || comma - arg >= (int)sizeof(name)) return false;
+  len = (int)(comma - arg);
+  memcpy (name, arg, len);
+  name[len] = 0;
+
+  if (!strcmp (name, "grid")) {
+    if (sscanf (comma + 1, "%lu", &n) != 1 || n < 1 || n > UINT32_MAX)
+      return false;
+    lcl.mode = WS_GRID;
+    for (int a = 0; a < WS_AXES; a++) lcl.steps[a] = (unsigned)n;
+    ok = true;
+  }
+  else if (!strcmp (name, "halton")) {
+    if (sscanf (comma + 1, "%lu", &n) != 1 || n < 1) return false;
+    lcl.mode = WS_HALTON;
+    lcl.samples = n;
+    ok = true;
+  }
+  else for (int a = 0; a < WS_AXES; a++) {
+    if (strcmp (name, ws_axis_names[a])) continue;
+    int got = sscanf (comma + 1, "%lf,%lf,%lu", &lo, &hi, &n);
+    if (got < 2 || hi < lo || (got == 3 && n > UINT32_MAX)) return false;
+    lcl.min[a] = lo;
+    lcl.max[a] = hi;
+    if (got == 3 && n > 0) lcl.steps[a] = (unsigned)n;
+    ok = true;
+    break;
+  }
+  if (!ok || !ws_spec_fits (&lcl)) return false;
+  *spec = lcl;
+  return true;
+}
+
+uint64_t
+ws_sample_count (const ws_spec_s *spec)
+{
+  if (spec->mode == WS_HALTON) return spec->samples;
+  uint64_t n = 1;
+  for (int a = 0; a < WS_AXES; a++) n *= spec->steps[a];
+  return n;
+}
+
+static double
+radical_inverse (uint64_t i, unsigned base)
+{
+  double inv = 1.0 / (double)base;
+  double f = inv;
+  double r = 0.0;
+  while (i > 0) {
+    r += f * (double)(i % base);
+    i /= base;
+    f *= inv;
+  }
+  return r;
+}
+
+static void
+set_axis (ik_pose_s *pose, int axis, double v)
+{
+  switch (axis) {
+  case WS_AXIS_X:	pose->delta_x = v; break;
+  case WS_AXIS_Y:	pose->delta_y = v; break;
+  case WS_AXIS_Z:	pose->delta_z = v; break;
+  case WS_AXIS_ROLL:	pose->rho     = v; break;
+  case WS_AXIS_PITCH:	pose->theta   = v; break;
+  case WS_AXIS_YAW:	pose->phi     = v; break;
+  }
+}
+
+static double
+get_axis (const ik_pose_s *pose, int axis)
+{
+  switch (axis) {
+  case WS_AXIS_X:	return pose->delta_x;
+  case WS_AXIS_Y:	return pose->delta_y;
+  case WS_AXIS_Z:	return pose->delta_z;
+  case WS_AXIS_ROLL:	return pose->rho;
+  case WS_AXIS_PITCH:	return pose->theta;
+  case WS_AXIS_YAW:	return pose->phi;
+  }
+  return 0.0;
+}
+
+void
+ws_sample_pose (const ws_spec_s *spec, uint64_t idx, ik_pose_s *pose)
+{
+  for (int a = 0; a < WS_AXES; a++) {
+    double f;
+    if (spec->mode == WS_HALTON)
+      f = radical_inverse (idx + 1, halton_bases[a]);
+    else {
+      unsigned n = spec->steps[a];
+      f = (n > 1) ? (double)(idx % n) / (double)(n - 1) : 0.5;
+      idx /= n;
+    }
+    set_axis (pose, a, spec->min[a] + f * (spec->max[a] - spec->min[a]));
+  }
+}
+
+typedef struct {
+  uint64_t reachable;
+  double   lo[WS_AXES];
+  double   hi[WS_AXES];
+  std::vector<ik_pose_s>     poses;
+  std::vector<double>        alphas;
+  std::vector<unsigned char> valid;
+} ws_accum_s;
+
+/***
+    Reachable interval through the neutral pose along one axis, the others
+    held at zero.  Returns false if the neutral pose itself is out of reach.
+ ***/
+
+static bool
+neutral_limits (const ik_geometry_s *geo, const ws_spec_s *spec, int axis,
+		double *lo, double *hi)
+{
+  std::vector<ik_pose_s> poses (WS_LINE_STEPS);
+  std::vector<double> alphas (WS_LINE_STEPS * IK_SERVOS);
+  std::vector<unsigned char> valid (WS_LINE_STEPS);
+  double span = spec->max[axis] - spec->min[axis];
+  int zero = 0;
+
+  for (int i = 0; i < WS_LINE_STEPS; i++) {
+    memset (&poses[i], 0, sizeof(ik_pose_s));
+    double v = spec->min[axis] + span * (double)i / (WS_LINE_STEPS - 1);
+    set_axis (&poses[i], axis, v);
+    if (fabs (v) < fabs (get_axis (&poses[zero], axis))) zero = i;
+  }
+  ik_batch (geo, poses.data (), alphas.data (), valid.data (), WS_LINE_STEPS);
+  if (!valid[zero]) return false;
+
+  int i = zero, j = zero;
+  while (i > 0 && valid[i - 1]) i--;
+  while (j < WS_LINE_STEPS - 1 && valid[j + 1]) j++;
+  *lo = get_axis (&poses[i], axis);
+  *hi = get_axis (&poses[j], axis);
+  return true;
+}
+
+int
+ws_sweep (const ik_geometry_s *geo, const ws_spec_s *spec,
+	  const char *filename)
+{
+  uint64_t count = ws_sample_count (spec);
+  std::vector<uint64_t> bits ((count + 63) / 64, 0);
+  int nthreads = parallel_threads ();
+  std::vector<ws_accum_s> accum (nthreads);
+  struct timespec start, end;
+
+  for (int t = 0; t < nthreads; t++) {
+    accum[t].reachable = 0;
+    for (int a = 0; a < WS_AXES; a++) {
+      accum[t].lo[a] =  HUGE_VAL;
+      accum[t].hi[a] = -HUGE_VAL;
+    }
+  }
+
+  clock_gettime (CLOCK_MONOTONIC, &start);
+
+  // chunks are word aligned, so no two threads ever share a bitset word
+  parallel_for (count, WS_CHUNK, [&](size_t begin, size_t end, int t) {
+      ws_accum_s *acc = &accum[t];
+      size_t n = end - begin;
+      if (acc->poses.size () < n) {
+	acc->poses.resize (WS_CHUNK);
+	acc->alphas.resize (WS_CHUNK * IK_SERVOS);
+	acc->valid.resize (WS_CHUNK);
+      }
+      for (size_t i = 0; i < n; i++)
+	ws_sample_pose (spec, begin + i, &acc->poses[i]);
+      acc->reachable += ik_batch (geo, acc->poses.data (),
+				  acc->alphas.data (), acc->valid.data (), n);
+      for (size_t i = 0; i < n; i++) {
+	if (!acc->valid[i]) continue;
+	uint64_t idx = begin + i;
+	bits[idx >> 6] |= (uint64_t)1 << (idx & 63);
+	for (int a = 0; a < WS_AXES; a++) {
+	  double v = get_axis (&acc->poses[i], a);
+	  if (v < acc->lo[a]) acc->lo[a] = v;
+	  if (v > acc->hi[a]) acc->hi[a] = v;
+	}
+      }
+    });
+
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  double secs = (double)(end.tv_sec - start.tv_sec) +
+    1.0e-9 * (double)(end.tv_nsec - start.tv_nsec);
+
+  uint64_t reachable = 0;
+  double lo[WS_AXES], hi[WS_AXES];
+  for (int a = 0; a < WS_AXES; a++) {
+    lo[a] =  HUGE_VAL;
+    hi[a] = -HUGE_VAL;
+  }
+  for (int t = 0; t < nthreads; t++) {
+    reachable += accum[t].reachable;
+    for (int a = 0; a < WS_AXES; a++) {
+      if (accum[t].lo[a] < lo[a]) lo[a] = accum[t].lo[a];
+      if (accum[t].hi[a] > hi[a]) hi[a] = accum[t].hi[a];
+    }
+  }
+
+  ws_header_s hdr;
+  memset (&hdr, 0, sizeof(hdr));
+  memcpy (hdr.magic, WS_MAGIC, 4);
+  hdr.version = WS_VERSION;
+  hdr.mode = spec->mode;
+  for (int a = 0; a < WS_AXES; a++) {
+    hdr.steps[a] = (spec->mode == WS_GRID) ? spec->steps[a] : 0;
+    hdr.min[a] = spec->min[a];
+    hdr.max[a] = spec->max[a];
+  }
+  hdr.samples = count;
+  hdr.reachable = reachable;
+  memcpy (hdr.base_x,   geo->base_x,   sizeof(hdr.base_x));
+  memcpy (hdr.base_z,   geo->base_z,   sizeof(hdr.base_z));
+  memcpy (hdr.anchor_x, geo->anchor_x, sizeof(hdr.anchor_x));
+  memcpy (hdr.anchor_y, geo->anchor_y, sizeof(hdr.anchor_y));
+  memcpy (hdr.anchor_z, geo->anchor_z, sizeof(hdr.anchor_z));
+  hdr.h0 = geo->h0;
+  hdr.arm_length = geo->arm_length;
+  hdr.leg_length = geo->leg_length;
+
+  FILE *fp = fopen (filename, "w");
+  if (!fp) {
+    perror (filename);
+    return -1;
+  }
+  if (fwrite (&hdr, sizeof(hdr), 1, fp) != 1 ||
+      fwrite (bits.data (), sizeof(uint64_t), bits.size (), fp) !=
+      bits.size ()) {
+    perror (filename);
+    fclose (fp);
+    return -1;
+  }
+  if (fclose (fp) != 0) {
+    perror (filename);
+    return -1;
+  }
+
+  fprintf (stdout, "workspace: %s, %llu samples, %d threads, %s kernel\n",
+	   (spec->mode == WS_GRID) ? "grid" : "halton",
+	   (unsigned long long)count, nthreads, ik_batch_isa ());
+  fprintf (stdout, "reachable: %llu (%.3f%%)\n",
+	   (unsigned long long)reachable,
+	   count ? 100.0 * (double)reachable / (double)count : 0.0);
+  fprintf (stdout, "time:      %.3f sec, %.0f samples/sec\n",
+	   secs, (double)count / secs);
+  fprintf (stdout, "\n%-6s %10s %10s %10s %10s %10s %10s\n", "axis",
+	   "min", "max", "reach lo", "reach hi", "neutral lo", "neutral hi");
+  for (int a = 0; a < WS_AXES; a++) {
+    double nlo, nhi;
+    bool have = neutral_limits (geo, spec, a, &nlo, &nhi);
+    fprintf (stdout, "%-6s %10.4g %10.4g", ws_axis_names[a],
+	     spec->min[a], spec->max[a]);
+    if (reachable) fprintf (stdout, " %10.4g %10.4g", lo[a], hi[a]);
+    else fprintf (stdout, " %10s %10s", "-", "-");
+    if (have) fprintf (stdout, " %10.4g %10.4g\n", nlo, nhi);
+    else fprintf (stdout, " %10s %10s\n", "-", "-");
+  }
+  fprintf (stdout, "\nwritten to %s\n", filename);
+  return 0;
+}
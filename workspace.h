@@ -0,0 +1,103 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <stdint.h>
+
+#include "ikbatch.h"
+
+/***
+
+    Workspace reachability sweep.  Every sample of a 6-DOF grid, or of a
+    Halton sequence over the same box, is run through ik_batch () on all
+    cores and its reachability is recorded as one bit.
+
+    File layout, host byte order:
+
+	ws_header_s
+	uint64_t bits[(samples + 63) / 64]	bit (i & 63) of bits[i >> 6]
+						set if sample i is reachable
+
+    Grid sample i has axis 0 (x) varying fastest:
+	i = ix + nx * (iy + ny * (iz + nz * (iroll + ...)))
+    Halton sample i uses the radical inverse of i + 1 in bases
+    2, 3, 5, 7, 11, 13 for x, y, z, roll, pitch, yaw.
+
+ ***/
+
+enum {
+  WS_AXIS_X,			// delta_x
+  WS_AXIS_Y,			// delta_y
+  WS_AXIS_Z,			// delta_z
+  WS_AXIS_ROLL,			// rho
+  WS_AXIS_PITCH,		// theta
+  WS_AXIS_YAW,			// phi
+  WS_AXES
+};
+
+typedef enum {
+  WS_GRID,
+  WS_HALTON
+} ws_mode_e;
+
+typedef struct {
+  ws_mode_e mode;
+  double    min[WS_AXES];
+  double    max[WS_AXES];
+  unsigned  steps[WS_AXES];	// grid only
+  uint64_t  samples;		// halton only
+} ws_spec_s;
+
+#define WS_MAGIC	"STWS"
+#define WS_VERSION	1
+
+typedef struct {
+  char     magic[4];
+  uint32_t version;
+  uint32_t mode;
+  uint32_t steps[WS_AXES];
+  uint64_t samples;
+  uint64_t reachable;
+  double   min[WS_AXES];
+  double   max[WS_AXES];
+  double   base_x[IK_SERVOS];
+  double   base_z[IK_SERVOS];
+  double   anchor_x[IK_SERVOS];
+  double   anchor_y[IK_SERVOS];
+  double   anchor_z[IK_SERVOS];
+  double   h0;
+  double   arm_length;
+  double   leg_length;
+} ws_header_s;
+
+// a quantization field is 4 bytes a sample, so this is 4 GB of it
+#define WS_MAX_SAMPLES	1000000000ULL
+
+extern const char *ws_axis_names[WS_AXES];
+
+void     ws_spec_default (ws_spec_s *spec);
+// false, spec untouched, for a bad arg or more than WS_MAX_SAMPLES samples
+bool     ws_spec_parse (ws_spec_s *spec, const char *arg);
+uint64_t ws_sample_count (const ws_spec_s *spec);
+void     ws_sample_pose (const ws_spec_s *spec, uint64_t idx, ik_pose_s *pose);
+int      ws_sweep (const ik_geometry_s *geo, const ws_spec_s *spec,
+		   const char *filename);
+
+#endif // WORKSPACE_H
@@ -0,0 +1,107 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+
+#include "yuv.h"
+
+size_t
+yuv_i420_size (int width, int height)
+{
+  return (size_t)width * height + 2 * (size_t)(width / 2) * (height / 2);
+}
+
+void
+yuv_from_rgba_scalar (const unsigned char *rgba, int width, int height,
+		      unsigned char *out)
+{
+  const size_t stride = (size_t)width * 4;
+  unsigned char *u = out + (size_t)width * height;
+  unsigned char *v = u + (size_t)(width / 2) * (height / 2);
+
+  for (int row = 0; row < height; row++) {
+    const unsigned char *s = rgba + (size_t)(height - 1 - row) * stride;
+    for (int x = 0; x < width; x++, s += 4)
+      *out++ = (unsigned char)(((66 * s[0] + 129 * s[1] + 25 * s[2] + 128)
+				>> 8) + 16);
+  }
+  for (int row = 0; row < height; row += 2) {
+    const unsigned char *s0 = rgba + (size_t)(height - 1 - row) * stride;
+    const unsigned char *s1 = s0 - stride;
+    for (int x = 0; x < width; x += 2, s0 += 8, s1 += 8) {
+      int r = (s0[0] + s0[4] + s1[0] + s1[4] + 2) >> 2;
+      int g = (s0[1] + s0[5] + s1[1] + s1[5] + 2) >> 2;
+      int b = (s0[2] + s0[6] + s1[2] + s1[6] + 2) >> 2;
+      *u++ = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+      *v++ = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+  }
+}
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define YUV_WIDTH	4
+#define YUV_PACK(p, a, b, c, d)						\
+  _mm_storeu_si128 ((__m128i *)(p), _mm_packus_epi16 (			\
+    _mm_packs_epi32 ((__m128i)(a), (__m128i)(b)),			\
+    _mm_packs_epi32 ((__m128i)(c), (__m128i)(d))))
+#define YUV_EVEN	{ 0, 2, 4, 6 }
+#define YUV_ODD		{ 1, 3, 5, 7 }
+#define YUV_NAME	yuv_from_rgba_sse2
+#include "yuv_kernel.h"
+#else
+void
+yuv_from_rgba_sse2 (const unsigned char *rgba, int width, int height,
+		    unsigned char *out)
+{
+  yuv_from_rgba_scalar (rgba, width, height, out);
+}
+#endif
+
+static bool
+have_avx2 ()
+{
+#if defined (__x86_64__) || defined (__i386__)
+  static int have = -1;
+  if (have < 0) {
+    __builtin_cpu_init ();
+    have = __builtin_cpu_supports ("avx2");
+  }
+  return have;
+#else
+  return false;
+#endif
+}
+
+const char *
+yuv_isa ()
+{
+  if (have_avx2 ()) return "avx2";
+#ifdef __SSE2__
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
+
+void
+yuv_from_rgba (const unsigned char *rgba, int width, int height,
+	       unsigned char *out)
+{
+  if (have_avx2 ()) yuv_from_rgba_avx2 (rgba, width, height, out);
+  else yuv_from_rgba_sse2 (rgba, width, height, out);
+}
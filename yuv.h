@@ -0,0 +1,53 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+
+#ifndef YUV_H
+#define YUV_H
+
+#include <stddef.h>
+
+/***
+
+    RGBA to I420 (ffmpeg's yuv420p) for --record, so the pipe to ffmpeg
+    carries 1.5 bytes a pixel instead of 4 and ffmpeg neither converts
+    nor flips.  The source is glReadPixels output, bottom row first; the
+    result is top row first: a w x h Y plane, then U and V, each
+    w/2 x h/2.  Width and height must be even.
+
+    The sums are BT.601 limited range in 8.8 fixed point, as swscale's
+    default, with the chroma of each 2x2 block from its mean colour.
+    Every variant gives the same bytes; yuv_from_rgba () picks the widest
+    the cpu supports.
+
+ ***/
+
+size_t yuv_i420_size (int width, int height);
+
+void yuv_from_rgba (const unsigned char *rgba, int width, int height,
+		    unsigned char *out);
+void yuv_from_rgba_scalar (const unsigned char *rgba, int width, int height,
+			   unsigned char *out);
+void yuv_from_rgba_sse2 (const unsigned char *rgba, int width, int height,
+			 unsigned char *out);
+void yuv_from_rgba_avx2 (const unsigned char *rgba, int width, int height,
+			 unsigned char *out);
+
+const char *yuv_isa ();
+
+#endif // YUV_H
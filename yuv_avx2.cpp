@@ -0,0 +1,45 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+
+// Built with $(AVX2_CFLAGS); only ever called when the cpu has avx2.
+
+#include "yuv.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#define YUV_WIDTH	8
+// the packs work within 128 bit halves; the permute puts them in order
+#define YUV_PACK(p, a, b, c, d)						\
+  _mm256_storeu_si256 ((__m256i *)(p), _mm256_permutevar8x32_epi32 (	\
+    _mm256_packus_epi16 (						\
+      _mm256_packs_epi32 ((__m256i)(a), (__m256i)(b)),			\
+      _mm256_packs_epi32 ((__m256i)(c), (__m256i)(d))),			\
+    _mm256_setr_epi32 (0, 4, 1, 5, 2, 6, 3, 7)))
+#define YUV_EVEN	{ 0, 2, 4, 6, 8, 10, 12, 14 }
+#define YUV_ODD		{ 1, 3, 5, 7, 9, 11, 13, 15 }
+#define YUV_NAME	yuv_from_rgba_avx2
+#include "yuv_kernel.h"
+#else
+void
+yuv_from_rgba_avx2 (const unsigned char *rgba, int width, int height,
+		    unsigned char *out)
+{
+  yuv_from_rgba_sse2 (rgba, width, height, out);
+}
+#endif
@@ -0,0 +1,152 @@
+/***
+    This file is part of the Stewart platform simulator.
+
+    Copyright 2022 C. H. L. Moller
+
+Stewart is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later
+version.
+
+Stewart is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with
+Stewart. If not, see <https://www.gnu.org/licenses/>.
+ ***/
+
+/***
+
+    RGBA to I420 kernel, written once with gcc vector extensions and
+    compiled once per instruction set, as ikbatch_kernel.h is.  The
+    including file defines
+
+	YUV_WIDTH	32 bit lanes per vector (4 for sse2, 8 for avx2)
+	YUV_EVEN	the shuffle mask picking the even lanes of two vectors
+	YUV_ODD		and the odd ones
+	YUV_PACK(p, a, b, c, d)
+			stores the low bytes of the lanes of four
+			vectors, in order, 4 * YUV_WIDTH bytes at p
+	YUV_NAME	name of the generated function
+
+    Lanes are pixels, one RGBA word each.  Two output rows are done at a
+    time, both luma rows and the chroma row between them, reading source
+    rows from the bottom up, 4 * YUV_WIDTH pixels a step so every store
+    is a whole vector of bytes.  Columns past the last whole step go
+    through the same sums one pixel at a time.
+
+ ***/
+
+#include <string.h>
+
+namespace {
+
+typedef int yuv_vi __attribute__ ((vector_size (YUV_WIDTH * 4)));
+
+static inline yuv_vi
+yuv_load (const unsigned char *p)
+{
+  yuv_vi v;
+  memcpy (&v, p, sizeof(v));
+  return v;
+}
+
+static inline yuv_vi
+yuv_luma (yuv_vi px)
+{
+  yuv_vi r = px & 0xff, g = (px >> 8) & 0xff, b = (px >> 16) & 0xff;
+  return ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+}
+
+static inline int
+yuv_luma1 (const unsigned char *p)
+{
+  return ((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16;
+}
+
+// r, g and b of a 2x2 block, rounded means, to u and v
+static inline void
+yuv_chroma1 (const unsigned char *p0, const unsigned char *p1,
+	     unsigned char *u, unsigned char *v)
+{
+  int r = (p0[0] + p0[4] + p1[0] + p1[4] + 2) >> 2;
+  int g = (p0[1] + p0[5] + p1[1] + p1[5] + 2) >> 2;
+  int b = (p0[2] + p0[6] + p1[2] + p1[6] + 2) >> 2;
+  *u = (unsigned char)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+  *v = (unsigned char)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+// one channel of 2 * YUV_WIDTH pixels of two rows, summed over pairs
+static inline yuv_vi
+yuv_pairs (yuv_vi a0, yuv_vi b0, yuv_vi a1, yuv_vi b1, int shift)
+{
+  const yuv_vi even = YUV_EVEN, odd = YUV_ODD;
+  a0 = (a0 >> shift) & 0xff;
+  b0 = (b0 >> shift) & 0xff;
+  a1 = (a1 >> shift) & 0xff;
+  b1 = (b1 >> shift) & 0xff;
+  return __builtin_shuffle (a0, b0, even) + __builtin_shuffle (a0, b0, odd) +
+    __builtin_shuffle (a1, b1, even) + __builtin_shuffle (a1, b1, odd);
+}
+
+// u and v of the 2x2 blocks of 2 * YUV_WIDTH pixels of two rows
+static inline void
+yuv_chroma (yuv_vi a0, yuv_vi b0, yuv_vi a1, yuv_vi b1, yuv_vi *u, yuv_vi *v)
+{
+  yuv_vi r = (yuv_pairs (a0, b0, a1, b1, 0) + 2) >> 2;
+  yuv_vi g = (yuv_pairs (a0, b0, a1, b1, 8) + 2) >> 2;
+  yuv_vi b = (yuv_pairs (a0, b0, a1, b1, 16) + 2) >> 2;
+  *u = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+  *v = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+}
+
+} // namespace
+
+void
+YUV_NAME (const unsigned char *rgba, int width, int height,
+	  unsigned char *out)
+{
+  const size_t stride = (size_t)width * 4;
+  unsigned char *y_plane = out;
+  unsigned char *u_plane = out + (size_t)width * height;
+  unsigned char *v_plane = u_plane + (size_t)(width / 2) * (height / 2);
+  const int step = 4 * YUV_WIDTH;
+  const int whole = (width / step) * step;
+
+  for (int row = 0; row < height; row += 2) {
+    const unsigned char *s0 = rgba + (size_t)(height - 1 - row) * stride;
+    const unsigned char *s1 = s0 - stride;
+    unsigned char *y0 = y_plane + (size_t)row * width;
+    unsigned char *y1 = y0 + width;
+    unsigned char *u_row = u_plane + (size_t)(row / 2) * (width / 2);
+    unsigned char *v_row = v_plane + (size_t)(row / 2) * (width / 2);
+
+    int x = 0;
+    for (; x < whole; x += step) {
+      yuv_vi p0[4], p1[4], u[2], v[2];
+      for (int k = 0; k < 4; k++) {
+	p0[k] = yuv_load (s0 + 4 * (x + k * YUV_WIDTH));
+	p1[k] = yuv_load (s1 + 4 * (x + k * YUV_WIDTH));
+      }
+      YUV_PACK (y0 + x, yuv_luma (p0[0]), yuv_luma (p0[1]),
+		yuv_luma (p0[2]), yuv_luma (p0[3]));
+      YUV_PACK (y1 + x, yuv_luma (p1[0]), yuv_luma (p1[1]),
+		yuv_luma (p1[2]), yuv_luma (p1[3]));
+
+      yuv_chroma (p0[0], p0[1], p1[0], p1[1], &u[0], &v[0]);
+      yuv_chroma (p0[2], p0[3], p1[2], p1[3], &u[1], &v[1]);
+      unsigned char uv[4 * YUV_WIDTH];
+      YUV_PACK (uv, u[0], u[1], v[0], v[1]);
+      memcpy (u_row + x / 2, uv, 2 * YUV_WIDTH);
+      memcpy (v_row + x / 2, uv + 2 * YUV_WIDTH, 2 * YUV_WIDTH);
+    }
+    for (; x < width; x += 2) {
+      y0[x]     = (unsigned char)yuv_luma1 (s0 + 4 * x);
+      y0[x + 1] = (unsigned char)yuv_luma1 (s0 + 4 * x + 4);
+      y1[x]     = (unsigned char)yuv_luma1 (s1 + 4 * x);
+      y1[x + 1] = (unsigned char)yuv_luma1 (s1 + 4 * x + 4);
+      yuv_chroma1 (s0 + 4 * x, s1 + 4 * x, u_row + x / 2, v_row + x / 2);
+    }
+  }
+}